@@ -0,0 +1,382 @@
+// cCodeGenerator.c
+#include "cCodeGenerator.h"
+#include "commons/outputWriter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Size of the stdout buffer the generated program sets up
+#define C_OUTPUT_BUFFER_SIZE 65536
+
+// Most arguments a call can have pending at once
+#define C_MAX_PENDING_ARGS 32
+
+static OutputWriter cWriter;
+
+// Function being translated, NULL for main
+static FuncTAC* currentFunc = NULL;
+
+// arg.* TACs since the last call; their values are in locals named cmm_arg<index>
+static TAC* pendingArgs[C_MAX_PENDING_ARGS];
+static int pendingArgIndices[C_MAX_PENDING_ARGS];
+static int pendingArgCount = 0;
+static int nextArgIndex = 0;
+
+// Every operand the TAC lists name, sorted, so variables and temps the optimizer
+// made unused are left out instead of drawing warnings from the C compiler
+static const char** operandNames = NULL;
+static int operandCount = 0;
+
+// Helpers put in front of every generated program. cmm_add() and cmm_sub() stop the
+// program on overflow like MIPS add and sub trap, cmm_div() wraps INT_MIN / -1 around
+// instead of trapping, and cmm_writeFloat() prints values like the MIPS --buffered-output
+// runtime does: up to six fraction digits, without trailing zeros but with at least one,
+// and %g from 2^31 up
+static const char* cPrelude =
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "\n"
+    "static void cmm_overflow(void) {\n"
+    "    fflush(stdout);\n"
+    "    fputs(\"Arithmetic overflow\\n\", stderr);\n"
+    "    exit(1);\n"
+    "}\n"
+    "\n"
+    "static inline int cmm_add(int a, int b) {\n"
+    "    int result;\n"
+    "    if (__builtin_add_overflow(a, b, &result)) cmm_overflow();\n"
+    "    return result;\n"
+    "}\n"
+    "\n"
+    "static inline int cmm_sub(int a, int b) {\n"
+    "    int result;\n"
+    "    if (__builtin_sub_overflow(a, b, &result)) cmm_overflow();\n"
+    "    return result;\n"
+    "}\n"
+    "\n"
+    "static inline int cmm_div(int a, int b) {\n"
+    "    return (b == -1) ? (int)(0u - (unsigned int)a) : a / b;\n"
+    "}\n"
+    "\n"
+    "static inline void cmm_writeFloat(float value) {\n"
+    "    unsigned int bits;\n"
+    "    memcpy(&bits, &value, sizeof(bits));\n"
+    "    if ((bits & 0x7fffffff) >= 0x4f000000) {\n"
+    "        printf(\"%g\\n\", value);\n"
+    "        return;\n"
+    "    }\n"
+    "    const char* sign = (bits & 0x80000000) ? \"-\" : \"\";\n"
+    "    if (bits & 0x80000000) value = -value;\n"
+    "    int whole = (int)value;\n"
+    "    float scaled = value - (float)whole;\n"
+    "    scaled = scaled * 1000000.0f;\n"
+    "    scaled = scaled + 0.5f;\n"
+    "    int fraction = (int)scaled;\n"
+    "    if (fraction >= 1000000) {\n"
+    "        whole++;\n"
+    "        fraction = 0;\n"
+    "    }\n"
+    "    int digits = 6;\n"
+    "    while (digits > 1 && fraction % 10 == 0) {\n"
+    "        fraction /= 10;\n"
+    "        digits--;\n"
+    "    }\n"
+    "    printf(\"%s%d.%0*d\\n\", sign, whole, digits, fraction);\n"
+    "}\n";
+
+// Type named by an op suffix ("int", "floatIndex", ...)
+static VarType cOpType(const char* suffix) {
+    if (strncmp(suffix, "float", 5) == 0) return VarType_Float;
+    if (strncmp(suffix, "char", 4) == 0) return VarType_Char;
+    return VarType_Int;
+}
+
+static const char* cTypeName(VarType type) {
+    switch (type) {
+        case VarType_Float: return "float";
+        case VarType_Char: return "char";
+        case VarType_Void: return "void";
+        default: return "int";
+    }
+}
+
+// C identifier for a variable, parameter or temp: scoped names ("func.param_var")
+// have their dots turned into "__"
+static const char* cName(const char* name) {
+    static char names[4][300];
+    static int nextName = 0;
+
+    if (!strchr(name, '.')) return name;
+    char* result = names[nextName];
+    nextName = (nextName + 1) % 4;
+    size_t length = 0;
+    for (; *name && length + 2 < sizeof(names[0]); name++) {
+        if (*name == '.') {
+            result[length++] = '_';
+            result[length++] = '_';
+        } else {
+            result[length++] = *name;
+        }
+    }
+    result[length] = '\0';
+    return result;
+}
+
+// Float constants are written as hex literals, so they keep their exact bits
+static void writeFloatLiteral(const char* text) {
+    writerPrintf(&cWriter, "%af", (double)strtof(text, NULL));
+}
+
+static void generateCAssign(TAC* current, VarType type) {
+    writerPrintf(&cWriter, "    %s = ", cName(current->result));
+    if (type == VarType_Float) {
+        writeFloatLiteral(current->arg1);
+    } else if (type == VarType_Char) {
+        writerPrintf(&cWriter, "(char)%d", (unsigned char)current->arg1[0]);
+    } else {
+        writerPrintf(&cWriter, "%d", atoi(current->arg1));
+    }
+    writerPrintf(&cWriter, ";\n");
+}
+
+// +, -, * and / on ints or floats
+static void generateCArithmetic(TAC* current) {
+    char operator = current->op[0];
+    if (cOpType(current->op + 2) == VarType_Float) {
+        writerPrintf(&cWriter, "    %s = %s %c %s;\n", cName(current->result), cName(current->arg1), operator, cName(current->arg2));
+        return;
+    }
+    if (operator != '*') {
+        const char* helper = (operator == '+') ? "cmm_add" : (operator == '-') ? "cmm_sub" : "cmm_div";
+        writerPrintf(&cWriter, "    %s = %s(%s, %s);\n", cName(current->result), helper, cName(current->arg1), cName(current->arg2));
+        return;
+    }
+    // Done on unsigned values, so overflow wraps around like MIPS mul instead of being undefined
+    writerPrintf(&cWriter, "    %s = (int)((unsigned int)%s * (unsigned int)%s);\n",
+                 cName(current->result), cName(current->arg1), cName(current->arg2));
+}
+
+static void generateCWrite(TAC* current) {
+    const char* suffix = current->op + 6;
+    if (strcmp(suffix, "string") == 0) {
+        // Literals are already escaped for .asciiz, which C reads the same way
+        writerPrintf(&cWriter, "    fputs(\"%s\", stdout);\n", current->arg1);
+    } else if (strcmp(suffix, "charArray") == 0) {
+        // Char arrays end with a newline and NUL, see declareCData()
+        writerPrintf(&cWriter, "    fputs(%s, stdout);\n", cName(current->arg1));
+    } else if (strcmp(suffix, "float") == 0) {
+        writerPrintf(&cWriter, "    cmm_writeFloat(%s);\n", cName(current->arg1));
+    } else if (strcmp(suffix, "char") == 0) {
+        writerPrintf(&cWriter, "    printf(\"%%c\\n\", %s);\n", cName(current->arg1));
+    } else {
+        writerPrintf(&cWriter, "    printf(\"%%d\\n\", %s);\n", cName(current->arg1));
+    }
+}
+
+// Keep an argument's value; it is bound to the parameter when the call is made
+static void generateCArg(TAC* current) {
+    if (pendingArgCount == C_MAX_PENDING_ARGS) {
+        fprintf(stderr, "Error: More than %d pending arguments\n", C_MAX_PENDING_ARGS);
+        exit(1);
+    }
+    VarType type = cOpType(current->op + 4);
+    writerPrintf(&cWriter, "    %s cmm_arg%d = %s;\n", cTypeName(type), nextArgIndex, cName(current->arg1));
+    pendingArgs[pendingArgCount] = current;
+    pendingArgIndices[pendingArgCount++] = nextArgIndex++;
+}
+
+// Copy the kept arguments into the callee's parameters
+static void bindCArgs() {
+    for (int i = 0; i < pendingArgCount; i++) {
+        writerPrintf(&cWriter, "    %s = cmm_arg%d;\n", cName(pendingArgs[i]->result), pendingArgIndices[i]);
+    }
+    pendingArgCount = 0;
+}
+
+static void generateCCall(TAC* current) {
+    bindCArgs();
+    FuncTAC* callee = findFuncTAC(current->arg1);
+    if (current->result && callee && callee->returnType != VarType_Void) {
+        writerPrintf(&cWriter, "    %s = %s();\n", cName(current->result), current->arg1);
+    } else {
+        writerPrintf(&cWriter, "    %s();\n", current->arg1);
+    }
+}
+
+// Leave the function being translated, returning the value set by setReturn.*
+static void generateCReturn() {
+    if (!currentFunc) {
+        writerPrintf(&cWriter, "    return 0;\n");
+    } else if (currentFunc->returnType == VarType_Void) {
+        writerPrintf(&cWriter, "    return;\n");
+    } else {
+        writerPrintf(&cWriter, "    return cmm_result;\n");
+    }
+}
+
+// The callee's value becomes ours, so the call is the return statement; the C
+// compiler turns it into a jump
+static void generateCTailCall(TAC* current) {
+    bindCArgs();
+    FuncTAC* callee = findFuncTAC(current->arg1);
+    if (currentFunc && currentFunc->returnType != VarType_Void && callee && callee->returnType == currentFunc->returnType) {
+        writerPrintf(&cWriter, "    return %s();\n", current->arg1);
+    } else {
+        writerPrintf(&cWriter, "    %s();\n", current->arg1);
+        generateCReturn();
+    }
+}
+
+// Translate one TAC list, main's or a function's
+static void generateCList(TAC* current) {
+    for (; current; current = current->next) {
+        const char* op = current->op;
+        if (strcmp(op, "funcStart") == 0 || strcmp(op, "reserveArgs") == 0) {
+            // Nothing to set up, arguments are kept in locals
+        } else if (strcmp(op, "return") == 0) {
+            generateCReturn();
+        } else if (strncmp(op, "assign.", 7) == 0) {
+            generateCAssign(current, cOpType(op + 7));
+        } else if (strncmp(op, "load.", 5) == 0) {
+            if (strstr(op, "Index")) writerPrintf(&cWriter, "    %s = %s[%s];\n", cName(current->result), cName(current->arg1), cName(current->arg2));
+            else writerPrintf(&cWriter, "    %s = %s;\n", cName(current->result), cName(current->arg1));
+        } else if (strncmp(op, "store.", 6) == 0) {
+            if (strstr(op, "Index")) writerPrintf(&cWriter, "    %s[%s] = %s;\n", cName(current->result), cName(current->arg2), cName(current->arg1));
+            else writerPrintf(&cWriter, "    %s = %s;\n", cName(current->result), cName(current->arg1));
+        } else if (op[0] && op[1] == '.' && strchr("+-*/", op[0])) {
+            generateCArithmetic(current);
+        } else if (strcmp(op, "intToFloat") == 0) {
+            writerPrintf(&cWriter, "    %s = (float)%s;\n", cName(current->result), cName(current->arg1));
+        } else if (strcmp(op, "floatToInt") == 0) {
+            // Truncates, like cvt.w.s does in MARS
+            writerPrintf(&cWriter, "    %s = (int)%s;\n", cName(current->result), cName(current->arg1));
+        } else if (strncmp(op, "write.", 6) == 0) {
+            generateCWrite(current);
+        } else if (strncmp(op, "arg.", 4) == 0) {
+            generateCArg(current);
+        } else if (strcmp(op, "functionCall") == 0) {
+            generateCCall(current);
+        } else if (strcmp(op, "tailCall") == 0) {
+            generateCTailCall(current);
+        } else if (strncmp(op, "setReturn.", 10) == 0) {
+            writerPrintf(&cWriter, "    cmm_result = %s;\n", cName(current->arg1));
+        } else {
+            printf("C: Unsupported TAC op %s\n", op);
+        }
+    }
+}
+
+static int compareNames(const void* a, const void* b) {
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+static void addOperands(TAC* current) {
+    for (; current; current = current->next) {
+        const char* operands[3] = { current->arg1, current->arg2, current->result };
+        for (int i = 0; i < 3; i++) {
+            if (!operands[i]) continue;
+            operandNames = realloc(operandNames, (operandCount + 1) * sizeof(char*));
+            operandNames[operandCount++] = operands[i];
+        }
+    }
+}
+
+static void collectOperands(TAC* tacInstructions) {
+    addOperands(tacInstructions);
+    for (FuncTAC* func = funcTacHeads; func; func = func->nextFunc) addOperands(func->func);
+    qsort(operandNames, operandCount, sizeof(char*), compareNames);
+}
+
+static bool isOperand(const char* name) {
+    return bsearch(&name, operandNames, operandCount, sizeof(char*), compareNames) != NULL;
+}
+
+// Declare every variable and temp, zeroed (chars as 'U') unless the optimizer gave
+// them a static initial value
+static void declareCData(const SymbolTable* table) {
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        for (Symbol* current = table->table[i]; current; current = current->next) {
+            if (!isOperand(current->name)) continue;
+            int count = current->isArray ? current->arrSize : 1;
+            switch (current->type) {
+                case VarType_Int:
+                case VarType_Float:
+                case VarType_Char:
+                    writerPrintf(&cWriter, "static %s %s", cTypeName(current->type), cName(current->name));
+                    // Written whole by write.charArray, so char arrays end with a newline and NUL
+                    if (current->isArray) writerPrintf(&cWriter, "[%d]", (current->type == VarType_Char) ? count + 2 : count);
+                    writerPrintf(&cWriter, " = %s", current->isArray ? "{" : "");
+                    for (int j = 0; j < count; j++) {
+                        const char* initValue = getInitValue(current, j);
+                        if (j > 0) writerPrintf(&cWriter, ", ");
+                        if (current->type == VarType_Char) writerPrintf(&cWriter, "%d", initValue ? (unsigned char)initValue[0] : 'U');
+                        else if (!initValue) writerPrintf(&cWriter, "0");
+                        else if (current->type == VarType_Float) writeFloatLiteral(initValue);
+                        else writerPrintf(&cWriter, "%d", atoi(initValue));
+                    }
+                    if (current->isArray) writerPrintf(&cWriter, (current->type == VarType_Char) ? ", 10, 0}" : "}");
+                    writerPrintf(&cWriter, ";\n");
+                    break;
+
+                default:
+                    printf("Invalid VarType in declareCData(): %s\n", varTypeToString(current->type));
+                    break;
+            }
+        }
+    }
+
+    const char* tempTypes[3] = { "int", "float", "char" };
+    int tempCounts[3] = { getTempIntCount(), getTempFloatCount(), getTempCharCount() };
+    for (int kind = 0; kind < 3; kind++) {
+        for (int i = 0; i < tempCounts[kind]; i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "%c%d", tempTypes[kind][0], i);
+            if (isOperand(name)) writerPrintf(&cWriter, "static %s %s;\n", tempTypes[kind], name);
+        }
+    }
+}
+
+static void generateCFunction(FuncTAC* func) {
+    currentFunc = func;
+    writerPrintf(&cWriter, "\nstatic %s %s(void) {\n", cTypeName(func->returnType), func->funcName);
+    if (func->returnType != VarType_Void) writerPrintf(&cWriter, "    %s cmm_result = 0;\n", cTypeName(func->returnType));
+    generateCList(func->func);
+    TAC* last = func->func;
+    while (last && last->next) last = last->next;
+    if (!last || (strcmp(last->op, "return") != 0 && strcmp(last->op, "tailCall") != 0)) generateCReturn();
+    writerPrintf(&cWriter, "}\n");
+    currentFunc = NULL;
+}
+
+void generateC(TAC* tacInstructions, const SymbolTable* table, const char* outputFilename) {
+    if (!openOutputWriter(&cWriter, outputFilename)) {
+        perror("Failed to open output file");
+        exit(EXIT_FAILURE);
+    }
+
+    writerPrintf(&cWriter, "%s\n", cPrelude);
+    collectOperands(tacInstructions);
+    declareCData(table);
+    free(operandNames);
+    operandNames = NULL;
+    operandCount = 0;
+
+    writerPrintf(&cWriter, "\n");
+    for (FuncTAC* func = funcTacHeads; func; func = func->nextFunc) {
+        writerPrintf(&cWriter, "static %s %s(void);\n", cTypeName(func->returnType), func->funcName);
+    }
+
+    writerPrintf(&cWriter, "\nint main(void) {\n");
+    writerPrintf(&cWriter, "    static char cmm_outputBuffer[%d];\n", C_OUTPUT_BUFFER_SIZE);
+    writerPrintf(&cWriter, "    setvbuf(stdout, cmm_outputBuffer, _IOFBF, sizeof(cmm_outputBuffer));\n");
+    generateCList(tacInstructions);
+    writerPrintf(&cWriter, "    return 0;\n");
+    writerPrintf(&cWriter, "}\n");
+
+    for (FuncTAC* func = funcTacHeads; func; func = func->nextFunc) generateCFunction(func);
+
+    closeOutputWriter(&cWriter);
+    printf("C code generated and saved to file %s\n", outputFilename);
+}
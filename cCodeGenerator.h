@@ -0,0 +1,24 @@
+#ifndef C_CODE_GENERATOR_H
+#define C_CODE_GENERATOR_H
+
+#include "semantic.h"  // For TAC and FuncTAC definitions
+#include "symbolTable.h"
+
+// Memory layout follows the MIPS code: every variable, parameter and temp is a
+// static global, so recursive calls share them like they do on MIPS. Each TAC
+// becomes one C statement. Arguments are copied into locals as they are computed
+// and into the callee's parameters when the call is made; functions return their
+// value as C functions do. The program is self-contained and writes through a
+// fully buffered stdout.
+
+/**
+ * Generate a C99 program for the program, to be compiled by any C compiler:
+ *      gcc -O2 output.c -o program
+ *
+ * @param tacInstructions The main TAC list.
+ * @param table Symbol table holding the program's variables.
+ * @param outputFilename File to write, "-" for standard output.
+ */
+void generateC(TAC* tacInstructions, const SymbolTable* table, const char* outputFilename);
+
+#endif
@@ -1,13 +1,21 @@
 // codeGenerator.c
 #include "codeGenerator.h"
 #include "semantic.h" // For TAC and FuncTAC definitions
+#include "commons/options.h"
+#include "commons/outputWriter.h"
+#include "interpreter.h"  // For appendAsciizChar()
+#include "peephole.h"
+#include "scheduler.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 
 
-FILE* outputFile; // Global file pointer for output
+// The .asm file. Instructions are collected in textProgram one function at a time,
+// so they can be optimized and scheduled before being written here.
+OutputWriter asmWriter;
+MIPSProgram textProgram = {0};
 
 // Add prototypes at the top of the file or ensure they are included via codeGenerator.h
 void generateArrIntStore(TAC* current);
@@ -21,21 +29,287 @@ int constCount = 0;
 
 // Array of temporary registers for integers
 MIPSRegister tempIntRegisters[NUM_TEMP_REGISTERS] = {
-    {"$t0", false}, {"$t1", false}, {"$t2", false}, {"$t3", false},
-    {"$t4", false}, {"$t5", false}, {"$t6", false}, {"$t7", false},
-    {"$t8", false}, {"$t9", false}
+    {MIPS_T0, false}, {MIPS_T1, false}, {MIPS_T2, false}, {MIPS_T3, false},
+    {MIPS_T4, false}, {MIPS_T5, false}, {MIPS_T6, false}, {MIPS_T7, false},
+    {MIPS_T8, false}, {ARRAY_BASE_REGISTER, true}   // Reserved, see arrayElementOperand()
 };
 
 // Array of temporary registers for floats
 MIPSRegister tempFloatRegisters[NUM_TEMP_REGISTERS] = {
-    {"$f0", false}, {"$f1", false}, {"$f2", false}, {"$f3", false},
-    {"$f4", false}, {"$f5", false}, {"$f6", false}, {"$f7", false},
-    {"$f8", false}, {"$f9", false}
+    {MIPS_F(0), false}, {MIPS_F(1), false}, {MIPS_F(2), false}, {MIPS_F(3), false},
+    {MIPS_F(4), false}, {MIPS_F(5), false}, {MIPS_F(6), false}, {MIPS_F(7), false},
+    {MIPS_F(8), false}, {MIPS_F(9), false}
 };
 
+// Argument registers, in the order they are assigned
+const char* intArgRegisters[NUM_INT_ARG_REGISTERS] = {"$a0", "$a1", "$a2", "$a3"};
+const char* floatArgRegisters[NUM_FLOAT_ARG_REGISTERS] = {"$f12", "$f14"};
+
+// Size of the frame pushed by generateFuncStart() (saved $ra)
+#define FUNC_FRAME_SIZE 4
+
+// Frame layout of the function being generated
+//  Leaf functions never overwrite $ra, so they skip the frame entirely
+FuncTAC* currentFunc = NULL;
+bool currentFuncHasFrame = false;
+
+// Register arguments of the function being generated, and whether the argument
+// register still holds the parameter's value. While it does, parameter loads read
+// the register instead of the parameter variable.
+FuncParam* regParams[NUM_INT_ARG_REGISTERS + NUM_FLOAT_ARG_REGISTERS];
+bool regParamLive[NUM_INT_ARG_REGISTERS + NUM_FLOAT_ARG_REGISTERS];
+int regParamCount = 0;
+
+// Array whose base address ARRAY_BASE_REGISTER currently holds, NULL if none
+const char* cachedArrayBase = NULL;
+
+// Temps that never live in memory, so they get no .data slot: constants whose uses all take
+// the value as an immediate, and char loads forwarded into their only use
+char** foldedTemps = NULL;
+int foldedTempCount = 0;
+
+// Char temps still named by some TAC; the optimizer leaves the others unused
+bool* usedCharTemps = NULL;
+
+// Append an instruction to textProgram, with `comment` (NULL for none) after it
+//  The helpers below build the operands for each instruction shape.
+static void emitOperands(MIPSOpcode op, const char* comment, int operandCount, const MIPSOperand* operands) {
+    MIPSInstr instr = makeMIPSInstr(op);
+    for (int i = 0; i < operandCount; i++) instr.operands[i] = operands[i];
+    instr.operandCount = operandCount;
+    instr.comment = comment ? strdup(comment) : NULL;
+    appendMIPSInstr(&textProgram, instr);
+}
+
+// No operands, e.g. syscall
+static void emitOp(MIPSOpcode op, const char* comment) {
+    emitOperands(op, comment, 0, NULL);
+}
+
+// One register, e.g. mflo, jr
+static void emitR(MIPSOpcode op, int rd, const char* comment) {
+    MIPSOperand operands[] = {mipsRegister(rd)};
+    emitOperands(op, comment, 1, operands);
+}
+
+// Two registers, e.g. move, div, mtc1
+static void emitRR(MIPSOpcode op, int rd, int rs, const char* comment) {
+    MIPSOperand operands[] = {mipsRegister(rd), mipsRegister(rs)};
+    emitOperands(op, comment, 2, operands);
+}
+
+// Three registers, e.g. add, mul.s
+static void emitRRR(MIPSOpcode op, int rd, int rs, int rt, const char* comment) {
+    MIPSOperand operands[] = {mipsRegister(rd), mipsRegister(rs), mipsRegister(rt)};
+    emitOperands(op, comment, 3, operands);
+}
+
+// A register and an immediate: li
+static void emitRI(MIPSOpcode op, int rt, int value, const char* comment) {
+    MIPSOperand operands[] = {mipsRegister(rt), mipsImmediate(value)};
+    emitOperands(op, comment, 2, operands);
+}
+
+// Two registers and an immediate, e.g. addiu, sll
+static void emitRRI(MIPSOpcode op, int rt, int rs, int value, const char* comment) {
+    MIPSOperand operands[] = {mipsRegister(rt), mipsRegister(rs), mipsImmediate(value)};
+    emitOperands(op, comment, 3, operands);
+}
+
+// Load or store of `rt` at `address` (see dataOperand())
+static void emitMemory(MIPSOpcode op, int rt, MIPSOperand address, const char* comment) {
+    MIPSOperand operands[] = {mipsRegister(rt), address};
+    emitOperands(op, comment, 2, operands);
+}
+
+static void emitLa(int rt, const char* label, const char* comment) {
+    MIPSOperand operands[] = {mipsRegister(rt), mipsLabel(label)};
+    emitOperands(MIPSOp_La, comment, 2, operands);
+}
+
+// j or jal
+static void emitJump(MIPSOpcode op, const char* label, const char* comment) {
+    MIPSOperand operands[] = {mipsLabel(label)};
+    emitOperands(op, comment, 1, operands);
+}
+
+// Branch comparing `rs` with zero, e.g. beqz
+static void emitBranchZero(MIPSOpcode op, int rs, const char* label) {
+    MIPSOperand operands[] = {mipsRegister(rs), mipsLabel(label)};
+    emitOperands(op, NULL, 2, operands);
+}
+
+// Branch comparing `rs` with a register or an immediate, e.g. bne, blt
+static void emitBranch(MIPSOpcode op, int rs, MIPSOperand rt, const char* label) {
+    MIPSOperand operands[] = {mipsRegister(rs), rt, mipsLabel(label)};
+    emitOperands(op, NULL, 3, operands);
+}
+
+static void emitLabel(const char* label) {
+    MIPSInstr instr = makeMIPSInstr(MIPSOp_None);
+    instr.label = strdup(label);
+    appendMIPSInstr(&textProgram, instr);
+}
+
+// A line holding only `comment`, or a blank line for NULL
+static void emitComment(const char* comment) {
+    MIPSInstr instr = makeMIPSInstr(MIPSOp_None);
+    instr.comment = comment ? strdup(comment) : NULL;
+    appendMIPSInstr(&textProgram, instr);
+}
+
+// Register number of an argument register named in the TAC ("$a1", "$f14")
+static int argRegisterNumber(const char* name) {
+    for (int i = 0; i < NUM_INT_ARG_REGISTERS; i++) {
+        if (strcmp(intArgRegisters[i], name) == 0) return MIPS_A0 + i;
+    }
+    for (int i = 0; i < NUM_FLOAT_ARG_REGISTERS; i++) {
+        if (strcmp(floatArgRegisters[i], name) == 0) return MIPS_F(12 + 2 * i);
+    }
+    return -1;
+}
+
+// Find the TAC defining temp `name`, searching back from `current` (temps are only assigned once)
+static TAC* findTempDefinition(TAC* current, const char* name) {
+    for (TAC* def = current->prev; def; def = def->prev) {
+        if (def->result && strcmp(def->result, name) == 0) return def;
+    }
+    return NULL;
+}
+
+// Bytes variable or temp `name` takes in memory, 0 if it is neither
+static int dataObjectSize(const char* name) {
+    if ((name[0] == 'i' || name[0] == 'f' || name[0] == 'c') && name[1] && strspn(name + 1, "0123456789") == strlen(name + 1)) {
+        return (name[0] == 'c') ? 1 : 4;
+    }
+    for (int i = 0; i < constCount; i++) {
+        // Float constants are a word; string constants are only ever addressed with la
+        if (strcmp(dataConsts[i]->varName, name) == 0) return strcmp(dataConsts[i]->dataType, "float") == 0 ? 4 : 0;
+    }
+    Symbol* symbol = lookupSymbol(symTab, name);
+    if (!symbol) return 0;
+    int count = symbol->isArray ? symbol->arrSize : 1;
+    if (symbol->type == VarType_Char) {
+        return symbol->isArray ? count + 2 : 1;  // Char arrays are .asciiz with a trailing newline
+    } else if (symbol->type == VarType_Int || symbol->type == VarType_Float) {
+        return count * 4;
+    }
+    return 0;
+}
+
+// Does `name` live in the .sdata region addressed off $gp?
+static bool isSmallData(const char* name) {
+    if (options.smallDataLimit <= 0) return false;
+    int size = dataObjectSize(name);
+    return size > 0 && size <= options.smallDataLimit;
+}
+
+// Memory operand for byte `offset` of label `label`: a single $gp-relative access for
+// small data, otherwise the label itself, which the assembler expands to a full address.
+static MIPSOperand dataElementOperand(const char* label, int offset) {
+    return mipsMemory(label, offset, isSmallData(label) ? MIPS_GP : -1);
+}
+
+static MIPSOperand dataOperand(const char* name) {
+    return dataElementOperand(name, 0);
+}
+
+// Record that temp `name` never lives in memory
+static void markFoldedTemp(const char* name) {
+    foldedTemps = realloc(foldedTemps, (foldedTempCount + 1) * sizeof(char*));
+    foldedTemps[foldedTempCount++] = strdup(name);
+}
+
+bool isFoldedTemp(const char* name) {
+    for (int i = 0; i < foldedTempCount; i++) {
+        if (strcmp(foldedTemps[i], name) == 0) return true;
+    }
+    return false;
+}
+
+// The assign.char defining `name` if it is a constant char temp, else NULL
+static TAC* constantCharDef(TAC* current, const char* name) {
+    if (name[0] != 'c') return NULL;
+    TAC* def = findTempDefinition(current, name);
+    return (def && strcmp(def->op, "assign.char") == 0) ? def : NULL;
+}
+
+static bool isForwardedCharLoad(TAC* def);
+
+// The char load defining `name` if it is forwarded into `current` (see isForwardedCharLoad)
+static TAC* forwardedCharDef(TAC* current, const char* name) {
+    if (name[0] != 'c') return NULL;
+    TAC* def = current->prev;
+    return (def && def->result && strcmp(def->result, name) == 0 && isForwardedCharLoad(def)) ? def : NULL;
+}
+
+// Load char `name` into `reg`: an immediate for constant temps, straight from the source
+//  for forwarded loads, otherwise a direct lb
+static void loadCharValue(TAC* current, int reg, const char* name, const char* comment) {
+    TAC* def = constantCharDef(current, name);
+    if (def) {
+        emitRI(MIPSOp_Li, reg, (unsigned char)def->arg1[0], comment);
+    } else if ((def = forwardedCharDef(current, name)) && strcmp(def->op, "load.char") == 0) {
+        loadCharValue(def, reg, def->arg1, comment);
+    } else if (def) {
+        int addressRegIndex = allocateIntRegister();
+        if (addressRegIndex == -1) {
+            printf("Error: No available integer registers\n");
+            return;
+        }
+        MIPSOperand operand;
+        bool commented = arrayElementOperand(def, def->arg1, 1, addressRegIndex, comment, &operand);
+        emitMemory(MIPSOp_Lb, reg, operand, commented ? NULL : comment);
+        deallocateIntRegister(addressRegIndex);
+    } else {
+        emitMemory(MIPSOp_Lb, reg, dataOperand(name), comment);
+    }
+}
+
+// Is every use of this char temp one that loads its value through loadCharValue()?
+static bool isOnlyCharImmediate(TAC* def) {
+    for (TAC* use = def->next; use; use = use->next) {
+        if (use->arg2 && strcmp(use->arg2, def->result) == 0) return false;
+        if (use->arg1 && strcmp(use->arg1, def->result) == 0) {
+            if (strcmp(use->op, "store.char") != 0 && strcmp(use->op, "store.charIndex") != 0 && strcmp(use->op, "load.char") != 0
+                && strcmp(use->op, "write.char") != 0 && strcmp(use->op, "arg.char") != 0 && strcmp(use->op, "setReturn.char") != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Is `def` a char load (load.char or load.charIndex) whose only use is the very next TAC,
+//  through loadCharValue()? Nothing runs in between, so that use reads the char from the
+//  source itself and the temp is never stored (see loadCharValue).
+static bool isForwardedCharLoad(TAC* def) {
+    if (strcmp(def->op, "load.char") != 0 && strcmp(def->op, "load.charIndex") != 0) return false;
+    if (strcmp(def->op, "load.char") == 0 && liveArgRegister(def->arg1)) return false;
+    TAC* use = def->next;
+    if (!use || !use->arg1 || strcmp(use->arg1, def->result) != 0) return false;
+    for (TAC* later = use->next; later; later = later->next) {
+        if ((later->arg1 && strcmp(later->arg1, def->result) == 0) || (later->arg2 && strcmp(later->arg2, def->result) == 0)) {
+            return false;
+        }
+    }
+    return isOnlyCharImmediate(def);
+}
+
 // External declaration of funcTacHeads
 extern FuncTAC* funcTacHeads;
 
+static void markUsedCharTemps(TAC* tac) {
+    for (; tac; tac = tac->next) {
+        const char* names[3] = { tac->result, tac->arg1, tac->arg2 };
+        for (int i = 0; i < 3; i++) {
+            if (names[i] && dataObjectSize(names[i]) == 1 && atoi(names[i] + 1) < getTempCharCount()) {
+                usedCharTemps[atoi(names[i] + 1)] = true;
+            }
+        }
+    }
+}
+
 // Function prototypes for new functions
 void generateFunctionCall(TAC* current);
 void generateFuncStart(TAC* current);
@@ -44,26 +318,63 @@ void generateFunctionMIPS(FuncTAC* funcTac);
 
 // Initialize the code generator and open the file where the output will be saved
 void initCodeGenerator(const char* outputFilename) {
-    outputFile = fopen(outputFilename, "w"); // Open in write mode
-    if (outputFile == NULL) {
+    if (!openOutputWriter(&asmWriter, outputFilename)) {
         perror("Failed to open output file");
         exit(EXIT_FAILURE);
     }
 
     // Start the MIPS code
-    fprintf(outputFile, ".text\n");
-    fprintf(outputFile, ".globl main\n");
-    fprintf(outputFile, "main:\n");
+    writerPrintf(&asmWriter, ".text\n");
+    if (options.explicitDelaySlots) {
+        writerPrintf(&asmWriter, ".set noreorder\n");    // The scheduler fills every delay slot itself
+    }
+    writerPrintf(&asmWriter, ".globl main\n");
+
+    emitLabel("main");
+}
+
+// Clean up and schedule the function in textProgram, then write it to the .asm file
+//  Renaming temps relies on the allocator never keeping one live past the end of its
+//  TAC (see codeGenerator.h), so hand-written code that does must pass false.
+void emitFunctionText(bool renameTemps) {
+    int tempRegisters[2 * NUM_TEMP_REGISTERS];
+    int tempRegisterCount = 0;
+    if (renameTemps) {
+        for (int i = 0; i < NUM_TEMP_REGISTERS; i++) {
+            if (tempIntRegisters[i].number != ARRAY_BASE_REGISTER) {
+                tempRegisters[tempRegisterCount++] = tempIntRegisters[i].number;
+            }
+            if (tempFloatRegisters[i].number != MIPS_F(0)) {    // Also holds float return values
+                tempRegisters[tempRegisterCount++] = tempFloatRegisters[i].number;
+            }
+        }
+    }
+
+    runPeephole(&textProgram, tempRegisters, tempRegisterCount);
+    scheduleMIPS(&textProgram, tempRegisters, tempRegisterCount, options.explicitDelaySlots);
+    size_t length;
+    char* text = formatMIPSProgram(&textProgram, &length);
+    writerTakeChunk(&asmWriter, text, length);
+    freeMIPSProgram(&textProgram);
 }
 
 // Translate TAC instructions to MIPS assembly and output to a file
 void generateMIPS(TAC* tacInstructions, const SymbolTable* table) {
     TAC* current = tacInstructions;
+    cachedArrayBase = NULL;
+
+    usedCharTemps = calloc(getTempCharCount() + 1, sizeof(bool));
+    markUsedCharTemps(tacInstructions);
+    for (FuncTAC* func = funcTacHeads; func; func = func->nextFunc) markUsedCharTemps(func->func);
 
     while (current != NULL) {
         // Handle function-specific TACs
         if (strcmp(current->op, "functionCall") == 0) {
             generateFunctionCall(current);
+        } else if (strcmp(current->op, "reserveArgs") == 0) {
+            generateReserveArgs(current);
+        } else if (strncmp(current->op, "arg.", 4) == 0) {
+            generateArg(current);
         } else if (strcmp(current->op, "funcStart") == 0) {
             // funcStart is handled within generateFunctionMIPS
             // Skip here
@@ -108,6 +419,8 @@ void generateMIPS(TAC* tacInstructions, const SymbolTable* table) {
                 generateCharAssign(current);
             } else if (strcmp(current->op, "write.char") == 0) {
                 generateCharWrite(current);
+            } else if (strcmp(current->op, "write.charArray") == 0) {
+                generateCharArrayWrite(current);
             } else if (strcmp(current->op, "store.char") == 0) {
                 generateCharStore(current);
             } else if (strcmp(current->op, "load.char") == 0) {
@@ -128,19 +441,27 @@ void generateMIPS(TAC* tacInstructions, const SymbolTable* table) {
                 generateIntToFloat(current);
             } else if (strcmp(current->op, "floatToInt") == 0) {
                 generateFloatToInt(current);
+            } else if (strcmp(current->op, "write.string") == 0) {    //Coalesced output
+                generateStringWrite(current);
             }
             // Add more cases as needed
         }
+        updateArrayBaseCache(current);
         current = current->next;
     }
     //End of main, generate EXIT syscall
-    fprintf(outputFile, "\tli $v0, 10 #EXIT\n");
-    fprintf(outputFile, "\tsyscall\n");
+    if (options.bufferedOutput) {
+        emitJump(MIPSOp_Jal, "rt_flush", "FLUSH OUTPUT");
+    }
+    emitRI(MIPSOp_Li, MIPS_V0, 10, "EXIT");
+    emitOp(MIPSOp_Syscall, NULL);
+    emitFunctionText(true);
 
     // Generate MIPS code for functions after main
     FuncTAC* currentFunc = funcTacHeads;
     while (currentFunc != NULL) {
         generateFunctionMIPS(currentFunc);
+        emitFunctionText(true);
         currentFunc = currentFunc->nextFunc; // Correct member name
     }	
 }
@@ -148,45 +469,168 @@ void generateMIPS(TAC* tacInstructions, const SymbolTable* table) {
 // Finalize the code generation and close the output file
 void finalizeCodeGenerator(const char* outputFilename) {
     // Exit the program
-    // fprintf(outputFile, "\tli $v0, 10 #END\n");
-    // fprintf(outputFile, "\tsyscall\n");
+    // writerPrintf(&asmWriter, "\tli $v0, 10 #END\n");
+    // writerPrintf(&asmWriter, "\tsyscall\n");
+
+    if (options.bufferedOutput) {
+        generateOutputRuntime();
+        emitFunctionText(false);
+    }
 
     // Append data segment
-    fprintf(outputFile, "\n.data\n");
-    fprintf(outputFile, "   newline: .asciiz \"\\n\"\n");
-    fprintf(outputFile, "   returnInt: .word 0\n");
-    fprintf(outputFile, "   returnFloat: .float 0.0\n");
+    writerPrintf(&asmWriter, "\n.data\n");
+    writerPrintf(&asmWriter, "   newline: .asciiz \"\\n\"\n");
+    if (options.bufferedOutput) {
+        writerPrintf(&asmWriter, "   rt_length: .word 0\n");
+        writerPrintf(&asmWriter, "   rt_digits: .space 12\n");
+        writerPrintf(&asmWriter, "   rt_float_scale: .float 1000000.0\n");
+        writerPrintf(&asmWriter, "   rt_float_half: .float 0.5\n");
+        writerPrintf(&asmWriter, "   rt_buffer: .space %d\n", RT_BUFFER_SIZE);
+    }
 
     declareMipsVars(symTab);
-    printConstsToFile();
 
-    if (outputFile) {
-        fclose(outputFile);
-        printf("MIPS code generated and saved to file %s\n", outputFilename);
-        outputFile = NULL;
+    closeOutputWriter(&asmWriter);
+    printPeepholeStats();
+    printf("MIPS code generated and saved to file %s\n", outputFilename);
+}
+
+// Assign argument registers to a function's parameters
+//  Int/char arguments take the next free $a register and float arguments the next free
+//  float argument register. Once a register class runs out, arguments go on the stack.
+void assignArgLocations(Symbol* funcSymbol) {
+    int intArgCount = 0;
+    int floatArgCount = 0;
+    int stackOffset = 0;
+
+    for (FuncParam* param = funcSymbol->params; param; param = param->next) {
+        param->argRegister = NULL;
+        if (param->type == VarType_Float && floatArgCount < NUM_FLOAT_ARG_REGISTERS) {
+            param->argRegister = floatArgRegisters[floatArgCount++];
+        } else if (param->type != VarType_Float && intArgCount < NUM_INT_ARG_REGISTERS) {
+            param->argRegister = intArgRegisters[intArgCount++];
+        } else {
+            param->stackOffset = stackOffset;
+            stackOffset += 4;
+        }
     }
 }
 
 // Function to handle function calls
 void generateFunctionCall(TAC* current) {
     // Jump and link to the function label
-    fprintf(outputFile, "\tjal %s #FUNCTION CALL\n", current->arg1); // arg1 contains the function name with "_func" suffix
+    emitJump(MIPSOp_Jal, current->arg1, "FUNCTION CALL"); // arg1 contains the function name with "_func" suffix
+
+    // Release the outgoing argument area
+    if (current->arg2) {
+        emitRRI(MIPSOp_Addi, MIPS_SP, MIPS_SP, atoi(current->arg2), NULL);
+    }
+
+    // Copy the return value out of $v0/$f0
+    if (current->result) {
+        FuncTAC* callee = findFuncTAC(current->arg1);
+        switch (callee->returnType) {
+            case (VarType_Float):
+                emitMemory(MIPSOp_SS, MIPS_F(0), dataOperand(current->result), NULL);
+                break;
+            case (VarType_Char):
+                emitMemory(MIPSOp_Sb, MIPS_V0, dataOperand(current->result), NULL);
+                break;
+            default:
+                emitMemory(MIPSOp_Sw, MIPS_V0, dataOperand(current->result), NULL);
+                break;
+        }
+    }
+}
+
+// Reserve the outgoing argument area for arguments passed on the stack
+void generateReserveArgs(TAC* current) {
+    emitRRI(MIPSOp_Addi, MIPS_SP, MIPS_SP, -atoi(current->arg1), "RESERVE ARGS");
+}
+
+// Pass an argument to a function
+//  arg2 holds either the argument register or the offset into the outgoing argument area
+void generateArg(TAC* current) {
+    bool isFloat = (strcmp(current->op, "arg.float") == 0);
+    bool isChar = (strcmp(current->op, "arg.char") == 0);
+
+    if (current->arg2[0] == '$') {
+        // Load straight into the argument register
+        if (isFloat) {
+            emitMemory(MIPSOp_LS, argRegisterNumber(current->arg2), dataOperand(current->arg1), "PASS ARG");
+        } else if (isChar) {
+            loadCharValue(current, argRegisterNumber(current->arg2), current->arg1, "PASS ARG");
+        } else {
+            emitMemory(MIPSOp_Lw, argRegisterNumber(current->arg2), dataOperand(current->arg1), "PASS ARG");
+        }
+        return;
+    }
+
+    int regIndex = allocateIntRegister();
+    if (regIndex == -1) {
+        printf("Error: No available integer registers\n");
+        return;
+    }
+
+    // Copy the raw word into the stack slot (floats don't need an FPU register for this)
+    if (isChar) {
+        loadCharValue(current, tempIntRegisters[regIndex].number, current->arg1, "PASS ARG (STACK)");
+    } else {
+        emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex].number, dataOperand(current->arg1), "PASS ARG (STACK)");
+    }
+    emitMemory(MIPSOp_Sw, tempIntRegisters[regIndex].number, mipsMemory(NULL, atoi(current->arg2), MIPS_SP), NULL);
+
+    deallocateIntRegister(regIndex);
+}
+
+// Place a function's return value in $v0/$f0
+void generateSetReturn(TAC* current) {
+    if (strcmp(current->op, "setReturn.float") == 0) {
+        emitMemory(MIPSOp_LS, MIPS_F(0), dataOperand(current->arg1), "SET RETURN VALUE");
+    } else if (strcmp(current->op, "setReturn.char") == 0) {
+        loadCharValue(current, MIPS_V0, current->arg1, "SET RETURN VALUE");
+    } else {
+        emitMemory(MIPSOp_Lw, MIPS_V0, dataOperand(current->arg1), "SET RETURN VALUE");
+    }
 }
 
 // Function to handle function definitions
 void generateFunctionMIPS(FuncTAC* funcTac) {
     // Print the function label
-    fprintf(outputFile, "%s:\n", funcTac->funcName);
+    emitLabel(funcTac->funcName);
 
     TAC* current = funcTac->func; // Correct member name
 
+    currentFunc = funcTac;
+    currentFuncHasFrame = funcNeedsFrame(funcTac);
+    cachedArrayBase = NULL;
+
+    // Track which parameters can be read straight from their argument register
+    regParamCount = 0;
+    for (FuncParam* param = funcTac->params; param; param = param->next) {
+        if (param->argRegister) {
+            regParams[regParamCount] = param;
+            regParamLive[regParamCount] = true;
+            regParamCount++;
+        }
+    }
+
     while (current != NULL) {
         if (strcmp(current->op, "funcStart") == 0) {
             generateFuncStart(current);
+            generateParamSpills(funcTac);
         } else if (strcmp(current->op, "return") == 0) {
             generateReturn(current);
-        }else if (strcmp(current->op, "functionCall") == 0) {
+        } else if (strcmp(current->op, "functionCall") == 0) {
             generateFunctionCall(current);
+        } else if (strcmp(current->op, "tailCall") == 0) {
+            generateTailCall(current);
+        } else if (strcmp(current->op, "reserveArgs") == 0) {
+            generateReserveArgs(current);
+        } else if (strncmp(current->op, "arg.", 4) == 0) {
+            generateArg(current);
+        } else if (strncmp(current->op, "setReturn.", 10) == 0) {
+            generateSetReturn(current);
         } else {
             // Handle other TAC instructions within the function
             if (strcmp(current->op, "assign.int") == 0) {   //Int operations
@@ -225,6 +669,8 @@ void generateFunctionMIPS(FuncTAC* funcTac) {
                 generateCharAssign(current);
             } else if (strcmp(current->op, "write.char") == 0) {
                 generateCharWrite(current);
+            } else if (strcmp(current->op, "write.charArray") == 0) {
+                generateCharArrayWrite(current);
             } else if (strcmp(current->op, "store.char") == 0) {
                 generateCharStore(current);
             } else if (strcmp(current->op, "load.char") == 0) {
@@ -237,31 +683,178 @@ void generateFunctionMIPS(FuncTAC* funcTac) {
                 generateArrFloatStore(current);
             } else if (strcmp(current->op, "load.floatIndex") == 0) {
                 generateArrFloatLoad(current);
+            } else if (strcmp(current->op, "store.charIndex") == 0) {
+                generateArrCharStore(current);
+            } else if (strcmp(current->op, "load.charIndex") == 0) {
+                generateArrCharLoad(current);
             } else if (strcmp(current->op, "intToFloat") == 0) {    //Type conversion operators
                 generateIntToFloat(current);
             } else if (strcmp(current->op, "floatToInt") == 0) {
                 generateFloatToInt(current);
+            } else if (strcmp(current->op, "write.string") == 0) {    //Coalesced output
+                generateStringWrite(current);
             }
             // Add more cases as needed
         }
+        updateArgRegisterState(current);
+        updateArrayBaseCache(current);
         current = current->next;
     }
+    regParamCount = 0;
+    currentFunc = NULL;
+}
+
+// Does the function need a stack frame? Only calls overwrite $ra, so leaf functions
+// can run frameless and return straight through it. Tail calls jump with $ra intact,
+// so they don't need one either. With buffered output, writes call into the runtime.
+bool funcNeedsFrame(FuncTAC* funcTac) {
+    for (TAC* current = funcTac->func; current; current = current->next) {
+        if (strcmp(current->op, "functionCall") == 0) return true;
+        if (options.bufferedOutput && strncmp(current->op, "write.", 6) == 0) return true;
+    }
+    return false;
+}
+
+// Does this TAC overwrite the given argument register?
+bool clobbersArgRegister(TAC* current, const char* reg) {
+    if (strcmp(current->op, "functionCall") == 0 || strcmp(current->op, "tailCall") == 0) {
+        return true;    // Argument registers are caller-saved
+    }
+    if (strncmp(current->op, "arg.", 4) == 0) {
+        return strcmp(current->arg2, reg) == 0;
+    }
+    if (strncmp(current->op, "write.", 6) == 0) {
+        // Every write passes its value and the newline string in $a0 (floats in $f12)
+        if (strcmp(reg, "$a0") == 0) return true;
+        return (strcmp(current->op, "write.float") == 0) && (strcmp(reg, "$f12") == 0);
+    }
+    return false;
+}
+
+// Keep regParamLive up to date after generating `current`
+void updateArgRegisterState(TAC* current) {
+    for (int i = 0; i < regParamCount; i++) {
+        if (!regParamLive[i]) continue;
+        if (clobbersArgRegister(current, regParams[i]->argRegister)) {
+            regParamLive[i] = false;
+        } else if (current->result && strncmp(current->op, "store.", 6) == 0 && strcmp(current->result, regParams[i]->name) == 0) {
+            regParamLive[i] = false;    // Parameter was reassigned, its variable is now the only copy
+        }
+    }
+}
+
+// Returns the argument register holding variable `varName`, or NULL if it must be read from memory
+const char* liveArgRegister(const char* varName) {
+    for (int i = 0; i < regParamCount; i++) {
+        if (regParamLive[i] && strcmp(regParams[i]->name, varName) == 0) {
+            return regParams[i]->argRegister;
+        }
+    }
+    return NULL;
+}
+
+// Does the parameter ever have to be read from its variable? True if it is loaded
+// after its argument register has been clobbered (and before it is reassigned), or, for
+// a stack parameter, if it is loaded at all.
+bool paramNeedsSpill(FuncTAC* funcTac, FuncParam* param) {
+    if (!param->argRegister) {
+        for (TAC* current = funcTac->func; current; current = current->next) {
+            if (strncmp(current->op, "load.", 5) == 0 && strcmp(current->arg1, param->name) == 0) return true;
+        }
+        return false;
+    }
+
+    for (TAC* current = funcTac->func; current; current = current->next) {
+        if (current->result && strncmp(current->op, "store.", 6) == 0 && strcmp(current->result, param->name) == 0) {
+            return false;   // Later reads see the new value in memory
+        }
+        if (clobbersArgRegister(current, param->argRegister)) {
+            for (TAC* later = current->next; later; later = later->next) {
+                if (strncmp(later->op, "load.", 5) == 0 && strcmp(later->arg1, param->name) == 0) return true;
+                if (later->result && strncmp(later->op, "store.", 6) == 0 && strcmp(later->result, param->name) == 0) return false;
+            }
+            return false;
+        }
+    }
+    return false;
 }
 
 // Function to handle the start of a function
 void generateFuncStart(TAC* current) {
+    if (!currentFuncHasFrame) return; // Leaf function, $ra is never overwritten
+
     // Push the return address onto the stack
-    fprintf(outputFile, "\taddi $sp, $sp, -4 #FUNCTION START\n");
-    fprintf(outputFile, "\tsw $ra, 0($sp)\n");
+    emitRRI(MIPSOp_Addi, MIPS_SP, MIPS_SP, -FUNC_FRAME_SIZE, "FUNCTION START");
+    emitMemory(MIPSOp_Sw, MIPS_RA, mipsMemory(NULL, 0, MIPS_SP), NULL);
+}
+
+// Copy incoming arguments into the function's parameter variables
+//  Must run right after the prologue, before anything (e.g. a write syscall) clobbers $a0
+void generateParamSpills(FuncTAC* funcTac) {
+    for (FuncParam* param = funcTac->params; param; param = param->next) {
+        if (!paramNeedsSpill(funcTac, param)) continue;
+
+        if (param->argRegister) {
+            if (param->type == VarType_Float) {
+                emitMemory(MIPSOp_SS, argRegisterNumber(param->argRegister), dataOperand(param->name), "RECEIVE ARG");
+            } else {
+                emitMemory((param->type == VarType_Char) ? MIPSOp_Sb : MIPSOp_Sw, argRegisterNumber(param->argRegister), dataOperand(param->name), "RECEIVE ARG");
+            }
+            continue;
+        }
+
+        int regIndex = allocateIntRegister();
+        if (regIndex == -1) {
+            printf("Error: No available integer registers\n");
+            return;
+        }
+        // Stack arguments sit above our own frame
+        int offset = param->stackOffset + (currentFuncHasFrame ? FUNC_FRAME_SIZE : 0);
+        emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex].number, mipsMemory(NULL, offset, MIPS_SP), "RECEIVE ARG (STACK)");
+        emitMemory((param->type == VarType_Char) ? MIPSOp_Sb : MIPSOp_Sw, tempIntRegisters[regIndex].number, dataOperand(param->name), NULL);
+        deallocateIntRegister(regIndex);
+    }
+}
+
+// Jump to a function in place of calling it and then returning
+//  Our frame is popped first, so the callee returns straight to our caller with $ra
+//  untouched. Tail calls never take stack arguments (see lowerTailCalls).
+void generateTailCall(TAC* current) {
+    if (currentFuncHasFrame) {
+        emitMemory(MIPSOp_Lw, MIPS_RA, mipsMemory(NULL, 0, MIPS_SP), "TAIL CALL");
+        emitRRI(MIPSOp_Addi, MIPS_SP, MIPS_SP, FUNC_FRAME_SIZE, NULL);
+        emitJump(MIPSOp_J, current->arg1, NULL);
+    } else {
+        emitJump(MIPSOp_J, current->arg1, "TAIL CALL");
+    }
 }
 
 // Function to handle function returns
+//  Only the function's last return carries the epilogue, earlier returns jump to it
 void generateReturn(TAC* current) {
+    // Nothing after a tail call runs, unless this is the shared epilogue other returns jump to
+    if (current->prev && strcmp(current->prev->op, "tailCall") == 0 && (!currentFuncHasFrame || current->next)) {
+        return;
+    }
+
+    if (!currentFuncHasFrame) {
+        emitR(MIPSOp_Jr, MIPS_RA, "RETURN");
+        return;
+    }
+
+    char epilogue[300];
+    snprintf(epilogue, sizeof(epilogue), "%s_epilogue", currentFunc->funcName);
+    if (current->next) {
+        emitJump(MIPSOp_J, epilogue, "RETURN");
+        return;
+    }
+
     // Pop the return address from the stack
-    fprintf(outputFile, "\tlw $ra, 0($sp) #RETURN\n");
-    fprintf(outputFile, "\taddi $sp, $sp, 4\n");
+    emitLabel(epilogue);
+    emitMemory(MIPSOp_Lw, MIPS_RA, mipsMemory(NULL, 0, MIPS_SP), "RETURN");
+    emitRRI(MIPSOp_Addi, MIPS_SP, MIPS_SP, FUNC_FRAME_SIZE, NULL);
     // Return to the caller
-    fprintf(outputFile, "\tjr $ra\n");
+    emitR(MIPSOp_Jr, MIPS_RA, NULL);
 }
 
 // --- Existing functions for integer and float operations go here ---
@@ -287,17 +880,14 @@ void generateIntAddition(TAC* current) {
     }
 
     // Load operands
-    fprintf(outputFile, "\tlw %s, %s #ADD INT\n", tempIntRegisters[regIndex1].name, current->arg1);
-    fprintf(outputFile, "\tlw %s, %s\n", tempIntRegisters[regIndex2].name, current->arg2);
+    emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex1].number, dataOperand(current->arg1), "ADD INT");
+    emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex2].number, dataOperand(current->arg2), NULL);
 
     // Perform addition
-    fprintf(outputFile, "\tadd %s, %s, %s\n",
-            tempIntRegisters[regIndex1].name,
-            tempIntRegisters[regIndex1].name,
-            tempIntRegisters[regIndex2].name);
+    emitRRR(MIPSOp_Add, tempIntRegisters[regIndex1].number, tempIntRegisters[regIndex1].number, tempIntRegisters[regIndex2].number, NULL);
 
     // Store result
-    fprintf(outputFile, "\tsw %s, %s\n", tempIntRegisters[regIndex1].name, current->result);
+    emitMemory(MIPSOp_Sw, tempIntRegisters[regIndex1].number, dataOperand(current->result), NULL);
 
     // Deallocate registers
     deallocateIntRegister(regIndex1);
@@ -342,6 +932,10 @@ void deallocateFloatRegister(int regIndex) {
 
 // Create a const to be included at the end of the MIPS file
 DataElement* createConst(const char* type, const char* contents) {
+    if (constCount >= MAX_CONSTS) {
+        fprintf(stderr, "Error: Too many constants (limit %d)\n", MAX_CONSTS);
+        exit(1);
+    }
     dataConsts[constCount] = malloc(sizeof(DataElement));
     dataConsts[constCount]->dataType = strdup(type);
     dataConsts[constCount]->contents = strdup(contents);
@@ -354,40 +948,63 @@ DataElement* createConst(const char* type, const char* contents) {
     return dataConsts[constCount - 1];
 }
 
-// Print constants to the output file
-void printConstsToFile() {
+// Print the constants that do (smallData) or don't live in .sdata to the output file
+void printConstsToFile(bool smallData) {
     for (int i = 0; i < constCount; i++) {
-        fprintf(outputFile, "\t%s: .%s %s\n",
+        if (isSmallData(dataConsts[i]->varName) != smallData) continue;
+        writerPrintf(&asmWriter, "\t%s: .%s %s\n",
                 dataConsts[i]->varName,
                 dataConsts[i]->dataType,
                 dataConsts[i]->contents);
     }
 }
 
-// Declare variables in MIPS
-void declareMipsVars(const SymbolTable* table) {
+// Declare the variables and temps that do (smallData) or don't live in .sdata
+//  Variables start out zeroed (chars as 'U') unless the optimizer gave them a static
+//  initial value (see hoistStaticInitializers)
+static void declareDataObjects(const SymbolTable* table, bool smallData) {
     for (int i = 0; i < 100; i++) {
         Symbol* current = table->table[i];
         while (current) {
-            char* repeatToken = NULL;
+            if (isSmallData(current->name) != smallData) {
+                current = current->next;
+                continue;
+            }
+            int count = current->isArray ? current->arrSize : 1;
             switch (current->type)
             {
                 case (VarType_Int):
-                    fprintf(outputFile, "\t%s: .word 0", current->name);
-                    if (current->isArray) repeatToken = ", 0";
+                    writerPrintf(&asmWriter, "\t%s: .word ", current->name);
+                    for (int j = 0; j < count; j++) {
+                        const char* initValue = getInitValue(current, j);
+                        writerPrintf(&asmWriter, "%s%s", (j > 0) ? ", " : "", initValue ? initValue : "0");
+                    }
                     break;
                 
                 case (VarType_Float):
-                    fprintf(outputFile, "\t%s: .float 0.0", current->name);
-                    if (current->isArray) repeatToken = ", 0.0";
+                    writerPrintf(&asmWriter, "\t%s: .float ", current->name);
+                    for (int j = 0; j < count; j++) {
+                        const char* initValue = getInitValue(current, j);
+                        writerPrintf(&asmWriter, "%s%s", (j > 0) ? ", " : "", initValue ? initValue : "0.0");
+                    }
                     break;
 
                 case (VarType_Char):
                     if (current->isArray) {
-                        fprintf(outputFile, "\t%s: .asciiz \"U", current->name);
-                        repeatToken = "U";
+                        // Written whole by write.charArray, so the newline follows the elements
+                        char literal[8];
+                        writerPrintf(&asmWriter, "\t%s: .asciiz \"", current->name);
+                        for (int j = 0; j < count; j++) {
+                            const char* initValue = getInitValue(current, j);
+                            literal[0] = '\0';
+                            appendAsciizChar(literal, sizeof(literal), initValue ? initValue[0] : 'U');
+                            writerPrintf(&asmWriter, "%s", literal);
+                        }
+                        writerPrintf(&asmWriter, "\\n\""); //Special case: close quotations on string
+                    } else if (getInitValue(current, 0)) {
+                        writerPrintf(&asmWriter, "\t%s: .byte %d", current->name, getInitValue(current, 0)[0]);
                     } else {
-                        fprintf(outputFile, "\t%s: .byte 'U'", current->name);
+                        writerPrintf(&asmWriter, "\t%s: .byte 'U'", current->name);
                     }
                     break;
                 
@@ -395,37 +1012,52 @@ void declareMipsVars(const SymbolTable* table) {
                     printf("Invalid VarType in declareMipsVars(): %s\n",varTypeToString(current->type));
                     break;
             }
-            
-            if (current->isArray) {
-                for (int j = 1; j < current->arrSize; j++) {
-                    fprintf(outputFile, "%s", repeatToken);
-                }
-                if (current->type == VarType_Char) { //Special case: close quotations on string
-                    fprintf(outputFile, "\"");
-                }
-            }
-            fprintf(outputFile, "\n");
+            writerPrintf(&asmWriter, "\n");
             current = current->next;
         }
     }
-    // Declare temporary variables
+    // Declare temporary variables, except folded temps and char temps no TAC names any more
+    char tempName[20];
     for (int i = 0; i < getTempIntCount(); i++) {
-        fprintf(outputFile, "\ti%d: .word 0\n", i);
+        snprintf(tempName, 20, "i%d", i);
+        if (!isFoldedTemp(tempName) && isSmallData(tempName) == smallData) writerPrintf(&asmWriter, "\t%s: .word 0\n", tempName);
     }
     for (int i = 0; i < getTempFloatCount(); i++) {
-        fprintf(outputFile, "\tf%d: .float 0.0\n", i);
+        snprintf(tempName, 20, "f%d", i);
+        if (isSmallData(tempName) == smallData) writerPrintf(&asmWriter, "\t%s: .float 0.0\n", tempName);
     }
     for (int i = 0; i < getTempCharCount(); i++) {
-        fprintf(outputFile, "\tc%d: .byte 0\n", i);
+        snprintf(tempName, 20, "c%d", i);
+        if (usedCharTemps[i] && !isFoldedTemp(tempName) && isSmallData(tempName) == smallData) writerPrintf(&asmWriter, "\t%s: .byte 0\n", tempName);
     }
 }
 
+// Declare every variable, temp and constant
+//  With --small-data, objects up to the size limit go in .sdata, where dataOperand()
+//  reaches them with one $gp-relative instruction; the rest stay in .data.
+void declareMipsVars(const SymbolTable* table) {
+    if (options.smallDataLimit > 0) {
+        writerPrintf(&asmWriter, "\n.sdata\n");
+        declareDataObjects(table, true);
+        printConstsToFile(true);
+        writerPrintf(&asmWriter, "\n.data\n");
+    }
+    declareDataObjects(table, false);
+    printConstsToFile(false);
+}
+
 // --- Include your existing functions for array operations, float operations, etc. ---
 
 // Example: Integer Assignment
 void generateIntAssign(TAC* current) {
     int regIndex;
 
+    // Constant array indices are folded into the accesses' addresses
+    if (isOnlyConstantIndex(current)) {
+        markFoldedTemp(current->result);
+        return;
+    }
+
     regIndex = allocateIntRegister();
     if (regIndex == -1) {
         printf("Error: No available registers\n");
@@ -433,10 +1065,10 @@ void generateIntAssign(TAC* current) {
     }
 
     // Load immediate value
-    fprintf(outputFile, "\tli %s, %s #ASSIGN INT VALUE\n", tempIntRegisters[regIndex].name, current->arg1);
+    emitRI(MIPSOp_Li, tempIntRegisters[regIndex].number, atoi(current->arg1), "ASSIGN INT VALUE");
 
     // Store the value into the result variable
-    fprintf(outputFile, "\tsw %s, %s\n", tempIntRegisters[regIndex].name, current->result);
+    emitMemory(MIPSOp_Sw, tempIntRegisters[regIndex].number, dataOperand(current->result), NULL);
 
     deallocateIntRegister(regIndex);
 }
@@ -458,20 +1090,14 @@ void generateIntSubtraction(TAC* current) {
     }
 
     // Load operands
-    fprintf(outputFile, "\tlw %s, %s #SUBTRACT INT\n",
-            tempIntRegisters[regIndex1].name, current->arg1);
-    fprintf(outputFile, "\tlw %s, %s\n",
-            tempIntRegisters[regIndex2].name, current->arg2);
+    emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex1].number, dataOperand(current->arg1), "SUBTRACT INT");
+    emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex2].number, dataOperand(current->arg2), NULL);
 
     // Perform subtraction
-    fprintf(outputFile, "\tsub %s, %s, %s\n",
-            tempIntRegisters[regIndex1].name,
-            tempIntRegisters[regIndex1].name,
-            tempIntRegisters[regIndex2].name);
+    emitRRR(MIPSOp_Sub, tempIntRegisters[regIndex1].number, tempIntRegisters[regIndex1].number, tempIntRegisters[regIndex2].number, NULL);
 
     // Store result
-    fprintf(outputFile, "\tsw %s, %s\n",
-            tempIntRegisters[regIndex1].name, current->result);
+    emitMemory(MIPSOp_Sw, tempIntRegisters[regIndex1].number, dataOperand(current->result), NULL);
 
     // Deallocate registers
     deallocateIntRegister(regIndex1);
@@ -493,20 +1119,14 @@ void generateIntMultiplication(TAC* current) {
     }
 
     // Load operands
-    fprintf(outputFile, "\tlw %s, %s #MULTIPLY INT\n",
-            tempIntRegisters[regIndex1].name, current->arg1);
-    fprintf(outputFile, "\tlw %s, %s\n",
-            tempIntRegisters[regIndex2].name, current->arg2);
+    emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex1].number, dataOperand(current->arg1), "MULTIPLY INT");
+    emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex2].number, dataOperand(current->arg2), NULL);
 
     // Perform multiplication
-    fprintf(outputFile, "\tmul %s, %s, %s\n",
-            tempIntRegisters[regIndex1].name,
-            tempIntRegisters[regIndex1].name,
-            tempIntRegisters[regIndex2].name);
+    emitRRR(MIPSOp_Mul, tempIntRegisters[regIndex1].number, tempIntRegisters[regIndex1].number, tempIntRegisters[regIndex2].number, NULL);
 
     // Store result
-    fprintf(outputFile, "\tsw %s, %s\n",
-            tempIntRegisters[regIndex1].name, current->result);
+    emitMemory(MIPSOp_Sw, tempIntRegisters[regIndex1].number, dataOperand(current->result), NULL);
 
     // Deallocate registers
     deallocateIntRegister(regIndex1);
@@ -528,21 +1148,17 @@ void generateIntDivision(TAC* current) {
     }
 
     // Load operands
-    fprintf(outputFile, "\tlw %s, %s #DIVIDE INT\n",
-            tempIntRegisters[regIndex1].name, current->arg1);
-    fprintf(outputFile, "\tlw %s, %s\n",
-            tempIntRegisters[regIndex2].name, current->arg2);
+    emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex1].number, dataOperand(current->arg1), "DIVIDE INT");
+    emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex2].number, dataOperand(current->arg2), NULL);
 
     // Perform division
-    fprintf(outputFile, "\tdiv %s, %s\n",
-            tempIntRegisters[regIndex1].name, tempIntRegisters[regIndex2].name);
+    emitRR(MIPSOp_Div, tempIntRegisters[regIndex1].number, tempIntRegisters[regIndex2].number, NULL);
 
     // Move the quotient to the destination register
-    fprintf(outputFile, "\tmflo %s\n", tempIntRegisters[regIndex1].name);
+    emitR(MIPSOp_Mflo, tempIntRegisters[regIndex1].number, NULL);
 
     // Store result
-    fprintf(outputFile, "\tsw %s, %s\n",
-            tempIntRegisters[regIndex1].name, current->result);
+    emitMemory(MIPSOp_Sw, tempIntRegisters[regIndex1].number, dataOperand(current->result), NULL);
 
     // Deallocate registers
     deallocateIntRegister(regIndex1);
@@ -564,20 +1180,14 @@ void generateFloatAddition(TAC* current) {
     }
 
     // Load operands
-    fprintf(outputFile, "\tl.s %s, %s #ADD FLOAT\n",
-            tempFloatRegisters[regIndex1].name, current->arg1);
-    fprintf(outputFile, "\tl.s %s, %s\n",
-            tempFloatRegisters[regIndex2].name, current->arg2);
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex1].number, dataOperand(current->arg1), "ADD FLOAT");
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex2].number, dataOperand(current->arg2), NULL);
 
     // Perform addition
-    fprintf(outputFile, "\tadd.s %s, %s, %s\n",
-            tempFloatRegisters[regIndex1].name,
-            tempFloatRegisters[regIndex1].name,
-            tempFloatRegisters[regIndex2].name);
+    emitRRR(MIPSOp_AddS, tempFloatRegisters[regIndex1].number, tempFloatRegisters[regIndex1].number, tempFloatRegisters[regIndex2].number, NULL);
 
     // Store result
-    fprintf(outputFile, "\ts.s %s, %s\n",
-            tempFloatRegisters[regIndex1].name, current->result);
+    emitMemory(MIPSOp_SS, tempFloatRegisters[regIndex1].number, dataOperand(current->result), NULL);
 
     // Deallocate registers
     deallocateFloatRegister(regIndex1);
@@ -599,20 +1209,14 @@ void generateFloatSubtraction(TAC* current) {
     }
 
     // Load operands
-    fprintf(outputFile, "\tl.s %s, %s #SUBTRACT FLOAT\n",
-            tempFloatRegisters[regIndex1].name, current->arg1);
-    fprintf(outputFile, "\tl.s %s, %s\n",
-            tempFloatRegisters[regIndex2].name, current->arg2);
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex1].number, dataOperand(current->arg1), "SUBTRACT FLOAT");
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex2].number, dataOperand(current->arg2), NULL);
 
     // Perform subtraction
-    fprintf(outputFile, "\tsub.s %s, %s, %s\n",
-            tempFloatRegisters[regIndex1].name,
-            tempFloatRegisters[regIndex1].name,
-            tempFloatRegisters[regIndex2].name);
+    emitRRR(MIPSOp_SubS, tempFloatRegisters[regIndex1].number, tempFloatRegisters[regIndex1].number, tempFloatRegisters[regIndex2].number, NULL);
 
     // Store result
-    fprintf(outputFile, "\ts.s %s, %s\n",
-            tempFloatRegisters[regIndex1].name, current->result);
+    emitMemory(MIPSOp_SS, tempFloatRegisters[regIndex1].number, dataOperand(current->result), NULL);
 
     // Deallocate registers
     deallocateFloatRegister(regIndex1);
@@ -634,20 +1238,14 @@ void generateFloatMultiplication(TAC* current) {
     }
 
     // Load operands
-    fprintf(outputFile, "\tl.s %s, %s #MULTIPLY FLOAT\n",
-            tempFloatRegisters[regIndex1].name, current->arg1);
-    fprintf(outputFile, "\tl.s %s, %s\n",
-            tempFloatRegisters[regIndex2].name, current->arg2);
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex1].number, dataOperand(current->arg1), "MULTIPLY FLOAT");
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex2].number, dataOperand(current->arg2), NULL);
 
     // Perform multiplication
-    fprintf(outputFile, "\tmul.s %s, %s, %s\n",
-            tempFloatRegisters[regIndex1].name,
-            tempFloatRegisters[regIndex1].name,
-            tempFloatRegisters[regIndex2].name);
+    emitRRR(MIPSOp_MulS, tempFloatRegisters[regIndex1].number, tempFloatRegisters[regIndex1].number, tempFloatRegisters[regIndex2].number, NULL);
 
     // Store result
-    fprintf(outputFile, "\ts.s %s, %s\n",
-            tempFloatRegisters[regIndex1].name, current->result);
+    emitMemory(MIPSOp_SS, tempFloatRegisters[regIndex1].number, dataOperand(current->result), NULL);
 
     // Deallocate registers
     deallocateFloatRegister(regIndex1);
@@ -669,20 +1267,14 @@ void generateFloatDivision(TAC* current) {
     }
 
     // Load operands
-    fprintf(outputFile, "\tl.s %s, %s #DIVIDE FLOAT\n",
-            tempFloatRegisters[regIndex1].name, current->arg1);
-    fprintf(outputFile, "\tl.s %s, %s\n",
-            tempFloatRegisters[regIndex2].name, current->arg2);
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex1].number, dataOperand(current->arg1), "DIVIDE FLOAT");
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex2].number, dataOperand(current->arg2), NULL);
 
     // Perform division
-    fprintf(outputFile, "\tdiv.s %s, %s, %s\n",
-            tempFloatRegisters[regIndex1].name,
-            tempFloatRegisters[regIndex1].name,
-            tempFloatRegisters[regIndex2].name);
+    emitRRR(MIPSOp_DivS, tempFloatRegisters[regIndex1].number, tempFloatRegisters[regIndex1].number, tempFloatRegisters[regIndex2].number, NULL);
 
     // Store result
-    fprintf(outputFile, "\ts.s %s, %s\n",
-            tempFloatRegisters[regIndex1].name, current->result);
+    emitMemory(MIPSOp_SS, tempFloatRegisters[regIndex1].number, dataOperand(current->result), NULL);
 
     // Deallocate registers
     deallocateFloatRegister(regIndex1);
@@ -703,20 +1295,23 @@ void generateIntWrite(TAC* current) {
     }
 
     // Load the value to print
-    fprintf(outputFile, "\tlw %s, %s #WRITE INT\n",
-            tempIntRegisters[regIndex].name, current->arg1);
+    emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex].number, dataOperand(current->arg1), "WRITE INT");
 
     // Move the value to $a0
-    fprintf(outputFile, "\tmove $a0, %s\n", tempIntRegisters[regIndex].name);
-
-    // Print integer syscall
-    fprintf(outputFile, "\tli $v0, 1\n");
-    fprintf(outputFile, "\tsyscall\n");
-
-    // Print newline
-    fprintf(outputFile, "\tli $v0, 4\n");
-    fprintf(outputFile, "\tla $a0, newline\n");
-    fprintf(outputFile, "\tsyscall\n");
+    emitRR(MIPSOp_Move, MIPS_A0, tempIntRegisters[regIndex].number, NULL);
+
+    if (options.bufferedOutput) {
+        emitJump(MIPSOp_Jal, "rt_write_int", NULL);
+    } else {
+        // Print integer syscall
+        emitRI(MIPSOp_Li, MIPS_V0, 1, NULL);
+        emitOp(MIPSOp_Syscall, NULL);
+
+        // Print newline
+        emitRI(MIPSOp_Li, MIPS_V0, 4, NULL);
+        emitLa(MIPS_A0, "newline", NULL);
+        emitOp(MIPSOp_Syscall, NULL);
+    }
 
     // Deallocate register
     deallocateIntRegister(regIndex);
@@ -736,20 +1331,23 @@ void generateFloatWrite(TAC* current) {
     }
 
     // Load the value to print
-    fprintf(outputFile, "\tl.s %s, %s #WRITE FLOAT\n",
-            tempFloatRegisters[regIndex].name, current->arg1);
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex].number, dataOperand(current->arg1), "WRITE FLOAT");
 
     // Move the value to $f12
-    fprintf(outputFile, "\tmov.s $f12, %s\n", tempFloatRegisters[regIndex].name);
-
-    // Print float syscall
-    fprintf(outputFile, "\tli $v0, 2\n");
-    fprintf(outputFile, "\tsyscall\n");
-
-    // Print newline
-    fprintf(outputFile, "\tli $v0, 4\n");
-    fprintf(outputFile, "\tla $a0, newline\n");
-    fprintf(outputFile, "\tsyscall\n");
+    emitRR(MIPSOp_MovS, MIPS_F(12), tempFloatRegisters[regIndex].number, NULL);
+
+    if (options.bufferedOutput) {
+        emitJump(MIPSOp_Jal, "rt_write_float", NULL);
+    } else {
+        // Print float syscall
+        emitRI(MIPSOp_Li, MIPS_V0, 2, NULL);
+        emitOp(MIPSOp_Syscall, NULL);
+
+        // Print newline
+        emitRI(MIPSOp_Li, MIPS_V0, 4, NULL);
+        emitLa(MIPS_A0, "newline", NULL);
+        emitOp(MIPSOp_Syscall, NULL);
+    }
 
     // Deallocate register
     deallocateFloatRegister(regIndex);
@@ -769,12 +1367,10 @@ void generateIntStore(TAC* current) {
     }
 
     // Load value from source
-    fprintf(outputFile, "\tlw %s, %s #STORE INT\n",
-            tempIntRegisters[regIndex].name, current->arg1);
+    emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex].number, dataOperand(current->arg1), "STORE INT");
 
     // Store the value into the destination variable
-    fprintf(outputFile, "\tsw %s, %s\n",
-            tempIntRegisters[regIndex].name, current->result);
+    emitMemory(MIPSOp_Sw, tempIntRegisters[regIndex].number, dataOperand(current->result), NULL);
 
     // Deallocate register
     deallocateIntRegister(regIndex);
@@ -784,6 +1380,13 @@ void generateIntStore(TAC* current) {
 void generateIntLoad(TAC* current) {
     int regIndex;
 
+    // Parameter still in its argument register
+    const char* argRegister = liveArgRegister(current->arg1);
+    if (argRegister) {
+        emitMemory(MIPSOp_Sw, argRegisterNumber(argRegister), dataOperand(current->result), "LOAD INT");
+        return;
+    }
+
     // Allocate register
     regIndex = allocateIntRegister();
 
@@ -794,12 +1397,10 @@ void generateIntLoad(TAC* current) {
     }
 
     // Load value from variable
-    fprintf(outputFile, "\tlw %s, %s #LOAD INT\n",
-            tempIntRegisters[regIndex].name, current->arg1);
+    emitMemory(MIPSOp_Lw, tempIntRegisters[regIndex].number, dataOperand(current->arg1), "LOAD INT");
 
     // Store the value into the temporary variable
-    fprintf(outputFile, "\tsw %s, %s\n",
-            tempIntRegisters[regIndex].name, current->result);
+    emitMemory(MIPSOp_Sw, tempIntRegisters[regIndex].number, dataOperand(current->result), NULL);
 
     // Deallocate register
     deallocateIntRegister(regIndex);
@@ -819,12 +1420,10 @@ void generateFloatStore(TAC* current) {
     }
 
     // Load value from source
-    fprintf(outputFile, "\tl.s %s, %s #STORE FLOAT\n",
-            tempFloatRegisters[regIndex].name, current->arg1);
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex].number, dataOperand(current->arg1), "STORE FLOAT");
 
     // Store the value into the destination variable
-    fprintf(outputFile, "\ts.s %s, %s\n",
-            tempFloatRegisters[regIndex].name, current->result);
+    emitMemory(MIPSOp_SS, tempFloatRegisters[regIndex].number, dataOperand(current->result), NULL);
 
     // Deallocate register
     deallocateFloatRegister(regIndex);
@@ -834,6 +1433,13 @@ void generateFloatStore(TAC* current) {
 void generateFloatLoad(TAC* current) {
     int regIndex;
 
+    // Parameter still in its argument register
+    const char* argRegister = liveArgRegister(current->arg1);
+    if (argRegister) {
+        emitMemory(MIPSOp_SS, argRegisterNumber(argRegister), dataOperand(current->result), "LOAD FLOAT");
+        return;
+    }
+
     // Allocate register
     regIndex = allocateFloatRegister();
 
@@ -844,12 +1450,10 @@ void generateFloatLoad(TAC* current) {
     }
 
     // Load value from variable
-    fprintf(outputFile, "\tl.s %s, %s #LOAD FLOAT\n",
-            tempFloatRegisters[regIndex].name, current->arg1);
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex].number, dataOperand(current->arg1), "LOAD FLOAT");
 
     // Store the value into the temporary variable
-    fprintf(outputFile, "\ts.s %s, %s\n",
-            tempFloatRegisters[regIndex].name, current->result);
+    emitMemory(MIPSOp_SS, tempFloatRegisters[regIndex].number, dataOperand(current->result), NULL);
 
     // Deallocate register
     deallocateFloatRegister(regIndex);
@@ -858,85 +1462,73 @@ void generateFloatLoad(TAC* current) {
 // Char Assign
 void generateCharAssign(TAC* current) {
     int regIndex;
-    int addrRegIndex;
 
-    // Allocate register
-    regIndex = allocateIntRegister();
-
-    // Error checking
-    if (regIndex == -1) {
-        printf("Error: No available int registers\n");
+    // Users load the char as an immediate, so it never has to be stored
+    if (isOnlyCharImmediate(current)) {
+        markFoldedTemp(current->result);
         return;
     }
 
-    addrRegIndex = allocateIntRegister();
+    // Allocate register
+    regIndex = allocateIntRegister();
 
     // Error checking
-    if (addrRegIndex == -1) {
+    if (regIndex == -1) {
         printf("Error: No available int registers\n");
         return;
     }
 
-
-    int asciiValue = current->arg1[0]; //Get numerical ascii value of char
+    int asciiValue = (unsigned char)current->arg1[0]; //Get numerical ascii value of char
     // Load immediate value
-    fprintf(outputFile, "\tli %s, %d #ASSIGN CHAR VALUE\n", tempIntRegisters[regIndex].name, asciiValue);
-
-    // Load char address
-    fprintf(outputFile, "\tla %s, %s\n", tempIntRegisters[addrRegIndex].name, current->result);
+    emitRI(MIPSOp_Li, tempIntRegisters[regIndex].number, asciiValue, "ASSIGN CHAR VALUE");
 
     // Store the value into the result variable
-    fprintf(outputFile, "\tsb %s, 0(%s)\n", tempIntRegisters[regIndex].name, tempIntRegisters[addrRegIndex].name);
-
+    emitMemory(MIPSOp_Sb, tempIntRegisters[regIndex].number, dataOperand(current->result), NULL);
 
     // Deallocate register
     deallocateIntRegister(regIndex);
-    deallocateIntRegister(addrRegIndex);
 }
 
 
 // Char Load
 void generateCharLoad(TAC* current) {
     int regIndex;
-    int addrRegIndex;
 
-    // Allocate register
-    regIndex = allocateIntRegister();
+    // The next TAC loads the char from the source itself
+    if (isForwardedCharLoad(current)) {
+        markFoldedTemp(current->result);
+        return;
+    }
 
-    // Error checking
-    if (regIndex == -1) {
-        printf("Error: No available integer registers\n");
+    // Parameter still in its argument register
+    const char* argRegister = liveArgRegister(current->arg1);
+    if (argRegister) {
+        emitMemory(MIPSOp_Sb, argRegisterNumber(argRegister), dataOperand(current->result), "LOAD CHAR");
         return;
     }
 
-    addrRegIndex = allocateIntRegister();
+    // Allocate register
+    regIndex = allocateIntRegister();
 
     // Error checking
-    if (addrRegIndex == -1) {
-        printf("Error: No available int registers\n");
+    if (regIndex == -1) {
+        printf("Error: No available integer registers\n");
         return;
     }
 
     // Load value from variable
-    fprintf(outputFile, "\tlb %s, %s #LOAD CHAR\n",
-            tempIntRegisters[regIndex].name, current->arg1);
-
-    // Load char address
-    fprintf(outputFile, "\tla %s, %s\n", tempIntRegisters[addrRegIndex].name, current->result);
+    loadCharValue(current, tempIntRegisters[regIndex].number, current->arg1, "LOAD CHAR");
 
     // Store the value into the temporary variable
-    fprintf(outputFile, "\tsb %s, 0(%s)\n",
-            tempIntRegisters[regIndex].name, tempIntRegisters[addrRegIndex].name);
+    emitMemory(MIPSOp_Sb, tempIntRegisters[regIndex].number, dataOperand(current->result), NULL);
 
     // Deallocate register
     deallocateIntRegister(regIndex);
-    deallocateIntRegister(addrRegIndex);
 }
 
 // Char Store
 void generateCharStore(TAC* current) {
     int regIndex;
-    int addrRegIndex;
 
     // Allocate register
     regIndex = allocateIntRegister();
@@ -947,395 +1539,474 @@ void generateCharStore(TAC* current) {
         return;
     }
 
-    addrRegIndex = allocateIntRegister();
-
-    // Error checking
-    if (addrRegIndex == -1) {
-        printf("Error: No available int registers\n");
-        return;
-    }
-
     // Load value from source
-    fprintf(outputFile, "\tlb %s, %s #STORE CHAR\n",
-            tempIntRegisters[regIndex].name, current->arg1);
-
-    // Load char address
-    fprintf(outputFile, "\tla %s, %s\n", tempIntRegisters[addrRegIndex].name, current->result);
+    loadCharValue(current, tempIntRegisters[regIndex].number, current->arg1, "STORE CHAR");
 
     // Store the value into the destination variable
-    fprintf(outputFile, "\tsb %s, 0(%s)\n",
-            tempIntRegisters[regIndex].name, tempIntRegisters[addrRegIndex].name);
+    emitMemory(MIPSOp_Sb, tempIntRegisters[regIndex].number, dataOperand(current->result), NULL);
 
     // Deallocate register
     deallocateIntRegister(regIndex);
-    deallocateIntRegister(addrRegIndex);
 }
 
 // Char Write
-void generateCharWrite(TAC* current) {
-    int regIndex;
-    int addrRegIndex;
-
-    // Allocate register
-    regIndex = allocateIntRegister();
-
-    // Error checking
-    if (regIndex == -1) {
-        printf("Error: No available integer registers\n");
-        return;
+// Print a string literal with one syscall
+//  arg1 holds the literal, already escaped for .asciiz (see coalesceWrites)
+void generateStringWrite(TAC* current) {
+    char* quoted = malloc(strlen(current->arg1) + 3);
+    sprintf(quoted, "\"%s\"", current->arg1);
+    DataElement* stringConst = createConst("asciiz", quoted);
+    free(quoted);
+
+    emitLa(MIPS_A0, stringConst->varName, "WRITE STRING");
+    if (options.bufferedOutput) {
+        emitJump(MIPSOp_Jal, "rt_write_string", NULL);
+    } else {
+        emitRI(MIPSOp_Li, MIPS_V0, 4, NULL);
+        emitOp(MIPSOp_Syscall, NULL);
     }
+}
 
-    addrRegIndex = allocateIntRegister();
+// Output runtime used by --buffered-output
+//      Writes format their value and newline into rt_buffer, which is printed with a
+//  single print-string syscall when it fills up and once more before the program exits.
+//  The routines only touch $a0, $v0, $t0-$t9 and $f0-$f2, so like a syscall they leave
+//  the other argument registers intact. Each saves $ra in $t9 so it can call helpers.
+//      Floats are printed with up to six fraction digits ("2.5", "3.0"). Values of 2^31
+//  and above (and inf/NaN) fall back to the print-float syscall.
+void generateOutputRuntime() {
+    emitComment(NULL);
+    emitComment("OUTPUT RUNTIME");
+
+    // $t0 = next free byte, flushing first if a value might not fit
+    emitLabel("rt_reserve");
+    emitMemory(MIPSOp_Lw, MIPS_T1, dataOperand("rt_length"), NULL);
+    emitLa(MIPS_T0, "rt_buffer", NULL);
+    emitBranch(MIPSOp_Bge, MIPS_T1, mipsImmediate(RT_BUFFER_SIZE - RT_MAX_VALUE_LENGTH), "rt_flush");
+    emitRRR(MIPSOp_Addu, MIPS_T0, MIPS_T0, MIPS_T1, NULL);
+    emitR(MIPSOp_Jr, MIPS_RA, NULL);
+
+    // Print and empty the buffer, leaving $t0 = buffer start. Keeps $a0.
+    emitLabel("rt_flush");
+    emitMemory(MIPSOp_Lw, MIPS_T1, dataOperand("rt_length"), NULL);
+    emitLa(MIPS_T0, "rt_buffer", NULL);
+    emitBranchZero(MIPSOp_Beqz, MIPS_T1, "rt_flush_done");
+    emitRRR(MIPSOp_Addu, MIPS_T1, MIPS_T0, MIPS_T1, NULL);
+    emitMemory(MIPSOp_Sb, MIPS_ZERO, mipsMemory(NULL, 0, MIPS_T1), NULL);
+    emitRR(MIPSOp_Move, MIPS_T1, MIPS_A0, NULL);
+    emitRR(MIPSOp_Move, MIPS_A0, MIPS_T0, NULL);
+    emitRI(MIPSOp_Li, MIPS_V0, 4, NULL);
+    emitOp(MIPSOp_Syscall, NULL);
+    emitRR(MIPSOp_Move, MIPS_A0, MIPS_T1, NULL);
+    emitMemory(MIPSOp_Sw, MIPS_ZERO, dataOperand("rt_length"), NULL);
+    emitLabel("rt_flush_done");
+    emitR(MIPSOp_Jr, MIPS_RA, NULL);
+
+    // Terminate the value at $t0 with a newline, update the length and return to the writer
+    emitLabel("rt_end_line");
+    emitRI(MIPSOp_Li, MIPS_T3, 10, NULL);
+    emitMemory(MIPSOp_Sb, MIPS_T3, mipsMemory(NULL, 0, MIPS_T0), NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_T0, MIPS_T0, 1, NULL);
+    emitLa(MIPS_T1, "rt_buffer", NULL);
+    emitRRR(MIPSOp_Subu, MIPS_T1, MIPS_T0, MIPS_T1, NULL);
+    emitMemory(MIPSOp_Sw, MIPS_T1, dataOperand("rt_length"), NULL);
+    emitR(MIPSOp_Jr, MIPS_T9, NULL);
+
+    // Digits of $t2 (taken as -|value| so INT_MIN needs no special case) at $t0
+    emitLabel("rt_put_digits");
+    emitLa(MIPS_T4, "rt_digits", NULL);
+    emitRI(MIPSOp_Li, MIPS_T5, 10, NULL);
+    emitLabel("rt_put_digits_next");      // Lowest digit first
+    emitRR(MIPSOp_Div, MIPS_T2, MIPS_T5, NULL);
+    emitR(MIPSOp_Mflo, MIPS_T2, NULL);
+    emitR(MIPSOp_Mfhi, MIPS_T3, NULL);
+    emitRRR(MIPSOp_Subu, MIPS_T3, MIPS_ZERO, MIPS_T3, NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_T3, MIPS_T3, 48, NULL);
+    emitMemory(MIPSOp_Sb, MIPS_T3, mipsMemory(NULL, 0, MIPS_T4), NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_T4, MIPS_T4, 1, NULL);
+    emitBranchZero(MIPSOp_Bnez, MIPS_T2, "rt_put_digits_next");
+    emitLa(MIPS_T5, "rt_digits", NULL);
+    emitLabel("rt_put_digits_copy");      // Then copy them back in order
+    emitRRI(MIPSOp_Addiu, MIPS_T4, MIPS_T4, -1, NULL);
+    emitMemory(MIPSOp_Lb, MIPS_T3, mipsMemory(NULL, 0, MIPS_T4), NULL);
+    emitMemory(MIPSOp_Sb, MIPS_T3, mipsMemory(NULL, 0, MIPS_T0), NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_T0, MIPS_T0, 1, NULL);
+    emitBranch(MIPSOp_Bne, MIPS_T4, mipsRegister(MIPS_T5), "rt_put_digits_copy");
+    emitR(MIPSOp_Jr, MIPS_RA, NULL);
+
+    // write.int: value in $a0
+    emitLabel("rt_write_int");
+    emitRR(MIPSOp_Move, MIPS_T9, MIPS_RA, NULL);
+    emitJump(MIPSOp_Jal, "rt_reserve", NULL);
+    emitRR(MIPSOp_Move, MIPS_T2, MIPS_A0, NULL);
+    emitBranchZero(MIPSOp_Bltz, MIPS_T2, "rt_write_int_sign");
+    emitRRR(MIPSOp_Subu, MIPS_T2, MIPS_ZERO, MIPS_T2, NULL);
+    emitJump(MIPSOp_J, "rt_write_int_digits", NULL);
+    emitLabel("rt_write_int_sign");
+    emitRI(MIPSOp_Li, MIPS_T3, 45, NULL);
+    emitMemory(MIPSOp_Sb, MIPS_T3, mipsMemory(NULL, 0, MIPS_T0), NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_T0, MIPS_T0, 1, NULL);
+    emitLabel("rt_write_int_digits");
+    emitJump(MIPSOp_Jal, "rt_put_digits", NULL);
+    emitJump(MIPSOp_J, "rt_end_line", NULL);
+
+    // write.char: character in $a0
+    emitLabel("rt_write_char");
+    emitRR(MIPSOp_Move, MIPS_T9, MIPS_RA, NULL);
+    emitJump(MIPSOp_Jal, "rt_reserve", NULL);
+    emitMemory(MIPSOp_Sb, MIPS_A0, mipsMemory(NULL, 0, MIPS_T0), NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_T0, MIPS_T0, 1, NULL);
+    emitJump(MIPSOp_J, "rt_end_line", NULL);
+
+    // write.float: value in $f12
+    emitLabel("rt_write_float");
+    emitRR(MIPSOp_Move, MIPS_T9, MIPS_RA, NULL);
+    emitRR(MIPSOp_Mfc1, MIPS_T2, MIPS_F(12), NULL);
+    emitRRI(MIPSOp_Sll, MIPS_T3, MIPS_T2, 1, NULL);              // Bits of |value|, which order like the values
+    emitRRI(MIPSOp_Srl, MIPS_T3, MIPS_T3, 1, NULL);
+    emitRI(MIPSOp_Li, MIPS_T4, 0x4f000000, "2^31 AS FLOAT BITS");
+    emitBranch(MIPSOp_Bge, MIPS_T3, mipsRegister(MIPS_T4), "rt_write_float_large");
+    emitJump(MIPSOp_Jal, "rt_reserve", NULL);
+    emitRR(MIPSOp_MovS, MIPS_F(0), MIPS_F(12), NULL);
+    emitBranchZero(MIPSOp_Bgez, MIPS_T2, "rt_write_float_digits");
+    emitRR(MIPSOp_NegS, MIPS_F(0), MIPS_F(12), NULL);
+    emitRI(MIPSOp_Li, MIPS_T3, 45, NULL);
+    emitMemory(MIPSOp_Sb, MIPS_T3, mipsMemory(NULL, 0, MIPS_T0), NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_T0, MIPS_T0, 1, NULL);
+    emitLabel("rt_write_float_digits");
+    emitRR(MIPSOp_TruncWS, MIPS_F(1), MIPS_F(0), NULL);           // Integer part
+    emitRR(MIPSOp_Mfc1, MIPS_T2, MIPS_F(1), NULL);
+    emitRR(MIPSOp_CvtSW, MIPS_F(1), MIPS_F(1), NULL);
+    emitRRR(MIPSOp_SubS, MIPS_F(1), MIPS_F(0), MIPS_F(1), NULL);          // Fraction, rounded to six digits
+    emitMemory(MIPSOp_LS, MIPS_F(2), dataOperand("rt_float_scale"), NULL);
+    emitRRR(MIPSOp_MulS, MIPS_F(1), MIPS_F(1), MIPS_F(2), NULL);
+    emitMemory(MIPSOp_LS, MIPS_F(2), dataOperand("rt_float_half"), NULL);
+    emitRRR(MIPSOp_AddS, MIPS_F(1), MIPS_F(1), MIPS_F(2), NULL);
+    emitRR(MIPSOp_TruncWS, MIPS_F(1), MIPS_F(1), NULL);
+    emitRR(MIPSOp_Mfc1, MIPS_T6, MIPS_F(1), NULL);
+    emitRI(MIPSOp_Li, MIPS_T5, 1000000, NULL);
+    emitBranch(MIPSOp_Blt, MIPS_T6, mipsRegister(MIPS_T5), "rt_write_float_whole");
+    emitRRI(MIPSOp_Addiu, MIPS_T2, MIPS_T2, 1, NULL);            // Fraction rounded up to 1
+    emitRI(MIPSOp_Li, MIPS_T6, 0, NULL);
+    emitLabel("rt_write_float_whole");
+    emitRRR(MIPSOp_Subu, MIPS_T2, MIPS_ZERO, MIPS_T2, NULL);
+    emitJump(MIPSOp_Jal, "rt_put_digits", NULL);
+    emitRI(MIPSOp_Li, MIPS_T3, 46, NULL);
+    emitMemory(MIPSOp_Sb, MIPS_T3, mipsMemory(NULL, 0, MIPS_T0), NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_T0, MIPS_T0, 1, NULL);
+    emitRI(MIPSOp_Li, MIPS_T5, 100000, NULL);
+    emitRI(MIPSOp_Li, MIPS_T7, 10, NULL);
+    emitLabel("rt_write_float_fraction");        // At least one digit, no trailing zeros
+    emitRR(MIPSOp_Div, MIPS_T6, MIPS_T5, NULL);
+    emitR(MIPSOp_Mflo, MIPS_T3, NULL);
+    emitR(MIPSOp_Mfhi, MIPS_T6, NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_T3, MIPS_T3, 48, NULL);
+    emitMemory(MIPSOp_Sb, MIPS_T3, mipsMemory(NULL, 0, MIPS_T0), NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_T0, MIPS_T0, 1, NULL);
+    emitRR(MIPSOp_Div, MIPS_T5, MIPS_T7, NULL);
+    emitR(MIPSOp_Mflo, MIPS_T5, NULL);
+    emitBranchZero(MIPSOp_Beqz, MIPS_T6, "rt_end_line");
+    emitBranchZero(MIPSOp_Bnez, MIPS_T5, "rt_write_float_fraction");
+    emitJump(MIPSOp_J, "rt_end_line", NULL);
+    emitLabel("rt_write_float_large");
+    emitJump(MIPSOp_Jal, "rt_flush", NULL);
+    emitRI(MIPSOp_Li, MIPS_V0, 2, NULL);
+    emitOp(MIPSOp_Syscall, NULL);
+    emitJump(MIPSOp_J, "rt_end_line", NULL);
+
+    // write.string: address of the literal in $a0, newlines already included
+    emitLabel("rt_write_string");
+    emitRR(MIPSOp_Move, MIPS_T9, MIPS_RA, NULL);
+    emitMemory(MIPSOp_Lw, MIPS_T1, dataOperand("rt_length"), NULL);
+    emitLabel("rt_write_string_next");
+    emitMemory(MIPSOp_Lb, MIPS_T3, mipsMemory(NULL, 0, MIPS_A0), NULL);
+    emitBranchZero(MIPSOp_Beqz, MIPS_T3, "rt_write_string_done");
+    emitBranch(MIPSOp_Blt, MIPS_T1, mipsImmediate(RT_BUFFER_SIZE - 1), "rt_write_string_room");
+    emitMemory(MIPSOp_Sw, MIPS_T1, dataOperand("rt_length"), NULL);
+    emitJump(MIPSOp_Jal, "rt_flush", NULL);
+    emitRI(MIPSOp_Li, MIPS_T1, 0, NULL);
+    emitLabel("rt_write_string_room");
+    emitLa(MIPS_T0, "rt_buffer", NULL);
+    emitRRR(MIPSOp_Addu, MIPS_T0, MIPS_T0, MIPS_T1, NULL);
+    emitMemory(MIPSOp_Sb, MIPS_T3, mipsMemory(NULL, 0, MIPS_T0), NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_T1, MIPS_T1, 1, NULL);
+    emitRRI(MIPSOp_Addiu, MIPS_A0, MIPS_A0, 1, NULL);
+    emitJump(MIPSOp_J, "rt_write_string_next", NULL);
+    emitLabel("rt_write_string_done");
+    emitMemory(MIPSOp_Sw, MIPS_T1, dataOperand("rt_length"), NULL);
+    emitR(MIPSOp_Jr, MIPS_T9, NULL);
+}
 
-    // Error checking
-    if (addrRegIndex == -1) {
-        printf("Error: No available int registers\n");
-        return;
+// Print a whole char array with one syscall
+//  declareMipsVars() ends char arrays with a newline, so it is printed along with the elements
+void generateCharArrayWrite(TAC* current) {
+    emitLa(MIPS_A0, current->arg1, "WRITE CHAR ARRAY");
+    if (options.bufferedOutput) {
+        emitJump(MIPSOp_Jal, "rt_write_string", NULL);
+    } else {
+        emitRI(MIPSOp_Li, MIPS_V0, 4, NULL);
+        emitOp(MIPSOp_Syscall, NULL);
     }
+}
 
+void generateCharWrite(TAC* current) {
+    // Load the value to print straight into $a0
+    loadCharValue(current, MIPS_A0, current->arg1, "WRITE CHAR");
+
+    if (options.bufferedOutput) {
+        emitJump(MIPSOp_Jal, "rt_write_char", NULL);
+    } else {
+        // Print integer syscall
+        emitRI(MIPSOp_Li, MIPS_V0, 11, NULL);
+        emitOp(MIPSOp_Syscall, NULL);
+
+        // Print newline
+        emitRI(MIPSOp_Li, MIPS_V0, 4, NULL);
+        emitLa(MIPS_A0, "newline", NULL);
+        emitOp(MIPSOp_Syscall, NULL);
+    }
+}
 
-    // Load char address
-    fprintf(outputFile, "\tla %s, %s #WRITE CHAR\n", tempIntRegisters[addrRegIndex].name, current->arg1);
-
-    // Load the value to print
-    fprintf(outputFile, "\tlb %s, 0(%s)\n",
-            tempIntRegisters[regIndex].name, tempIntRegisters[addrRegIndex].name);
+// Is the index of an array access a constant? Sets `index` if so.
+static bool constantArrayIndex(TAC* current, int* index) {
+    TAC* def = findTempDefinition(current, current->arg2);
+    if (!def || strcmp(def->op, "assign.int") != 0) return false;
+    *index = atoi(def->arg1);
+    return true;
+}
 
-    // Move the value to $a0
-    fprintf(outputFile, "\tmove $a0, %s\n", tempIntRegisters[regIndex].name);
+// Is this int assign only ever used as the index of array accesses? They all fold it
+// into their address, so it never has to be stored.
+bool isOnlyConstantIndex(TAC* def) {
+    bool used = false;
+    for (TAC* use = def->next; use; use = use->next) {
+        bool isArg1 = use->arg1 && strcmp(use->arg1, def->result) == 0;
+        bool isArg2 = use->arg2 && strcmp(use->arg2, def->result) == 0;
+        if (isArg1 || (isArg2 && !strstr(use->op, "Index"))) return false;
+        if (isArg2) used = true;
+    }
+    return used;
+}
 
-    // Print integer syscall
-    fprintf(outputFile, "\tli $v0, 11\n");
-    fprintf(outputFile, "\tsyscall\n");
+// Forget the cached array base address when a TAC clobbers ARRAY_BASE_REGISTER
+//  Callees, and the output runtime's routines, may use every temp register
+void updateArrayBaseCache(TAC* current) {
+    if (strcmp(current->op, "functionCall") == 0 || strcmp(current->op, "tailCall") == 0) {
+        cachedArrayBase = NULL;
+    } else if (options.bufferedOutput && strncmp(current->op, "write.", 6) == 0) {
+        cachedArrayBase = NULL;
+    }
+}
 
-    // Print newline
-    fprintf(outputFile, "\tli $v0, 4\n");
-    fprintf(outputFile, "\tla $a0, newline\n");
-    fprintf(outputFile, "\tsyscall\n");
+// Memory operand of element `current->arg2` of `arrayName`, written into `operand`
+//  Constant indices fold into the label ("arr_var+12"), so no code is needed. Otherwise
+//  the element's address is computed into `addressRegIndex` from the array's base address,
+//  which stays in ARRAY_BASE_REGISTER for later accesses to the same array.
+//  `comment` goes on the first instruction; returns false if none was emitted.
+bool arrayElementOperand(TAC* current, const char* arrayName, int elementSize, int addressRegIndex, const char* comment, MIPSOperand* operand) {
+    int index;
+    if (constantArrayIndex(current, &index)) {
+        *operand = dataElementOperand(arrayName, index * elementSize);
+        return false;
+    }
 
-    // Deallocate register
-    deallocateIntRegister(regIndex);
-    deallocateIntRegister(addrRegIndex);
+    int addressReg = tempIntRegisters[addressRegIndex].number;
+    emitMemory(MIPSOp_Lw, addressReg, dataOperand(current->arg2), comment);
+    if (elementSize == 4) {
+        emitRRI(MIPSOp_Sll, addressReg, addressReg, 2, NULL);
+    }
+    if (!cachedArrayBase || strcmp(cachedArrayBase, arrayName) != 0) {
+        emitLa(ARRAY_BASE_REGISTER, arrayName, NULL);
+        cachedArrayBase = arrayName;
+    }
+    emitRRR(MIPSOp_Add, addressReg, ARRAY_BASE_REGISTER, addressReg, NULL);
+    *operand = mipsMemory(NULL, 0, addressReg);
+    return true;
 }
 
 // Array Integer Store
 void generateArrIntStore(TAC* current) {
-    int baseRegIndex, indexRegIndex, valueRegIndex, addressRegIndex;
+    int valueRegIndex, addressRegIndex;
+    MIPSOperand operand;
 
     // Allocate registers
-    baseRegIndex = allocateIntRegister();
-    indexRegIndex = allocateIntRegister();
     valueRegIndex = allocateIntRegister();
     addressRegIndex = allocateIntRegister();
 
     // Error checking
-    if (baseRegIndex == -1 || indexRegIndex == -1 ||
-        valueRegIndex == -1 || addressRegIndex == -1) {
+    if (valueRegIndex == -1 || addressRegIndex == -1) {
         printf("Error: No available integer registers\n");
         return;
     }
 
-    // Load base address of array
-    fprintf(outputFile, "\tla %s, %s #STORE INTO INT ARRAY\n",
-            tempIntRegisters[baseRegIndex].name, current->result);
-
-    // Load index
-    fprintf(outputFile, "\tlw %s, %s\n",
-            tempIntRegisters[indexRegIndex].name, current->arg2);
-
-    // Calculate offset (index * 4)
-    fprintf(outputFile, "\tsll %s, %s, 2\n",
-            tempIntRegisters[indexRegIndex].name, tempIntRegisters[indexRegIndex].name);
-
-    // Calculate address (base + offset)
-    fprintf(outputFile, "\tadd %s, %s, %s\n",
-            tempIntRegisters[addressRegIndex].name,
-            tempIntRegisters[baseRegIndex].name,
-            tempIntRegisters[indexRegIndex].name);
+    // Element address (or label+offset for a constant index)
+    bool commented = arrayElementOperand(current, current->result, 4, addressRegIndex, "STORE INTO INT ARRAY", &operand);
 
     // Load value to store
-    fprintf(outputFile, "\tlw %s, %s\n",
-            tempIntRegisters[valueRegIndex].name, current->arg1);
+    emitMemory(MIPSOp_Lw, tempIntRegisters[valueRegIndex].number, dataOperand(current->arg1), commented ? NULL : "STORE INTO INT ARRAY");
 
     // Store value into array
-    fprintf(outputFile, "\tsw %s, 0(%s)\n",
-            tempIntRegisters[valueRegIndex].name, tempIntRegisters[addressRegIndex].name);
+    emitMemory(MIPSOp_Sw, tempIntRegisters[valueRegIndex].number, operand, NULL);
 
     // Deallocate registers
-    deallocateIntRegister(baseRegIndex);
-    deallocateIntRegister(indexRegIndex);
     deallocateIntRegister(valueRegIndex);
     deallocateIntRegister(addressRegIndex);
 }
 
 // Array Integer Load
 void generateArrIntLoad(TAC* current) {
-    int baseRegIndex, indexRegIndex, valueRegIndex, addressRegIndex;
+    int valueRegIndex, addressRegIndex;
+    MIPSOperand operand;
 
     // Allocate registers
-    baseRegIndex = allocateIntRegister();
-    indexRegIndex = allocateIntRegister();
     valueRegIndex = allocateIntRegister();
     addressRegIndex = allocateIntRegister();
 
     // Error checking
-    if (baseRegIndex == -1 || indexRegIndex == -1 ||
-        valueRegIndex == -1 || addressRegIndex == -1) {
+    if (valueRegIndex == -1 || addressRegIndex == -1) {
         printf("Error: No available integer registers\n");
         return;
     }
 
-    // Load base address of array
-    fprintf(outputFile, "\tla %s, %s #LOAD FROM INT ARRAY\n",
-            tempIntRegisters[baseRegIndex].name, current->arg1);
-
-    // Load index
-    fprintf(outputFile, "\tlw %s, %s\n",
-            tempIntRegisters[indexRegIndex].name, current->arg2);
-
-    // Calculate offset (index * 4)
-    fprintf(outputFile, "\tsll %s, %s, 2\n",
-            tempIntRegisters[indexRegIndex].name, tempIntRegisters[indexRegIndex].name);
-
-    // Calculate address (base + offset)
-    fprintf(outputFile, "\tadd %s, %s, %s\n",
-            tempIntRegisters[addressRegIndex].name,
-            tempIntRegisters[baseRegIndex].name,
-            tempIntRegisters[indexRegIndex].name);
+    // Element address (or label+offset for a constant index)
+    bool commented = arrayElementOperand(current, current->arg1, 4, addressRegIndex, "LOAD FROM INT ARRAY", &operand);
 
     // Load value from array
-    fprintf(outputFile, "\tlw %s, 0(%s)\n",
-            tempIntRegisters[valueRegIndex].name, tempIntRegisters[addressRegIndex].name);
+    emitMemory(MIPSOp_Lw, tempIntRegisters[valueRegIndex].number, operand, commented ? NULL : "LOAD FROM INT ARRAY");
 
     // Store value into result variable
-    fprintf(outputFile, "\tsw %s, %s\n",
-            tempIntRegisters[valueRegIndex].name, current->result);
+    emitMemory(MIPSOp_Sw, tempIntRegisters[valueRegIndex].number, dataOperand(current->result), NULL);
 
     // Deallocate registers
-    deallocateIntRegister(baseRegIndex);
-    deallocateIntRegister(indexRegIndex);
     deallocateIntRegister(valueRegIndex);
     deallocateIntRegister(addressRegIndex);
 }
 
 // Array Float Store
 void generateArrFloatStore(TAC* current) {
-    int baseRegIndex, indexRegIndex, addressRegIndex;
+    int addressRegIndex;
     int valueRegIndex;
+    MIPSOperand operand;
 
     // Allocate registers
-    baseRegIndex = allocateIntRegister();
-    indexRegIndex = allocateIntRegister();
     addressRegIndex = allocateIntRegister();
     valueRegIndex = allocateFloatRegister();
 
     // Error checking
-    if (baseRegIndex == -1 || indexRegIndex == -1 ||
-        addressRegIndex == -1 || valueRegIndex == -1) {
+    if (addressRegIndex == -1 || valueRegIndex == -1) {
         printf("Error: No available registers\n");
         return;
     }
 
-    // Load base address of array
-    fprintf(outputFile, "\tla %s, %s #STORE INTO FLOAT ARRAY\n",
-            tempIntRegisters[baseRegIndex].name, current->result);
-
-    // Load index
-    fprintf(outputFile, "\tlw %s, %s\n",
-            tempIntRegisters[indexRegIndex].name, current->arg2);
-
-    // Calculate offset (index * 4)
-    fprintf(outputFile, "\tsll %s, %s, 2\n",
-            tempIntRegisters[indexRegIndex].name, tempIntRegisters[indexRegIndex].name);
-
-    // Calculate address (base + offset)
-    fprintf(outputFile, "\tadd %s, %s, %s\n",
-            tempIntRegisters[addressRegIndex].name,
-            tempIntRegisters[baseRegIndex].name,
-            tempIntRegisters[indexRegIndex].name);
+    // Element address (or label+offset for a constant index)
+    bool commented = arrayElementOperand(current, current->result, 4, addressRegIndex, "STORE INTO FLOAT ARRAY", &operand);
 
     // Load value to store
-    fprintf(outputFile, "\tl.s %s, %s\n",
-            tempFloatRegisters[valueRegIndex].name, current->arg1);
+    emitMemory(MIPSOp_LS, tempFloatRegisters[valueRegIndex].number, dataOperand(current->arg1), commented ? NULL : "STORE INTO FLOAT ARRAY");
 
     // Store value into array
-    fprintf(outputFile, "\ts.s %s, 0(%s)\n",
-            tempFloatRegisters[valueRegIndex].name, tempIntRegisters[addressRegIndex].name);
+    emitMemory(MIPSOp_SS, tempFloatRegisters[valueRegIndex].number, operand, NULL);
 
     // Deallocate registers
-    deallocateIntRegister(baseRegIndex);
-    deallocateIntRegister(indexRegIndex);
     deallocateIntRegister(addressRegIndex);
     deallocateFloatRegister(valueRegIndex);
 }
 
 // Array Float Load
 void generateArrFloatLoad(TAC* current) {
-    int baseRegIndex, indexRegIndex, addressRegIndex;
+    int addressRegIndex;
     int valueRegIndex;
+    MIPSOperand operand;
 
     // Allocate registers
-    baseRegIndex = allocateIntRegister();
-    indexRegIndex = allocateIntRegister();
     addressRegIndex = allocateIntRegister();
     valueRegIndex = allocateFloatRegister();
 
     // Error checking
-    if (baseRegIndex == -1 || indexRegIndex == -1 ||
-        addressRegIndex == -1 || valueRegIndex == -1) {
+    if (addressRegIndex == -1 || valueRegIndex == -1) {
         printf("Error: No available registers\n");
         return;
     }
 
-    // Load base address of array
-    fprintf(outputFile, "\tla %s, %s #LOAD FROM FLOAT ARRAY\n",
-            tempIntRegisters[baseRegIndex].name, current->arg1);
-
-    // Load index
-    fprintf(outputFile, "\tlw %s, %s\n",
-            tempIntRegisters[indexRegIndex].name, current->arg2);
-
-    // Calculate offset (index * 4)
-    fprintf(outputFile, "\tsll %s, %s, 2\n",
-            tempIntRegisters[indexRegIndex].name, tempIntRegisters[indexRegIndex].name);
-
-    // Calculate address (base + offset)
-    fprintf(outputFile, "\tadd %s, %s, %s\n",
-            tempIntRegisters[addressRegIndex].name,
-            tempIntRegisters[baseRegIndex].name,
-            tempIntRegisters[indexRegIndex].name);
+    // Element address (or label+offset for a constant index)
+    bool commented = arrayElementOperand(current, current->arg1, 4, addressRegIndex, "LOAD FROM FLOAT ARRAY", &operand);
 
     // Load value from array
-    fprintf(outputFile, "\tl.s %s, 0(%s)\n",
-            tempFloatRegisters[valueRegIndex].name, tempIntRegisters[addressRegIndex].name);
+    emitMemory(MIPSOp_LS, tempFloatRegisters[valueRegIndex].number, operand, commented ? NULL : "LOAD FROM FLOAT ARRAY");
 
     // Store value into result variable
-    fprintf(outputFile, "\ts.s %s, %s\n",
-            tempFloatRegisters[valueRegIndex].name, current->result);
+    emitMemory(MIPSOp_SS, tempFloatRegisters[valueRegIndex].number, dataOperand(current->result), NULL);
 
     // Deallocate registers
-    deallocateIntRegister(baseRegIndex);
-    deallocateIntRegister(indexRegIndex);
     deallocateIntRegister(addressRegIndex);
     deallocateFloatRegister(valueRegIndex);
 }
 
 // Array Char Store
+//  Chars are one byte, so the index is the offset and needs no shift
 void generateArrCharStore(TAC* current) {
-    int baseRegIndex;
-    int indexRegIndex;
     int addressRegIndex;
     int valueRegIndex;
-    int sourceRegIndex;
+    MIPSOperand operand;
 
     // Allocate registers
-    baseRegIndex = allocateIntRegister();
-    indexRegIndex = allocateIntRegister();
     addressRegIndex = allocateIntRegister();
     valueRegIndex = allocateIntRegister();
-    sourceRegIndex = allocateIntRegister();
 
     // Error checking
-    if (baseRegIndex == -1 || indexRegIndex == -1 ||
-        addressRegIndex == -1 || valueRegIndex == -1 ||
-        sourceRegIndex == -1) {
+    if (addressRegIndex == -1 || valueRegIndex == -1) {
         printf("Error: No available registers\n");
         return;
     }
 
-    // Load base address of destination array
-    fprintf(outputFile, "\tla %s, %s #STORE INTO CHAR ARRAY\n",
-            tempIntRegisters[baseRegIndex].name, current->result);
-
-    // Load destination index
-    fprintf(outputFile, "\tlw %s, %s\n",
-            tempIntRegisters[indexRegIndex].name, current->arg2);
-
-    // Calculate address (base + offset)
-    fprintf(outputFile, "\tadd %s, %s, %s\n",
-            tempIntRegisters[addressRegIndex].name,
-            tempIntRegisters[baseRegIndex].name,
-            tempIntRegisters[indexRegIndex].name);
-
-    // Load address of source char
-    fprintf(outputFile, "\tla %s, %s\n",
-            tempIntRegisters[sourceRegIndex].name, current->arg1);
+    // Destination element address (or label+offset for a constant index)
+    bool commented = arrayElementOperand(current, current->result, 1, addressRegIndex, "STORE INTO CHAR ARRAY", &operand);
 
     // Load value to store
-    fprintf(outputFile, "\tlb %s, 0(%s)\n",
-            tempIntRegisters[valueRegIndex].name, tempIntRegisters[sourceRegIndex].name);
+    loadCharValue(current, tempIntRegisters[valueRegIndex].number, current->arg1, commented ? NULL : "STORE INTO CHAR ARRAY");
 
     // Store value into array
-    fprintf(outputFile, "\tsb %s, 0(%s)\n",
-            tempIntRegisters[valueRegIndex].name, tempIntRegisters[addressRegIndex].name);
+    emitMemory(MIPSOp_Sb, tempIntRegisters[valueRegIndex].number, operand, NULL);
 
     // Deallocate registers
-    deallocateIntRegister(baseRegIndex);
-    deallocateIntRegister(indexRegIndex);
     deallocateIntRegister(addressRegIndex);
     deallocateIntRegister(valueRegIndex);
-    deallocateIntRegister(sourceRegIndex);
 }
 
-// Array Integer Load
+// Array Char Load
 void generateArrCharLoad(TAC* current) {
-    int baseRegIndex;
-    int indexRegIndex;
     int valueRegIndex;
     int addressRegIndex;
-    int destinationRegIndex;
+    MIPSOperand operand;
+
+    // The next TAC loads the element itself
+    if (isForwardedCharLoad(current)) {
+        markFoldedTemp(current->result);
+        return;
+    }
 
     // Allocate registers
-    baseRegIndex = allocateIntRegister();
-    indexRegIndex = allocateIntRegister();
     valueRegIndex = allocateIntRegister();
     addressRegIndex = allocateIntRegister();
-    destinationRegIndex = allocateIntRegister();
 
     // Error checking
-    if (baseRegIndex == -1 || indexRegIndex == -1 ||
-        valueRegIndex == -1 || addressRegIndex == -1 ||
-        destinationRegIndex == -1) {
+    if (valueRegIndex == -1 || addressRegIndex == -1) {
         printf("Error: No available integer registers\n");
         return;
     }
 
-    // Load base address of array
-    fprintf(outputFile, "\tla %s, %s #LOAD FROM CHAR ARRAY\n",
-            tempIntRegisters[baseRegIndex].name, current->arg1);
-
-    // Load index
-    fprintf(outputFile, "\tlw %s, %s\n",
-            tempIntRegisters[indexRegIndex].name, current->arg2);
-
-    // Calculate offset (index * 4)
-    // fprintf(outputFile, "\tsll %s, %s, 2\n",
-    //         tempIntRegisters[indexRegIndex].name, tempIntRegisters[indexRegIndex].name);
-
-    // Calculate address (base + offset)
-    fprintf(outputFile, "\tadd %s, %s, %s\n",
-            tempIntRegisters[addressRegIndex].name,
-            tempIntRegisters[baseRegIndex].name,
-            tempIntRegisters[indexRegIndex].name);
+    // Element address (or label+offset for a constant index)
+    bool commented = arrayElementOperand(current, current->arg1, 1, addressRegIndex, "LOAD FROM CHAR ARRAY", &operand);
 
     // Load value from array
-    fprintf(outputFile, "\tlb %s, 0(%s)\n",
-            tempIntRegisters[valueRegIndex].name, tempIntRegisters[addressRegIndex].name);
-
-    // Load address of source char
-    fprintf(outputFile, "\tla %s, %s\n",
-            tempIntRegisters[destinationRegIndex].name, current->result);
+    emitMemory(MIPSOp_Lb, tempIntRegisters[valueRegIndex].number, operand, commented ? NULL : "LOAD FROM CHAR ARRAY");
 
-    // Store value to address
-    fprintf(outputFile, "\tsb %s, 0(%s)\n",
-            tempIntRegisters[valueRegIndex].name, tempIntRegisters[destinationRegIndex].name);
+    // Store value into the result char
+    emitMemory(MIPSOp_Sb, tempIntRegisters[valueRegIndex].number, dataOperand(current->result), NULL);
 
     // Deallocate registers
-    deallocateIntRegister(baseRegIndex);
-    deallocateIntRegister(indexRegIndex);
     deallocateIntRegister(valueRegIndex);
     deallocateIntRegister(addressRegIndex);
-    deallocateIntRegister(destinationRegIndex);
 }
 
 // Float Assignment
@@ -1354,10 +2025,10 @@ void generateFloatAssign(TAC* current) {
     DataElement* floatConst = createConst("float", current->arg1);
 
     // Load the float constant into the register
-    fprintf(outputFile, "\tl.s %s, %s #ASSIGN FLOAT VALUE\n", tempFloatRegisters[regIndex].name, floatConst->varName);
+    emitMemory(MIPSOp_LS, tempFloatRegisters[regIndex].number, dataOperand(floatConst->varName), "ASSIGN FLOAT VALUE");
 
     // Store the value into the result variable
-    fprintf(outputFile, "\ts.s %s, %s\n", tempFloatRegisters[regIndex].name, current->result);
+    emitMemory(MIPSOp_SS, tempFloatRegisters[regIndex].number, dataOperand(current->result), NULL);
 
     deallocateFloatRegister(regIndex);
 }
@@ -1379,16 +2050,16 @@ void generateIntToFloat(TAC* current) {
     }
 
     // Load int value into register
-    fprintf(outputFile, "\tlw %s, %s #CONVERT INT TO FLOAT\n", tempIntRegisters[intRegIndex].name, current->arg1);
+    emitMemory(MIPSOp_Lw, tempIntRegisters[intRegIndex].number, dataOperand(current->arg1), "CONVERT INT TO FLOAT");
 
     // Transfer int register's binary value into float register
-    fprintf(outputFile, "\tmtc1 %s, %s\n", tempIntRegisters[intRegIndex].name, tempFloatRegisters[floatRegIndex].name);
+    emitRR(MIPSOp_Mtc1, tempIntRegisters[intRegIndex].number, tempFloatRegisters[floatRegIndex].number, NULL);
 
     // Format integer to float
-    fprintf(outputFile, "\tcvt.s.w %s, %s\n", tempFloatRegisters[floatRegIndex].name, tempFloatRegisters[floatRegIndex].name);
+    emitRR(MIPSOp_CvtSW, tempFloatRegisters[floatRegIndex].number, tempFloatRegisters[floatRegIndex].number, NULL);
 
     // Store float register value into .float address
-    fprintf(outputFile, "\ts.s %s, %s\n", tempFloatRegisters[floatRegIndex].name, current->result);
+    emitMemory(MIPSOp_SS, tempFloatRegisters[floatRegIndex].number, dataOperand(current->result), NULL);
 
     deallocateIntRegister(intRegIndex);
     deallocateFloatRegister(floatRegIndex);
@@ -1411,16 +2082,16 @@ void generateFloatToInt(TAC* current) {
     }
 
     // Load int value into register
-    fprintf(outputFile, "\tl.s %s, %s #CONVERT FLOAT TO INT\n", tempFloatRegisters[floatRegIndex].name, current->arg1);
+    emitMemory(MIPSOp_LS, tempFloatRegisters[floatRegIndex].number, dataOperand(current->arg1), "CONVERT FLOAT TO INT");
 
     // Format integer to float
-    fprintf(outputFile, "\tcvt.w.s %s, %s\n", tempFloatRegisters[floatRegIndex].name, tempFloatRegisters[floatRegIndex].name);
+    emitRR(MIPSOp_CvtWS, tempFloatRegisters[floatRegIndex].number, tempFloatRegisters[floatRegIndex].number, NULL);
 
     // Transfer int register's binary value into float register
-    fprintf(outputFile, "\tmfc1 %s, %s\n", tempIntRegisters[intRegIndex].name, tempFloatRegisters[floatRegIndex].name);
+    emitRR(MIPSOp_Mfc1, tempIntRegisters[intRegIndex].number, tempFloatRegisters[floatRegIndex].number, NULL);
 
     // Store float register value into .float address
-    fprintf(outputFile, "\tsw %s, %s\n", tempIntRegisters[intRegIndex].name, current->result);
+    emitMemory(MIPSOp_Sw, tempIntRegisters[intRegIndex].number, dataOperand(current->result), NULL);
 
     deallocateIntRegister(intRegIndex);
     deallocateFloatRegister(floatRegIndex);
@@ -3,14 +3,35 @@
 
 #include "AST.h"       // Include your AST definition
 #include "semantic.h"  // Include your TAC definition
+#include "mipsInstr.h"
 #include <stdbool.h>
 
 #define NUM_TEMP_REGISTERS 10
 #define MAX_CONSTS 100
 
+// Holds the base address of the array accessed last, kept out of the temp pool
+#define ARRAY_BASE_REGISTER MIPS_T9
+
+// Output buffer of the --buffered-output runtime, and the most a single int/char/float
+// write (sign, digits, point, newline) can add to it
+#define RT_BUFFER_SIZE 4096
+#define RT_MAX_VALUE_LENGTH 32
+
+// Calling convention (o32-style)
+//  - The first four int/char arguments are passed in $a0-$a3, the first two float
+//    arguments in $f12/$f14. Any remaining arguments go in an outgoing argument
+//    area on the stack, reserved by the caller.
+//  - Results are returned in $v0 (int/char) or $f0 (float).
+//  - The temp pools ($t0-$t9, $f0-$f9) are caller-saved. The allocator releases
+//    every temp at the end of the TAC instruction that used it, so no temp is ever
+//    live across a `jal` and no save/restore code is needed. The callee-saved
+//    registers ($s0-$s7, $f20-$f30) are never handed out.
+#define NUM_INT_ARG_REGISTERS 4
+#define NUM_FLOAT_ARG_REGISTERS 2
+
 // MIPSRegister struct definition
 typedef struct {
-    char* name;  // Name of the register, e.g., "$t0"
+    int number;  // Number of the register, e.g., MIPS_T0
     bool inUse;  // Whether the register is currently in use
 
     // Optional: Mapping temp vars to registers (commented out)
@@ -35,6 +56,7 @@ void initCodeGenerator(const char* outputFilename);
 void generateMIPS(TAC* tacInstructions, const SymbolTable* table);
 void declareMipsVars(const SymbolTable* table);
 void finalizeCodeGenerator(const char* outputFilename);
+void emitFunctionText(bool renameTemps);
 
 int allocateIntRegister();
 void deallocateIntRegister(int regIndex);
@@ -61,17 +83,45 @@ void generateFloatWrite(TAC* current);
 void generateFloatStore(TAC* current);
 void generateFloatLoad(TAC* current);
 
+// Output
+void generateStringWrite(TAC* current);
+void generateCharArrayWrite(TAC* current);
+void generateOutputRuntime();
+
 // Array functions
 void generateArrIntStore(TAC* current);
 void generateArrIntLoad(TAC* current);
 void generateArrFloatStore(TAC* current);
 void generateArrFloatLoad(TAC* current);
+void generateArrCharStore(TAC* current);
+void generateArrCharLoad(TAC* current);
+bool arrayElementOperand(TAC* current, const char* arrayName, int elementSize, int addressRegIndex, const char* comment, MIPSOperand* operand);
+bool isOnlyConstantIndex(TAC* def);
+void updateArrayBaseCache(TAC* current);
+bool isFoldedTemp(const char* name);
+
+// Char operators
+void generateCharAssign(TAC* current);
+void generateCharLoad(TAC* current);
+void generateCharStore(TAC* current);
+void generateCharWrite(TAC* current);
 
 // Function handling
+void assignArgLocations(Symbol* funcSymbol);
 void generateFunctionCall(TAC* current);
+void generateTailCall(TAC* current);
+void generateReserveArgs(TAC* current);
+void generateArg(TAC* current);
+void generateSetReturn(TAC* current);
 void generateFuncStart(TAC* current);
+void generateParamSpills(FuncTAC* funcTac);
 void generateReturn(TAC* current);
 void generateFunctionMIPS(FuncTAC* funcTac);
+bool funcNeedsFrame(FuncTAC* funcTac);
+bool clobbersArgRegister(TAC* current, const char* reg);
+void updateArgRegisterState(TAC* current);
+const char* liveArgRegister(const char* varName);
+bool paramNeedsSpill(FuncTAC* funcTac, FuncParam* param);
 
 // Type conversion
 void generateIntToFloat(TAC* current);
@@ -80,7 +130,7 @@ void generateIntToFloat(TAC* current);
 void mapTemp(MIPSRegister** reg, char* tempID);
 
 DataElement* createConst(const char* type, const char* contents);
-void printConstsToFile();
+void printConstsToFile(bool smallData);
 
 #endif // CODE_GENERATOR_H
 
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "options.h"
+
+CompilerOptions options = {
+    .inputFile = NULL,
+    .outputFile = "output/output.asm",
+    .dumpIR = false,
+    .dumpAST = false,
+    .target = Target_MIPS,
+    .runProgram = false,
+    .useJIT = false,
+    .inlineThreshold = 16,
+    .cloneBudget = 8,
+    .evalBudget = 100000,
+    .affinityLayout = true,
+    .bufferedOutput = false,
+    .smallDataLimit = 0,
+    .explicitDelaySlots = false,
+};
+
+// Returns the value of a "--name=value" flag, or NULL if `arg` is a different flag
+static const char* flagValue(const char* arg, const char* name) {
+    size_t nameLength = strlen(name);
+    if (strncmp(arg, name, nameLength) == 0 && arg[nameLength] == '=') {
+        return arg + nameLength + 1;
+    }
+    return NULL;
+}
+
+// Parse command-line flags. Anything that isn't a flag is taken as the input file.
+//  argv[0] is expected to be the program name
+void parseOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value;
+
+        if ((value = flagValue(arg, "--output"))) {
+            options.outputFile = value;
+        } else if (strcmp(arg, "-o") == 0) {
+            if (i + 1 == argc) {
+                fprintf(stderr, "Missing file name after -o\n");
+                exit(1);
+            }
+            options.outputFile = argv[++i];
+        } else if (strcmp(arg, "--dump-ir") == 0) {
+            options.dumpIR = true;
+        } else if (strcmp(arg, "--dump-ast") == 0) {
+            options.dumpAST = true;
+        } else if (strcmp(arg, "--run") == 0) {
+            options.runProgram = true;
+        } else if ((value = flagValue(arg, "--run"))) {
+            options.runProgram = true;
+            if (strcmp(value, "vm") == 0) {
+                options.useJIT = false;
+            } else if (strcmp(value, "jit") == 0) {
+                options.useJIT = true;
+            } else {
+                fprintf(stderr, "Unknown run mode: %s (expected vm or jit)\n", value);
+                exit(1);
+            }
+        } else if ((value = flagValue(arg, "--inline-threshold"))) {
+            options.inlineThreshold = atoi(value);
+        } else if ((value = flagValue(arg, "--clone-budget"))) {
+            options.cloneBudget = atoi(value);
+        } else if ((value = flagValue(arg, "--eval-budget"))) {
+            options.evalBudget = atoi(value);
+        } else if ((value = flagValue(arg, "--function-order"))) {
+            if (strcmp(value, "affinity") == 0) {
+                options.affinityLayout = true;
+            } else if (strcmp(value, "source") == 0) {
+                options.affinityLayout = false;
+            } else {
+                fprintf(stderr, "Unknown function order: %s (expected affinity or source)\n", value);
+                exit(1);
+            }
+        } else if ((value = flagValue(arg, "--target"))) {
+            if (strcmp(value, "mips") == 0) {
+                options.target = Target_MIPS;
+            } else if (strcmp(value, "x86-64") == 0) {
+                options.target = Target_X86_64;
+            } else if (strcmp(value, "c") == 0) {
+                options.target = Target_C;
+            } else if (strcmp(value, "bytecode") == 0) {
+                options.target = Target_Bytecode;
+            } else {
+                fprintf(stderr, "Unknown target: %s (expected mips, x86-64, c or bytecode)\n", value);
+                exit(1);
+            }
+        } else if ((value = flagValue(arg, "--delay-slots"))) {
+            if (strcmp(value, "assembler") == 0) {
+                options.explicitDelaySlots = false;
+            } else if (strcmp(value, "explicit") == 0) {
+                options.explicitDelaySlots = true;
+            } else {
+                fprintf(stderr, "Unknown delay slot mode: %s (expected assembler or explicit)\n", value);
+                exit(1);
+            }
+        } else if ((value = flagValue(arg, "--small-data"))) {
+            options.smallDataLimit = atoi(value);
+        } else if (strcmp(arg, "--buffered-output") == 0) {
+            options.bufferedOutput = true;
+        } else if (arg[0] == '-' && arg[1] == '-') {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            exit(1);
+        } else {
+            options.inputFile = arg;
+        }
+    }
+}
+
+void outputSiblingPath(char* buffer, size_t size, const char* fileName) {
+    const char* slash = strrchr(options.outputFile, '/');
+    if (strcmp(options.outputFile, "-") == 0 || slash == NULL) {
+        snprintf(buffer, size, "%s", fileName);
+    } else {
+        snprintf(buffer, size, "%.*s/%s", (int)(slash - options.outputFile), options.outputFile, fileName);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef COMMON_OPTIONS_H
+#define COMMON_OPTIONS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Code the compiler produces
+typedef enum Target {
+    Target_MIPS,    //MIPS assembly for MARS/SPIM
+    Target_X86_64,  //x86-64 System V assembly, linked with runtime/cmmRuntime.c
+    Target_C,       //C99 source for a native C compiler
+    Target_Bytecode //Bytecode file for --run
+} Target;
+
+// Command-line options shared by every compiler phase
+typedef struct CompilerOptions {
+    const char* inputFile;  //Source file, NULL reads from stdin
+    const char* outputFile; //Assembly output file, "-" writes it to stdout
+    bool dumpIR;            //Write the TAC before and after optimization next to the assembly
+    bool dumpAST;           //Print the syntax tree after parsing
+    Target target;
+    bool runProgram;        //Run the program instead of writing code
+    bool useJIT;            //Run it as x86-64 machine code rather than in the bytecode VM
+    int inlineThreshold;    //Largest callee (in TAC instructions) that gets inlined, 0 disables inlining
+    int cloneBudget;        //Most specialized function clones to create, 0 disables specialization
+    int evalBudget;         //Most TACs compile-time evaluation may run, 0 disables it
+    bool affinityLayout;    //Emit functions ordered by call affinity instead of source order
+    bool bufferedOutput;    //Writes go through an output buffer flushed with one syscall per 4KB
+    int smallDataLimit;     //Variables and temps of at most this many bytes go in .sdata, addressed off $gp. 0 disables it
+    bool explicitDelaySlots; //Emit .set noreorder code, with the scheduler filling the delay slot after every branch
+} CompilerOptions;
+
+extern CompilerOptions options;
+
+void parseOptions(int argc, char** argv);
+
+// Path of `fileName` in the directory the assembly is written to ("." for stdout)
+void outputSiblingPath(char* buffer, size_t size, const char* fileName);
+
+#endif
@@ -0,0 +1,126 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "outputWriter.h"
+
+// Descriptor of the original standard output once claimStandardOutput() took it over
+static int claimedStdout = -1;
+
+int claimStandardOutput() {
+    if (claimedStdout < 0) {
+        fflush(stdout);
+        claimedStdout = dup(STDOUT_FILENO);
+        if (claimedStdout >= 0) dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+    return claimedStdout;
+}
+
+bool openOutputWriter(OutputWriter* writer, const char* path) {
+    memset(writer, 0, sizeof(*writer));
+    if (strcmp(path, "-") == 0) {
+        writer->fd = claimStandardOutput();
+        if (writer->fd < 0) return false;
+    } else {
+        writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (writer->fd < 0) return false;
+        writer->closeFd = true;
+    }
+    writer->buffer = malloc(OUTPUT_BUFFER_SIZE);
+    return true;
+}
+
+// Queue the part of the buffer no chunk covers yet, so it goes out before what is queued next
+static void queueBuffered(OutputWriter* writer) {
+    if (writer->length == writer->queuedLength) return;
+    writer->chunks[writer->chunkCount].iov_base = writer->buffer + writer->queuedLength;
+    writer->chunks[writer->chunkCount].iov_len = writer->length - writer->queuedLength;
+    writer->ownsChunk[writer->chunkCount] = false;
+    writer->chunkCount++;
+    writer->queuedLength = writer->length;
+}
+
+void flushOutputWriter(OutputWriter* writer) {
+    queueBuffered(writer);
+
+    // writev() may stop part way through, e.g. on a full pipe
+    struct iovec* chunk = writer->chunks;
+    int remaining = writer->chunkCount;
+    while (remaining > 0) {
+        ssize_t written = writev(writer->fd, chunk, remaining);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            perror("Failed to write output");
+            break;
+        }
+        while (remaining > 0 && (size_t)written >= chunk->iov_len) {
+            written -= chunk->iov_len;
+            chunk++;
+            remaining--;
+        }
+        if (remaining > 0) {
+            chunk->iov_base = (char*)chunk->iov_base + written;
+            chunk->iov_len -= written;
+        }
+    }
+
+    for (int i = 0; i < writer->chunkCount; i++) {
+        if (writer->ownsChunk[i]) free(writer->chunks[i].iov_base);
+    }
+    writer->chunkCount = 0;
+    writer->length = writer->queuedLength = 0;
+}
+
+// Queues at most two chunks (the buffered bytes and `chunk`), and leaves room for the one
+//  flushOutputWriter() queues for whatever is buffered after them
+void writerTakeChunk(OutputWriter* writer, char* chunk, size_t length) {
+    if (writer->chunkCount + 3 > OUTPUT_MAX_CHUNKS) flushOutputWriter(writer);
+    queueBuffered(writer);
+    writer->chunks[writer->chunkCount].iov_base = chunk;
+    writer->chunks[writer->chunkCount].iov_len = length;
+    writer->ownsChunk[writer->chunkCount] = true;
+    writer->chunkCount++;
+}
+
+void writerWrite(OutputWriter* writer, const char* bytes, size_t length) {
+    if (writer->length + length > OUTPUT_BUFFER_SIZE) flushOutputWriter(writer);
+    if (length > OUTPUT_BUFFER_SIZE) {
+        char* copy = malloc(length);
+        memcpy(copy, bytes, length);
+        writerTakeChunk(writer, copy, length);
+        return;
+    }
+    memcpy(writer->buffer + writer->length, bytes, length);
+    writer->length += length;
+}
+
+void writerPrintf(OutputWriter* writer, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t space = OUTPUT_BUFFER_SIZE - writer->length;
+    int length = vsnprintf(writer->buffer + writer->length, space, format, args);
+    va_end(args);
+    if (length < 0) return;
+    if ((size_t)length < space) {
+        writer->length += length;
+        return;
+    }
+
+    // Didn't fit: format it again on its own
+    char* text = malloc(length + 1);
+    va_start(args, format);
+    vsnprintf(text, length + 1, format, args);
+    va_end(args);
+    writerWrite(writer, text, length);
+    free(text);
+}
+
+void closeOutputWriter(OutputWriter* writer) {
+    flushOutputWriter(writer);
+    if (writer->closeFd) close(writer->fd);
+    free(writer->buffer);
+    writer->buffer = NULL;
+}
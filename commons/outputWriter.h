@@ -0,0 +1,48 @@
+#ifndef COMMON_OUTPUT_WRITER_H
+#define COMMON_OUTPUT_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+// Bytes of small writes collected before they go out
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+// Pieces handed to one writev() call
+#define OUTPUT_MAX_CHUNKS 64
+
+// Output file written with as few system calls as possible
+//  Small writes are copied into one preallocated buffer. Large chunks that are already
+//  in memory (a whole function's assembly) are queued as they are, and everything goes
+//  out in order with a single writev() once the buffer or the queue fills up.
+typedef struct OutputWriter {
+    int fd;
+    bool closeFd;
+    char* buffer;
+    size_t length;          // Bytes used in buffer
+    size_t queuedLength;    // Bytes of buffer already covered by a queued chunk
+    struct iovec chunks[OUTPUT_MAX_CHUNKS];
+    bool ownsChunk[OUTPUT_MAX_CHUNKS];  // Chunk is malloc'd and freed once written
+    int chunkCount;
+} OutputWriter;
+
+// Keep standard output for a writer opened on "-", and send everything else printed to
+// it over to standard error from here on, so the stream only carries that file.
+// Returns the descriptor of the original standard output, -1 on failure.
+int claimStandardOutput();
+
+// Open `path` for writing, truncating it. A path of "-" writes to standard output
+// (see claimStandardOutput()). Returns false if the file can't be opened.
+bool openOutputWriter(OutputWriter* writer, const char* path);
+
+void writerWrite(OutputWriter* writer, const char* bytes, size_t length);
+void writerPrintf(OutputWriter* writer, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+// Queue a malloc'd chunk without copying it. The writer frees it once written.
+void writerTakeChunk(OutputWriter* writer, char* chunk, size_t length);
+
+void flushOutputWriter(OutputWriter* writer);
+
+// Flush and close the file
+void closeOutputWriter(OutputWriter* writer);
+
+#endif
@@ -0,0 +1,342 @@
+#include "interpreter.h"
+#include "symbolTable.h"
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_CALL_DEPTH 1000
+#define MAX_PENDING_ARGS 32
+
+// One memory word: a scalar, a temp, or a single array element
+typedef struct MemoryCell {
+    char* name;
+    int index;      //Element index for arrays, -1 for scalars and temps
+    InterpValue value;
+    struct MemoryCell* next;
+} MemoryCell;
+
+typedef struct Interpreter {
+    MemoryCell* memory;
+    int steps;
+    int budget;
+    int depth;
+
+    //Call evaluation: variables must be set by this run before being read, and
+    //writing output fails. Program evaluation instead starts from zeroed memory
+    //(like .data) and records every write.
+    bool strict;
+    TAC* writesHead;
+    TAC* writesTail;
+
+    //Arguments passed by arg.* TACs, bound to the parameters when the call happens
+    InterpArg pendingArgs[MAX_PENDING_ARGS];
+    int pendingArgCount;
+} Interpreter;
+
+static MemoryCell* findCell(Interpreter* interp, const char* name, int index) {
+    for (MemoryCell* cell = interp->memory; cell; cell = cell->next) {
+        if (cell->index == index && strcmp(cell->name, name) == 0) return cell;
+    }
+    return NULL;
+}
+
+static void writeMemory(Interpreter* interp, const char* name, int index, InterpValue value) {
+    MemoryCell* cell = findCell(interp, name, index);
+    if (!cell) {
+        cell = malloc(sizeof(MemoryCell));
+        cell->name = strdup(name);
+        cell->index = index;
+        cell->next = interp->memory;
+        interp->memory = cell;
+    }
+    cell->value = value;
+}
+
+// Read a memory word of the given type. Returns false if it can't be known.
+static bool readMemory(Interpreter* interp, const char* name, int index, VarType type, InterpValue* value) {
+    MemoryCell* cell = findCell(interp, name, index);
+    if (cell) {
+        *value = cell->value;
+        return true;
+    }
+    if (interp->strict) return false;
+
+    //Never written: .data starts zeroed, except chars, which start as 'U'
+    value->type = type;
+    value->intValue = (type == VarType_Char) ? 'U' : 0;
+    value->floatValue = 0;
+    return true;
+}
+
+static void freeInterpreter(Interpreter* interp) {
+    while (interp->memory) {
+        MemoryCell* next = interp->memory->next;
+        free(interp->memory->name);
+        free(interp->memory);
+        interp->memory = next;
+    }
+}
+
+// Type named by an op suffix ("int", "floatIndex", ...)
+static VarType opType(const char* suffix) {
+    if (strncmp(suffix, "float", 5) == 0) return VarType_Float;
+    if (strncmp(suffix, "char", 4) == 0) return VarType_Char;
+    return VarType_Int;
+}
+
+// Check an array index against the declared size
+//  Out-of-bounds accesses hit whatever the assembler put next to the array, which
+//  can't be reproduced here
+static bool indexInBounds(const char* arrayName, int index) {
+    Symbol* symbol = lookupSymbol(symTabRef, arrayName);
+    return symbol && symbol->isArray && index >= 0 && index < symbol->arrSize;
+}
+
+// Apply an arithmetic op ("+.int", "/.float", ...). Returns false on anything the
+// MIPS code would trap on, or that produces a float we couldn't write back as a constant.
+static bool applyArithmetic(const char* op, InterpValue a, InterpValue b, InterpValue* result) {
+    char operator = op[0];
+    if (strcmp(op + 1, ".int") == 0) {
+        long long x = a.intValue;
+        long long y = b.intValue;
+        long long value;
+        switch (operator) {
+            case '+': value = x + y; break;    //add traps on overflow
+            case '-': value = x - y; break;    //sub too
+            case '*': value = (int)((unsigned int)x * (unsigned int)y); break;   //mul keeps the low word
+            case '/':
+                if (y == 0 || (x == INT_MIN && y == -1)) return false;
+                value = x / y;
+                break;
+            default: return false;
+        }
+        if (value < INT_MIN || value > INT_MAX) return false;
+        result->type = VarType_Int;
+        result->intValue = (int)value;
+        return true;
+    }
+    if (strcmp(op + 1, ".float") == 0) {
+        float value;
+        switch (operator) {
+            case '+': value = a.floatValue + b.floatValue; break;
+            case '-': value = a.floatValue - b.floatValue; break;
+            case '*': value = a.floatValue * b.floatValue; break;
+            case '/': value = a.floatValue / b.floatValue; break;
+            default: return false;
+        }
+        if (!isfinite(value)) return false;
+        result->type = VarType_Float;
+        result->floatValue = value;
+        return true;
+    }
+    return false;
+}
+
+// Record a write as "temp = value assign.<type>" followed by "write.<type> temp"
+static void recordWrite(Interpreter* interp, InterpValue value) {
+    const char* type = (value.type == VarType_Float) ? "float" : (value.type == VarType_Char) ? "char" : "int";
+    char buffer[40];
+    char op[20];
+    formatInterpValue(value, buffer, 40);
+
+    char* temp = createTempVar(value.type);
+    snprintf(op, 20, "assign.%s", type);
+    appendTAC(&interp->writesHead, &interp->writesTail, createTAC(temp, buffer, op, NULL));
+    snprintf(op, 20, "write.%s", type);
+    appendTAC(&interp->writesHead, &interp->writesTail, createTAC(NULL, temp, op, NULL));
+    free(temp);
+}
+
+// Record a whole char array write: its elements up to the first NUL, and a newline
+static bool recordCharArrayWrite(Interpreter* interp, const char* arrayName) {
+    Symbol* symbol = lookupSymbol(symTabRef, arrayName);
+    if (!symbol || !symbol->isArray) return false;
+
+    char literal[1024] = "";
+    InterpValue element;
+    for (int i = 0; i < symbol->arrSize; i++) {
+        if (!readMemory(interp, arrayName, i, VarType_Char, &element)) return false;
+        if (element.intValue == 0) break;
+        if (!appendAsciizChar(literal, sizeof(literal), (char)element.intValue)) return false;
+    }
+    if (!appendAsciizChar(literal, sizeof(literal), '\n')) return false;
+    appendTAC(&interp->writesHead, &interp->writesTail, createTAC(NULL, literal, "write.string", NULL));
+    return true;
+}
+
+static bool runList(Interpreter* interp, TAC* head, InterpValue* returnValue);
+
+// Enter a function: bind the pending arguments, then run its body
+static bool runCall(Interpreter* interp, TAC* call, InterpValue* returnValue) {
+    FuncTAC* callee = findFuncTAC(call->arg1);
+    if (!callee || interp->depth >= MAX_CALL_DEPTH) return false;
+
+    for (int i = 0; i < interp->pendingArgCount; i++) {
+        writeMemory(interp, interp->pendingArgs[i].param, -1, interp->pendingArgs[i].value);
+    }
+    interp->pendingArgCount = 0;
+
+    interp->depth++;
+    bool success = runList(interp, callee->func, returnValue);
+    interp->depth--;
+    return success;
+}
+
+// Execute a TAC list until its first return (functions) or its end (main)
+static bool runList(Interpreter* interp, TAC* head, InterpValue* returnValue) {
+    for (TAC* current = head; current; current = current->next) {
+        if (++interp->steps > interp->budget) return false;
+
+        const char* op = current->op;
+        InterpValue a;
+        InterpValue b;
+        InterpValue value;
+
+        if (strcmp(op, "funcStart") == 0 || strcmp(op, "reserveArgs") == 0) {
+            continue;
+        } else if (strcmp(op, "return") == 0) {
+            return true;
+        } else if (strncmp(op, "assign.", 7) == 0) {
+            value.type = opType(op + 7);
+            value.intValue = (value.type == VarType_Char) ? current->arg1[0] : atoi(current->arg1);
+            value.floatValue = strtof(current->arg1, NULL);
+            writeMemory(interp, current->result, -1, value);
+        } else if (strncmp(op, "load.", 5) == 0 || strncmp(op, "store.", 6) == 0) {
+            bool isLoad = (op[0] == 'l');
+            VarType type = opType(op + (isLoad ? 5 : 6));
+            int index = -1;
+            const char* location = isLoad ? current->arg1 : current->result;
+            if (strstr(op, "Index")) {
+                if (!readMemory(interp, current->arg2, -1, VarType_Int, &b)) return false;
+                if (!indexInBounds(location, b.intValue)) return false;
+                index = b.intValue;
+            }
+            if (isLoad) {
+                if (!readMemory(interp, location, index, type, &value)) return false;
+                writeMemory(interp, current->result, -1, value);
+            } else {
+                if (!readMemory(interp, current->arg1, -1, type, &value)) return false;
+                writeMemory(interp, location, index, value);
+            }
+        } else if (strcmp(op, "intToFloat") == 0) {
+            if (!readMemory(interp, current->arg1, -1, VarType_Int, &a)) return false;
+            value.type = VarType_Float;
+            value.floatValue = (float)a.intValue;
+            writeMemory(interp, current->result, -1, value);
+        } else if (op[0] && op[1] == '.' && strchr("+-*/", op[0])) {
+            if (!readMemory(interp, current->arg1, -1, opType(op + 2), &a)) return false;
+            if (!readMemory(interp, current->arg2, -1, opType(op + 2), &b)) return false;
+            if (!applyArithmetic(op, a, b, &value)) return false;
+            writeMemory(interp, current->result, -1, value);
+        } else if (strcmp(op, "write.string") == 0) {
+            if (interp->strict) return false;
+            appendTAC(&interp->writesHead, &interp->writesTail, createTAC(NULL, current->arg1, "write.string", NULL));
+        } else if (strcmp(op, "write.charArray") == 0) {
+            if (interp->strict) return false;
+            if (!recordCharArrayWrite(interp, current->arg1)) return false;
+        } else if (strncmp(op, "write.", 6) == 0) {
+            if (interp->strict) return false;
+            if (!readMemory(interp, current->arg1, -1, opType(op + 6), &value)) return false;
+            recordWrite(interp, value);
+        } else if (strncmp(op, "arg.", 4) == 0) {
+            if (interp->pendingArgCount >= MAX_PENDING_ARGS) return false;
+            if (!readMemory(interp, current->arg1, -1, opType(op + 4), &value)) return false;
+            interp->pendingArgs[interp->pendingArgCount].param = current->result;
+            interp->pendingArgs[interp->pendingArgCount].value = value;
+            interp->pendingArgCount++;
+        } else if (strcmp(op, "functionCall") == 0) {
+            value.type = VarType_Void;
+            if (!runCall(interp, current, &value)) return false;
+            if (current->result) {
+                if (value.type == VarType_Void) return false;
+                writeMemory(interp, current->result, -1, value);
+            }
+        } else if (strcmp(op, "tailCall") == 0) {
+            return runCall(interp, current, returnValue);
+        } else if (strncmp(op, "setReturn.", 10) == 0) {
+            if (!readMemory(interp, current->arg1, -1, opType(op + 10), returnValue)) return false;
+        } else {
+            //floatToInt rounds by the FPU mode, and anything else is unknown here
+            return false;
+        }
+    }
+    return true;
+}
+
+bool evaluateCall(FuncTAC* callee, InterpArg* args, int argCount, int budget, InterpValue* result) {
+    if (argCount > MAX_PENDING_ARGS) return false;
+
+    Interpreter interp = { 0 };
+    interp.budget = budget;
+    interp.strict = true;
+    for (int i = 0; i < argCount; i++) interp.pendingArgs[i] = args[i];
+    interp.pendingArgCount = argCount;
+
+    TAC call = { .op = "functionCall", .arg1 = callee->funcName };
+    InterpValue value = { .type = VarType_Void };
+    bool success = runCall(&interp, &call, &value);
+    if (success && callee->returnType != VarType_Void) {
+        success = (value.type != VarType_Void);
+        *result = value;
+    }
+    freeInterpreter(&interp);
+    return success;
+}
+
+bool evaluateProgram(TAC* head, int budget, TAC** writesHead, TAC** writesTail) {
+    Interpreter interp = { 0 };
+    interp.budget = budget;
+    interp.strict = false;
+
+    InterpValue unused;
+    bool success = runList(&interp, head, &unused);
+    freeInterpreter(&interp);
+
+    *writesHead = interp.writesHead;
+    *writesTail = interp.writesTail;
+    if (!success) {
+        while (interp.writesHead) {
+            TAC* next = interp.writesHead->next;
+            freeTAC(&interp.writesHead);
+            interp.writesHead = next;
+        }
+        *writesHead = *writesTail = NULL;
+    }
+    return success;
+}
+
+bool appendAsciizChar(char* literal, size_t size, char c) {
+    char text[3] = { c, '\0', '\0' };
+    if (c == '"' || c == '\\') {
+        text[0] = '\\';
+        text[1] = c;
+    } else if (c == '\n') {
+        text[0] = '\\';
+        text[1] = 'n';
+    } else if (c == '\t') {
+        text[0] = '\\';
+        text[1] = 't';
+    } else if (c < 32 || c >= 127) {
+        return false;
+    }
+    if (strlen(literal) + strlen(text) >= size) return false;
+    strcat(literal, text);
+    return true;
+}
+
+void formatInterpValue(InterpValue value, char* buffer, size_t size) {
+    switch (value.type) {
+        case VarType_Float:
+            snprintf(buffer, size, "%.9g", value.floatValue);
+            if (!strpbrk(buffer, ".e")) strncat(buffer, ".0", size - strlen(buffer) - 1);
+            break;
+        case VarType_Char:
+            snprintf(buffer, size, "%c", (char)value.intValue);
+            break;
+        default:
+            snprintf(buffer, size, "%d", value.intValue);
+            break;
+    }
+}
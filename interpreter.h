@@ -0,0 +1,62 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include "semantic.h"
+#include "commons/types.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Runs TAC at compile time, for evaluating calls and whole programs in the optimizer
+//  Memory follows the generated MIPS: every variable, parameter and temp is a single
+//  global cell, so recursion and leftover locals behave exactly like the real program.
+
+// Value of a variable or temp. Chars live in intValue.
+typedef struct InterpValue {
+    VarType type;
+    int intValue;
+    float floatValue;
+} InterpValue;
+
+// Constant argument bound to a parameter when evaluating a call
+typedef struct InterpArg {
+    const char* param;
+    InterpValue value;
+} InterpArg;
+
+/**
+ * Evaluate a call with constant arguments.
+ * Fails if the function writes output, reads a variable this call didn't set
+ * (its value would depend on earlier calls), does something that can't be
+ * reproduced at compile time, or runs longer than `budget` TACs.
+ *
+ * @param callee The function to run.
+ * @param args Values of the parameters.
+ * @param argCount Number of entries in `args`.
+ * @param budget Most TACs to execute.
+ * @param result Receives the return value (left untouched for void functions).
+ * @return true if the call was evaluated.
+ */
+bool evaluateCall(FuncTAC* callee, InterpArg* args, int argCount, int budget, InterpValue* result);
+
+/**
+ * Run the whole program (main and everything it calls) and record its output.
+ * On success, `writesHead`/`writesTail` hold a TAC list that produces the same
+ * output: an assign of each written constant followed by its write.
+ *
+ * @return true if the program finished within `budget` TACs.
+ */
+bool evaluateProgram(TAC* head, int budget, TAC** writesHead, TAC** writesTail);
+
+/**
+ * Append a character to an .asciiz literal, escaping it if needed.
+ * Returns false if it doesn't fit or can't be written in a literal.
+ */
+bool appendAsciizChar(char* literal, size_t size, char c);
+
+/**
+ * Format a value the way TAC constants are written ("12", "2.5", "k").
+ * Floats get enough digits to read back as exactly the same value.
+ */
+void formatInterpValue(InterpValue value, char* buffer, size_t size);
+
+#endif
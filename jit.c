@@ -0,0 +1,452 @@
+// jit.c
+#include "jit.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Deepest recursion a program can reach; each call takes 16 bytes of the native stack
+#define JIT_MAX_CALL_DEPTH (1 << 18)
+
+// How the machine code returns to runJITProgram(), in %eax
+typedef enum JITStatus {
+    JIT_FINISHED,
+    JIT_DIVISION_BY_ZERO,
+    JIT_INTEGER_OVERFLOW,
+    JIT_INDEX_OUT_OF_BOUNDS,
+    JIT_STACK_OVERFLOW,
+    JIT_STATUS_COUNT
+} JITStatus;
+
+static const char* statusMessages[JIT_STATUS_COUNT] = {
+    [JIT_DIVISION_BY_ZERO] = "Division by zero",
+    [JIT_INTEGER_OVERFLOW] = "Arithmetic overflow",
+    [JIT_INDEX_OUT_OF_BOUNDS] = "Array index out of bounds",
+    [JIT_STACK_OVERFLOW] = "Call stack overflow",
+};
+
+// Registers, numbered as in ModRM bytes
+enum { RAX = 0, RCX = 1, RDI = 7 };
+
+// A rel32 waiting for the address of a bytecode instruction or of a status stub
+typedef struct JITFixup {
+    size_t position;
+    uint32_t target;    //Bytecode position, or JITStatus if `isStub`
+    bool isStub;
+} JITFixup;
+
+typedef struct JITCompiler {
+    uint8_t* bytes;
+    size_t length;
+    size_t capacity;
+    size_t* nativeOffsets;  //Machine code offset of each bytecode position
+    JITFixup* fixups;
+    int fixupCount;
+    int fixupCapacity;
+} JITCompiler;
+
+static OutputWriter jitWriter;
+
+// Output routines the machine code calls
+static void jitWriteInt(int32_t value) {
+    vmWriteInt(&jitWriter, value);
+}
+
+static void jitWriteFloat(float value) {
+    vmWriteFloat(&jitWriter, value);
+}
+
+static void jitWriteChar(int32_t value) {
+    char text[2] = { (char)value, '\n' };
+    writerWrite(&jitWriter, text, 2);
+}
+
+static void jitWriteString(const char* text) {
+    writerWrite(&jitWriter, text, strlen(text));
+}
+
+static void emitBytes(JITCompiler* jit, const void* bytes, size_t length) {
+    if (jit->length + length > jit->capacity) {
+        while (jit->length + length > jit->capacity) jit->capacity = jit->capacity ? jit->capacity * 2 : 4096;
+        jit->bytes = realloc(jit->bytes, jit->capacity);
+    }
+    memcpy(jit->bytes + jit->length, bytes, length);
+    jit->length += length;
+}
+
+// Emit a byte sequence written out in place, e.g. EMIT(jit, 0x48, 0x83, 0xC4, 0x08)
+#define EMIT(jit, ...) do { \
+        const uint8_t bytes_[] = { __VA_ARGS__ }; \
+        emitBytes((jit), bytes_, sizeof(bytes_)); \
+    } while (0)
+
+static void emitInt32(JITCompiler* jit, uint32_t value) {
+    emitBytes(jit, &value, sizeof(value));
+}
+
+// An instruction whose memory operand is the cell at `offset`: opcode, ModRM for
+// [%rbx + disp32], disp32
+static void emitCellOp(JITCompiler* jit, const uint8_t* opcode, size_t opcodeLength, int reg, uint32_t offset) {
+    emitBytes(jit, opcode, opcodeLength);
+    EMIT(jit, (uint8_t)(0x80 | (reg << 3) | 3));
+    emitInt32(jit, offset);
+}
+
+#define CELL_OP(jit, reg, offset, ...) do { \
+        const uint8_t opcode_[] = { __VA_ARGS__ }; \
+        emitCellOp((jit), opcode_, sizeof(opcode_), (reg), (offset)); \
+    } while (0)
+
+// An instruction whose memory operand is element %rax of the array at `offset`:
+// opcode, ModRM and SIB for [%rbx + %rax * scale + disp32], disp32
+static void emitElementOp(JITCompiler* jit, uint8_t opcode0, int opcode1, int reg, int scale, uint32_t offset) {
+    EMIT(jit, opcode0);
+    if (opcode1 >= 0) EMIT(jit, (uint8_t)opcode1);
+    EMIT(jit, (uint8_t)(0x80 | (reg << 3) | 4), (uint8_t)(((scale == 4) ? 0x80 : 0x00) | (RAX << 3) | 3));
+    emitInt32(jit, offset);
+}
+
+// A rel32 to a bytecode instruction or a status stub, filled in by resolveFixups()
+static void emitRel32(JITCompiler* jit, uint32_t target, bool isStub) {
+    if (jit->fixupCount == jit->fixupCapacity) {
+        jit->fixupCapacity = jit->fixupCapacity ? jit->fixupCapacity * 2 : 64;
+        jit->fixups = realloc(jit->fixups, jit->fixupCapacity * sizeof(JITFixup));
+    }
+    jit->fixups[jit->fixupCount++] = (JITFixup){ jit->length, target, isStub };
+    emitInt32(jit, 0);
+}
+
+// Call an output routine with its argument already in %edi/%xmm0
+static void emitHelperCall(JITCompiler* jit, const void* helper) {
+    uint64_t address = (uint64_t)(uintptr_t)helper;
+    EMIT(jit, 0x48, 0xB8);              // movabs $helper, %rax
+    emitBytes(jit, &address, sizeof(address));
+    EMIT(jit, 0xFF, 0xD0);              // call *%rax
+}
+
+static void emitLoad(JITCompiler* jit, int reg, uint32_t offset) {
+    CELL_OP(jit, reg, offset, 0x8B);    // mov offset(%rbx), reg
+}
+
+static void emitStore(JITCompiler* jit, int reg, uint32_t offset) {
+    CELL_OP(jit, reg, offset, 0x89);    // mov reg, offset(%rbx)
+}
+
+static void emitMove(JITCompiler* jit, uint32_t dest, uint32_t src) {
+    emitLoad(jit, RAX, src);
+    emitStore(jit, RAX, dest);
+}
+
+// Check an array index held in %eax; negative ones look huge when compared unsigned
+static void emitIndexCheck(JITCompiler* jit, uint32_t length) {
+    EMIT(jit, 0x3D);                    // cmp $length, %eax
+    emitInt32(jit, length);
+    EMIT(jit, 0x0F, 0x83);              // jae index stub
+    emitRel32(jit, JIT_INDEX_OUT_OF_BOUNDS, true);
+}
+
+// a = b op c on ints, in %eax
+//  add and sub stop on overflow like they do in the VM; imul wraps around.
+static void emitIntArithmetic(JITCompiler* jit, VMOpcode op, const uint32_t* operands) {
+    emitLoad(jit, RAX, operands[1]);
+    if (op == VM_ADD || op == VM_SUB) {
+        CELL_OP(jit, RAX, operands[2], (op == VM_ADD) ? 0x03 : 0x2B);     // add or sub
+        EMIT(jit, 0x0F, 0x80);                                          // jo overflow stub
+        emitRel32(jit, JIT_INTEGER_OVERFLOW, true);
+    } else if (op == VM_MUL) {
+        CELL_OP(jit, RAX, operands[2], 0x0F, 0xAF);     // imul
+    } else {
+        // Dividing INT_MIN by -1 would trap, so -1 negates instead
+        emitLoad(jit, RCX, operands[2]);
+        EMIT(jit, 0x85, 0xC9);          // test %ecx, %ecx
+        EMIT(jit, 0x0F, 0x84);          // jz division stub
+        emitRel32(jit, JIT_DIVISION_BY_ZERO, true);
+        EMIT(jit, 0x83, 0xF9, 0xFF);    // cmp $-1, %ecx
+        EMIT(jit, 0x75, 0x04);          // jne 1f
+        EMIT(jit, 0xF7, 0xD8);          // neg %eax
+        EMIT(jit, 0xEB, 0x03);          // jmp 2f
+        EMIT(jit, 0x99);                // 1: cltd
+        EMIT(jit, 0xF7, 0xF9);          // idiv %ecx
+    }
+    emitStore(jit, RAX, operands[0]);   // 2:
+}
+
+// a = b op c on floats, in %xmm0
+static void emitFloatArithmetic(JITCompiler* jit, VMOpcode op, const uint32_t* operands) {
+    static const uint8_t opcodes[4] = { 0x58, 0x5C, 0x59, 0x5E };  // addss, subss, mulss, divss
+    CELL_OP(jit, 0, operands[1], 0xF3, 0x0F, 0x10);                 // movss b, %xmm0
+    CELL_OP(jit, 0, operands[2], 0xF3, 0x0F, opcodes[op - VM_FADD]);
+    CELL_OP(jit, 0, operands[0], 0xF3, 0x0F, 0x11);                 // movss %xmm0, a
+}
+
+// Function entry: keep %rsp 16-byte aligned for calls, and count the call's depth in %r12d
+static void emitFunctionEntry(JITCompiler* jit) {
+    EMIT(jit, 0x48, 0x83, 0xEC, 0x08);  // sub $8, %rsp
+    EMIT(jit, 0x41, 0x83, 0xEC, 0x01);  // sub $1, %r12d
+    EMIT(jit, 0x0F, 0x84);              // jz overflow stub
+    emitRel32(jit, JIT_STACK_OVERFLOW, true);
+}
+
+static void emitFunctionExit(JITCompiler* jit) {
+    EMIT(jit, 0x41, 0x83, 0xC4, 0x01);  // add $1, %r12d
+    EMIT(jit, 0x48, 0x83, 0xC4, 0x08);  // add $8, %rsp
+}
+
+// Finish the program with %eax as its status: back to main's frame and out
+static void emitExit(JITCompiler* jit) {
+    EMIT(jit, 0x4C, 0x89, 0xEC);        // mov %r13, %rsp
+    EMIT(jit, 0x41, 0x5D);              // pop %r13
+    EMIT(jit, 0x41, 0x5C);              // pop %r12
+    EMIT(jit, 0x5B);                    // pop %rbx
+    EMIT(jit, 0xC3);                    // ret
+}
+
+static void emitHalt(JITCompiler* jit) {
+    EMIT(jit, 0x31, 0xC0);              // xor %eax, %eax
+    emitExit(jit);
+}
+
+static void translateInstr(JITCompiler* jit, const VMProgram* program, uint32_t pc, bool inMain) {
+    VMOpcode op = program->code[pc];
+    const uint32_t* operands = program->code + pc + 1;
+    switch (op) {
+        case VM_HALT:
+            emitHalt(jit);
+            break;
+        case VM_CONST:
+            CELL_OP(jit, 0, operands[0], 0xC7);     // movl $imm, a
+            emitInt32(jit, operands[1]);
+            break;
+        case VM_CONST_BYTE:
+            CELL_OP(jit, 0, operands[0], 0xC6);     // movb $imm, a
+            EMIT(jit, (uint8_t)operands[1]);
+            break;
+        case VM_MOVE:
+            emitMove(jit, operands[0], operands[1]);
+            break;
+        case VM_MOVE2:
+            emitMove(jit, operands[0], operands[1]);
+            emitMove(jit, operands[2], operands[3]);
+            break;
+        case VM_MOVE_BYTE:
+            CELL_OP(jit, RAX, operands[1], 0x0F, 0xB6);     // movzbl b, %eax
+            CELL_OP(jit, RAX, operands[0], 0x88);           // mov %al, a
+            break;
+
+        case VM_LOAD_INDEX:
+        case VM_LOAD_INDEX_BYTE:
+            emitLoad(jit, RAX, operands[2]);
+            emitIndexCheck(jit, operands[3]);
+            if (op == VM_LOAD_INDEX) {
+                emitElementOp(jit, 0x8B, -1, RCX, 4, operands[1]);      // mov b(,%rax,4), %ecx
+                emitStore(jit, RCX, operands[0]);
+            } else {
+                emitElementOp(jit, 0x0F, 0xB6, RCX, 1, operands[1]);    // movzbl b(%rax), %ecx
+                CELL_OP(jit, RCX, operands[0], 0x88);                   // mov %cl, a
+            }
+            break;
+        case VM_STORE_INDEX:
+        case VM_STORE_INDEX_BYTE:
+            emitLoad(jit, RAX, operands[2]);
+            emitIndexCheck(jit, operands[3]);
+            if (op == VM_STORE_INDEX) {
+                emitLoad(jit, RCX, operands[1]);
+                emitElementOp(jit, 0x89, -1, RCX, 4, operands[0]);      // mov %ecx, a(,%rax,4)
+            } else {
+                CELL_OP(jit, RCX, operands[1], 0x0F, 0xB6);             // movzbl b, %ecx
+                emitElementOp(jit, 0x88, -1, RCX, 1, operands[0]);      // mov %cl, a(%rax)
+            }
+            break;
+
+        case VM_ADD:
+        case VM_SUB:
+        case VM_MUL:
+        case VM_DIV:
+            emitIntArithmetic(jit, op, operands);
+            break;
+        case VM_ADD_MOVE:
+        case VM_SUB_MOVE:
+        case VM_MUL_MOVE:
+        case VM_DIV_MOVE:
+            emitIntArithmetic(jit, VM_ADD + (op - VM_ADD_MOVE), operands);
+            emitStore(jit, RAX, operands[3]);
+            break;
+        case VM_FADD:
+        case VM_FSUB:
+        case VM_FMUL:
+        case VM_FDIV:
+            emitFloatArithmetic(jit, op, operands);
+            break;
+        case VM_FADD_MOVE:
+        case VM_FSUB_MOVE:
+        case VM_FMUL_MOVE:
+        case VM_FDIV_MOVE:
+            emitFloatArithmetic(jit, VM_FADD + (op - VM_FADD_MOVE), operands);
+            CELL_OP(jit, 0, operands[3], 0xF3, 0x0F, 0x11);     // movss %xmm0, d
+            break;
+        case VM_INT_TO_FLOAT:
+            CELL_OP(jit, 0, operands[1], 0xF3, 0x0F, 0x2A);     // cvtsi2ssl b, %xmm0
+            CELL_OP(jit, 0, operands[0], 0xF3, 0x0F, 0x11);     // movss %xmm0, a
+            break;
+        case VM_FLOAT_TO_INT:
+            // Truncates, like cvt.w.s does in MARS
+            CELL_OP(jit, RAX, operands[1], 0xF3, 0x0F, 0x2C);   // cvttss2si b, %eax
+            emitStore(jit, RAX, operands[0]);
+            break;
+
+        case VM_WRITE_INT:
+            emitLoad(jit, RDI, operands[0]);
+            emitHelperCall(jit, (const void*)jitWriteInt);
+            break;
+        case VM_WRITE_FLOAT:
+            CELL_OP(jit, 0, operands[0], 0xF3, 0x0F, 0x10);     // movss a, %xmm0
+            emitHelperCall(jit, (const void*)jitWriteFloat);
+            break;
+        case VM_WRITE_CHAR:
+            CELL_OP(jit, RDI, operands[0], 0x0F, 0xB6);         // movzbl a, %edi
+            emitHelperCall(jit, (const void*)jitWriteChar);
+            break;
+        case VM_WRITE_STRING:
+            CELL_OP(jit, RDI, operands[0], 0x48, 0x8D);         // lea a(%rbx), %rdi
+            emitHelperCall(jit, (const void*)jitWriteString);
+            break;
+
+        case VM_CALL:
+            EMIT(jit, 0xE8);                                    // call
+            emitRel32(jit, operands[0], false);
+            break;
+        case VM_JUMP:
+            if (inMain) {
+                // Nothing to return to: the call ends the program
+                EMIT(jit, 0xE8);
+                emitRel32(jit, operands[0], false);
+                emitHalt(jit);
+                break;
+            }
+            emitFunctionExit(jit);
+            EMIT(jit, 0xE9);                                    // jmp
+            emitRel32(jit, operands[0], false);
+            break;
+        case VM_RETURN:
+            if (inMain) {
+                emitHalt(jit);
+                break;
+            }
+            emitFunctionExit(jit);
+            EMIT(jit, 0xC3);                                    // ret
+            break;
+        default:
+            break;
+    }
+}
+
+static void resolveFixups(JITCompiler* jit, const size_t* stubOffsets) {
+    for (int i = 0; i < jit->fixupCount; i++) {
+        JITFixup* fixup = &jit->fixups[i];
+        size_t target = fixup->isStub ? stubOffsets[fixup->target] : jit->nativeOffsets[fixup->target];
+        int32_t rel = (int32_t)((int64_t)target - (int64_t)(fixup->position + 4));
+        memcpy(jit->bytes + fixup->position, &rel, sizeof(rel));
+    }
+}
+
+// Translate the whole program; main's entry is at offset 0
+static void translateProgram(JITCompiler* jit, const VMProgram* program) {
+    // Functions start where calls and jumps go, and main's code ends at the first one
+    bool* isEntry = calloc(program->codeLength + 1, sizeof(bool));
+    uint32_t mainEnd = program->codeLength;
+    for (uint32_t pc = 0; pc < program->codeLength; pc += vmInstrLength(program->code[pc])) {
+        VMOpcode op = program->code[pc];
+        if (op == VM_CALL || op == VM_JUMP) {
+            isEntry[program->code[pc + 1]] = true;
+            if (program->code[pc + 1] < mainEnd) mainEnd = program->code[pc + 1];
+        }
+    }
+
+    // Main's frame: %rbx = memory, %r12d = calls left, %r13 = %rsp to finish with
+    EMIT(jit, 0x53);                    // push %rbx
+    EMIT(jit, 0x41, 0x54);              // push %r12
+    EMIT(jit, 0x41, 0x55);              // push %r13
+    EMIT(jit, 0x48, 0x89, 0xFB);        // mov %rdi, %rbx
+    EMIT(jit, 0x41, 0xBC);              // mov $depth, %r12d
+    emitInt32(jit, JIT_MAX_CALL_DEPTH);
+    EMIT(jit, 0x49, 0x89, 0xE5);        // mov %rsp, %r13
+
+    for (uint32_t pc = 0; pc < program->codeLength; pc += vmInstrLength(program->code[pc])) {
+        jit->nativeOffsets[pc] = jit->length;
+        if (isEntry[pc] && pc > 0) emitFunctionEntry(jit);
+        translateInstr(jit, program, pc, pc < mainEnd);
+    }
+    // Running past the last instruction ends the program instead of reaching a status stub
+    emitHalt(jit);
+
+    size_t stubOffsets[JIT_STATUS_COUNT] = { 0 };
+    for (int status = JIT_DIVISION_BY_ZERO; status < JIT_STATUS_COUNT; status++) {
+        stubOffsets[status] = jit->length;
+        EMIT(jit, 0xB8);                // mov $status, %eax
+        emitInt32(jit, status);
+        emitExit(jit);
+    }
+    resolveFixups(jit, stubOffsets);
+    free(isEntry);
+}
+
+typedef int (*JITEntry)(uint8_t* memory);
+
+bool runJITProgram(VMProgram* program) {
+    if (program->memorySize > INT32_MAX) {
+        fprintf(stderr, "JIT: Program memory is too large\n");
+        return false;
+    }
+
+    JITCompiler jit;
+    memset(&jit, 0, sizeof(jit));
+    jit.nativeOffsets = calloc(program->codeLength + 1, sizeof(size_t));
+    translateProgram(&jit, program);
+
+    // Written while writable, then made executable (never both at once)
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mappedSize = (jit.length + pageSize - 1) / pageSize * pageSize;
+    void* code = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    bool ready = (code != MAP_FAILED);
+    if (ready) {
+        memcpy(code, jit.bytes, jit.length);
+        ready = (mprotect(code, mappedSize, PROT_READ | PROT_EXEC) == 0);
+    }
+    printf("JIT: %zu bytes of machine code for %u words of bytecode\n", jit.length, program->codeLength);
+    free(jit.bytes);
+    free(jit.nativeOffsets);
+    free(jit.fixups);
+    if (!ready) {
+        perror("Failed to map JIT code");
+        if (code != MAP_FAILED) munmap(code, mappedSize);
+        return false;
+    }
+
+    // Progress messages go out before the program's output
+    fflush(stdout);
+    if (!openOutputWriter(&jitWriter, "-")) {
+        perror("Failed to open standard output");
+        munmap(code, mappedSize);
+        return false;
+    }
+    int status = ((JITEntry)code)(program->memory);
+    closeOutputWriter(&jitWriter);
+    munmap(code, mappedSize);
+
+    if (status != JIT_FINISHED) fprintf(stderr, "JIT: %s\n", statusMessages[status]);
+    return status == JIT_FINISHED;
+}
+
+#else
+
+bool runJITProgram(VMProgram* program) {
+    (void)program;
+    fprintf(stderr, "JIT: Only supported on x86-64\n");
+    return false;
+}
+
+#endif
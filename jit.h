@@ -0,0 +1,22 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "vm.h"
+#include <stdbool.h>
+
+// Template JIT for x86-64, used by --run=jit
+//  Each bytecode instruction of a VM program (main's code and every function) is
+//  translated into a fixed sequence of x86-64 machine code in an mmap'd buffer, which
+//  is then made executable and run in-process. The program's memory image is the heap
+//  block its variables live in: %rbx points at it and cells are addressed off %rbx.
+//  Calls are native calls, and output goes through the VM's formatting helpers.
+
+/**
+ * Compile a program to machine code and run it, writing its output buffered to
+ * standard output like runVMProgram().
+ *
+ * @return false if the program stopped with a runtime error, or this isn't an x86-64 build.
+ */
+bool runJITProgram(VMProgram* program);
+
+#endif
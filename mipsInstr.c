@@ -0,0 +1,286 @@
+// mipsInstr.c
+#include "mipsInstr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// What each opcode does to its operands
+typedef struct MIPSOpcodeInfo {
+    const char* name;
+    MIPSKind kind;
+    int defOperand;     // Operand it writes, -1 if none
+    bool single;        // Never expanded into more than one instruction (immediates and
+                        // memory operands are checked separately)
+} MIPSOpcodeInfo;
+
+static const MIPSOpcodeInfo opcodes[MIPSOp_Count] = {
+    [MIPSOp_None]    = {NULL,        MIPSKind_Barrier, -1, false},
+    [MIPSOp_Add]     = {"add",       MIPSKind_Compute,  0, true},
+    [MIPSOp_Addi]    = {"addi",      MIPSKind_Compute,  0, true},
+    [MIPSOp_Addiu]   = {"addiu",     MIPSKind_Compute,  0, true},
+    [MIPSOp_Addu]    = {"addu",      MIPSKind_Compute,  0, true},
+    [MIPSOp_Sub]     = {"sub",       MIPSKind_Compute,  0, true},
+    [MIPSOp_Subu]    = {"subu",      MIPSKind_Compute,  0, true},
+    [MIPSOp_Mul]     = {"mul",       MIPSKind_Compute,  0, false},
+    [MIPSOp_Div]     = {"div",       MIPSKind_Compute, -1, false},
+    [MIPSOp_Mflo]    = {"mflo",      MIPSKind_Compute,  0, true},
+    [MIPSOp_Mfhi]    = {"mfhi",      MIPSKind_Compute,  0, true},
+    [MIPSOp_Sll]     = {"sll",       MIPSKind_Compute,  0, true},
+    [MIPSOp_Srl]     = {"srl",       MIPSKind_Compute,  0, true},
+    [MIPSOp_Li]      = {"li",        MIPSKind_Compute,  0, true},
+    [MIPSOp_La]      = {"la",        MIPSKind_Compute,  0, false},
+    [MIPSOp_Move]    = {"move",      MIPSKind_Compute,  0, true},
+    [MIPSOp_AddS]    = {"add.s",     MIPSKind_Compute,  0, true},
+    [MIPSOp_SubS]    = {"sub.s",     MIPSKind_Compute,  0, true},
+    [MIPSOp_MulS]    = {"mul.s",     MIPSKind_Compute,  0, true},
+    [MIPSOp_DivS]    = {"div.s",     MIPSKind_Compute,  0, true},
+    [MIPSOp_MovS]    = {"mov.s",     MIPSKind_Compute,  0, true},
+    [MIPSOp_NegS]    = {"neg.s",     MIPSKind_Compute,  0, true},
+    [MIPSOp_CvtSW]   = {"cvt.s.w",   MIPSKind_Compute,  0, true},
+    [MIPSOp_CvtWS]   = {"cvt.w.s",   MIPSKind_Compute,  0, true},
+    [MIPSOp_TruncWS] = {"trunc.w.s", MIPSKind_Compute,  0, true},
+    [MIPSOp_Mtc1]    = {"mtc1",      MIPSKind_Compute,  1, true},
+    [MIPSOp_Mfc1]    = {"mfc1",      MIPSKind_Compute,  0, true},
+    [MIPSOp_Lw]      = {"lw",        MIPSKind_Load,     0, true},
+    [MIPSOp_Lb]      = {"lb",        MIPSKind_Load,     0, true},
+    [MIPSOp_LS]      = {"l.s",       MIPSKind_Load,     0, true},
+    [MIPSOp_Sw]      = {"sw",        MIPSKind_Store,   -1, true},
+    [MIPSOp_Sb]      = {"sb",        MIPSKind_Store,   -1, true},
+    [MIPSOp_SS]      = {"s.s",       MIPSKind_Store,   -1, true},
+    [MIPSOp_J]       = {"j",         MIPSKind_Branch,  -1, false},
+    [MIPSOp_Jal]     = {"jal",       MIPSKind_Branch,  -1, false},
+    [MIPSOp_Jr]      = {"jr",        MIPSKind_Branch,  -1, false},
+    [MIPSOp_Beqz]    = {"beqz",      MIPSKind_Branch,  -1, false},
+    [MIPSOp_Bnez]    = {"bnez",      MIPSKind_Branch,  -1, false},
+    [MIPSOp_Bltz]    = {"bltz",      MIPSKind_Branch,  -1, false},
+    [MIPSOp_Bgez]    = {"bgez",      MIPSKind_Branch,  -1, false},
+    [MIPSOp_Bne]     = {"bne",       MIPSKind_Branch,  -1, false},
+    [MIPSOp_Blt]     = {"blt",       MIPSKind_Branch,  -1, false},
+    [MIPSOp_Bge]     = {"bge",       MIPSKind_Branch,  -1, false},
+    [MIPSOp_Syscall] = {"syscall",   MIPSKind_Barrier, -1, false},
+    [MIPSOp_Nop]     = {"nop",       MIPSKind_Nop,     -1, true},
+};
+
+// Assembler name of a register, without the '$'
+static const char* registerName(int reg, char* buffer, size_t size) {
+    static const char* names[32] = {
+        "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3", "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+        "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7", "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+    };
+    if (reg >= 0 && reg < MIPS_FLOAT_REGISTER_BASE) return names[reg];
+    snprintf(buffer, size, "f%d", reg - MIPS_FLOAT_REGISTER_BASE);
+    return buffer;
+}
+
+MIPSOperand mipsRegister(int reg) {
+    return (MIPSOperand){MIPSOperand_Register, reg, 0, NULL};
+}
+
+MIPSOperand mipsImmediate(int value) {
+    return (MIPSOperand){MIPSOperand_Immediate, -1, value, NULL};
+}
+
+MIPSOperand mipsLabel(const char* symbol) {
+    return (MIPSOperand){MIPSOperand_Label, -1, 0, strdup(symbol)};
+}
+
+MIPSOperand mipsMemory(const char* symbol, int offset, int base) {
+    return (MIPSOperand){MIPSOperand_Memory, base, offset, symbol ? strdup(symbol) : NULL};
+}
+
+MIPSInstr makeMIPSInstr(MIPSOpcode op) {
+    MIPSInstr instr = {0};
+    instr.op = op;
+    return instr;
+}
+
+void appendMIPSInstr(MIPSProgram* program, MIPSInstr instr) {
+    if (program->count == program->capacity) {
+        program->capacity = program->capacity ? program->capacity * 2 : 256;
+        program->instrs = realloc(program->instrs, program->capacity * sizeof(MIPSInstr));
+    }
+    program->instrs[program->count++] = instr;
+}
+
+// Append `count` bytes to a growing text buffer
+static void appendText(char** text, size_t* length, size_t* capacity, const char* bytes, size_t count) {
+    if (*length + count + 1 > *capacity) {
+        while (*length + count + 1 > *capacity) *capacity = *capacity ? *capacity * 2 : 4096;
+        *text = realloc(*text, *capacity);
+    }
+    memcpy(*text + *length, bytes, count);
+    *length += count;
+    (*text)[*length] = '\0';
+}
+
+static void appendString(char** text, size_t* length, size_t* capacity, const char* string) {
+    appendText(text, length, capacity, string, strlen(string));
+}
+
+// Assembly text of one operand
+static void formatOperand(const MIPSOperand* operand, char* text, size_t size) {
+    char buffer[8];
+    switch (operand->kind) {
+        case MIPSOperand_Register:
+            snprintf(text, size, "$%s", registerName(operand->reg, buffer, sizeof(buffer)));
+            break;
+        case MIPSOperand_Immediate:
+            snprintf(text, size, "%d", operand->value);
+            break;
+        case MIPSOperand_Label:
+            snprintf(text, size, "%s", operand->symbol);
+            break;
+        case MIPSOperand_Memory: {
+            char address[300];
+            if (!operand->symbol) {
+                snprintf(text, size, "%d($%s)", operand->value, registerName(operand->reg, buffer, sizeof(buffer)));
+                break;
+            }
+            if (operand->value == 0) {
+                snprintf(address, sizeof(address), "%s", operand->symbol);
+            } else {
+                snprintf(address, sizeof(address), "%s%+d", operand->symbol, operand->value);
+            }
+            if (operand->reg < 0) {
+                snprintf(text, size, "%s", address);
+            } else {
+                snprintf(text, size, "%%gp_rel(%s)($%s)", address, registerName(operand->reg, buffer, sizeof(buffer)));
+            }
+            break;
+        }
+    }
+}
+
+char* formatMIPSProgram(const MIPSProgram* program, size_t* length) {
+    char* text = NULL;
+    size_t capacity = 0;
+    *length = 0;
+    appendText(&text, length, &capacity, "", 0);
+    for (int i = 0; i < program->count; i++) {
+        const MIPSInstr* instr = &program->instrs[i];
+        if (instr->label) {
+            appendString(&text, length, &capacity, instr->label);
+            appendText(&text, length, &capacity, ":\n", 2);
+        } else if (!instr->op) {
+            if (instr->comment) {
+                appendText(&text, length, &capacity, "#", 1);
+                appendString(&text, length, &capacity, instr->comment);
+            }
+            appendText(&text, length, &capacity, "\n", 1);
+        } else {
+            appendText(&text, length, &capacity, "\t", 1);
+            appendString(&text, length, &capacity, opcodes[instr->op].name);
+            for (int j = 0; j < instr->operandCount; j++) {
+                char operand[320];
+                formatOperand(&instr->operands[j], operand, sizeof(operand));
+                appendText(&text, length, &capacity, (j == 0) ? " " : ", ", (j == 0) ? 1 : 2);
+                appendString(&text, length, &capacity, operand);
+            }
+            if (instr->comment) {
+                appendText(&text, length, &capacity, " #", 2);
+                appendString(&text, length, &capacity, instr->comment);
+            }
+            appendText(&text, length, &capacity, "\n", 1);
+        }
+    }
+    return text;
+}
+
+void freeMIPSInstr(MIPSInstr* instr) {
+    free(instr->label);
+    for (int i = 0; i < instr->operandCount; i++) free(instr->operands[i].symbol);
+    free(instr->comment);
+}
+
+void freeMIPSProgram(MIPSProgram* program) {
+    for (int i = 0; i < program->count; i++) freeMIPSInstr(&program->instrs[i]);
+    free(program->instrs);
+    program->instrs = NULL;
+    program->count = program->capacity = 0;
+}
+
+MIPSKind mipsInstrKind(const MIPSInstr* instr) {
+    return opcodes[instr->op].kind;
+}
+
+bool mipsSameOperand(const MIPSOperand* a, const MIPSOperand* b) {
+    if (a->kind != b->kind || a->reg != b->reg || a->value != b->value) return false;
+    if (!a->symbol || !b->symbol) return a->symbol == b->symbol;
+    return strcmp(a->symbol, b->symbol) == 0;
+}
+
+int mipsDefOperand(const MIPSInstr* instr) {
+    int defOperand = opcodes[instr->op].defOperand;
+    return (defOperand < instr->operandCount) ? defOperand : -1;
+}
+
+// Add the register `operand` names or addresses through to `regs`
+static void addOperandRegisters(const MIPSOperand* operand, int* regs, int* count) {
+    if (operand->kind != MIPSOperand_Register && operand->kind != MIPSOperand_Memory) return;
+    if (operand->reg > 0 && *count < MIPS_MAX_REGISTER_REFS - 1) regs[(*count)++] = operand->reg;  // $zero never carries a dependency
+}
+
+void mipsInstrRegisters(const MIPSInstr* instr, int* defs, int* defCount, int* uses, int* useCount) {
+    *defCount = 0;
+    *useCount = 0;
+    if (!instr->op) return;
+
+    int defOperand = mipsDefOperand(instr);
+    for (int i = 0; i < instr->operandCount; i++) {
+        addOperandRegisters(&instr->operands[i], (i == defOperand) ? defs : uses, (i == defOperand) ? defCount : useCount);
+    }
+
+    switch (instr->op) {
+        case MIPSOp_Mflo:
+        case MIPSOp_Mfhi:
+            uses[(*useCount)++] = MIPS_HILO_REGISTER;
+            break;
+        case MIPSOp_Div:
+            defs[(*defCount)++] = MIPS_HILO_REGISTER;
+            break;
+        case MIPSOp_Jal:
+            defs[(*defCount)++] = MIPS_RA;
+            break;
+        case MIPSOp_Syscall:
+            uses[(*useCount)++] = MIPS_V0;
+            uses[(*useCount)++] = MIPS_A0;
+            uses[(*useCount)++] = MIPS_A1;
+            uses[(*useCount)++] = MIPS_F(12);
+            defs[(*defCount)++] = MIPS_V0;
+            break;
+        default:
+            break;
+    }
+}
+
+const char* mipsMemorySymbol(const MIPSInstr* instr) {
+    if (instr->operandCount < 2 || instr->operands[1].kind != MIPSOperand_Memory) return NULL;
+    return instr->operands[1].symbol;
+}
+
+int mipsResultLatency(const MIPSInstr* instr) {
+    if (mipsInstrKind(instr) == MIPSKind_Load || instr->op == MIPSOp_Mfc1) return 2;
+    return 1;
+}
+
+bool isSingleMachineInstr(const MIPSInstr* instr) {
+    MIPSKind kind = mipsInstrKind(instr);
+    if (kind == MIPSKind_Load || kind == MIPSKind_Store) {
+        // A bare label needs its address built first
+        return instr->operandCount == 2 && instr->operands[1].kind == MIPSOperand_Memory && instr->operands[1].reg >= 0;
+    }
+    if (!opcodes[instr->op].single) return false;
+
+    // Immediates must fit the 16-bit field
+    if (instr->operandCount > 0) {
+        const MIPSOperand* last = &instr->operands[instr->operandCount - 1];
+        if (last->kind == MIPSOperand_Immediate && (last->value < -32768 || last->value > 65535)) return false;
+    }
+    return true;
+}
+
+void renameMIPSRegisters(MIPSInstr* instr, int index, const int* newRegs) {
+    MIPSOperand* operand = &instr->operands[index];
+    if (operand->kind != MIPSOperand_Register && operand->kind != MIPSOperand_Memory) return;
+    if (operand->reg >= 0 && newRegs[operand->reg] >= 0) operand->reg = newRegs[operand->reg];
+}
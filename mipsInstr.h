@@ -0,0 +1,134 @@
+#ifndef MIPS_INSTR_H
+#define MIPS_INSTR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Generated MIPS code held as one record per line, so passes can work on the
+// machine code before it is written out
+
+#define MIPS_MAX_OPERANDS 3
+
+// Register numbers: $0-$31 are the integer registers, then the float registers,
+// then HI/LO and the FPU condition flag (only used by the def/use queries)
+enum {
+    MIPS_ZERO, MIPS_AT, MIPS_V0, MIPS_V1, MIPS_A0, MIPS_A1, MIPS_A2, MIPS_A3,
+    MIPS_T0, MIPS_T1, MIPS_T2, MIPS_T3, MIPS_T4, MIPS_T5, MIPS_T6, MIPS_T7,
+    MIPS_S0, MIPS_S1, MIPS_S2, MIPS_S3, MIPS_S4, MIPS_S5, MIPS_S6, MIPS_S7,
+    MIPS_T8, MIPS_T9, MIPS_K0, MIPS_K1, MIPS_GP, MIPS_SP, MIPS_FP, MIPS_RA
+};
+#define MIPS_FLOAT_REGISTER_BASE 32
+#define MIPS_F(n) (MIPS_FLOAT_REGISTER_BASE + (n))
+#define MIPS_HILO_REGISTER 64
+#define MIPS_FCC_REGISTER 65
+#define MIPS_REGISTER_COUNT 66
+#define MIPS_MAX_REGISTER_REFS 6
+
+// Opcodes the code generator emits; MIPSOp_None marks a line that isn't an instruction
+typedef enum MIPSOpcode {
+    MIPSOp_None,
+    MIPSOp_Add, MIPSOp_Addi, MIPSOp_Addiu, MIPSOp_Addu, MIPSOp_Sub, MIPSOp_Subu,
+    MIPSOp_Mul, MIPSOp_Div,             // div is the two-operand form, quotient in LO and remainder in HI
+    MIPSOp_Mflo, MIPSOp_Mfhi, MIPSOp_Sll, MIPSOp_Srl,
+    MIPSOp_Li, MIPSOp_La, MIPSOp_Move,
+    MIPSOp_AddS, MIPSOp_SubS, MIPSOp_MulS, MIPSOp_DivS, MIPSOp_MovS, MIPSOp_NegS,
+    MIPSOp_CvtSW, MIPSOp_CvtWS, MIPSOp_TruncWS, MIPSOp_Mtc1, MIPSOp_Mfc1,
+    MIPSOp_Lw, MIPSOp_Lb, MIPSOp_LS, MIPSOp_Sw, MIPSOp_Sb, MIPSOp_SS,
+    MIPSOp_J, MIPSOp_Jal, MIPSOp_Jr,
+    MIPSOp_Beqz, MIPSOp_Bnez, MIPSOp_Bltz, MIPSOp_Bgez, MIPSOp_Bne, MIPSOp_Blt, MIPSOp_Bge,
+    MIPSOp_Syscall, MIPSOp_Nop,
+    MIPSOp_Count
+} MIPSOpcode;
+
+// What an instruction does, as far as reordering it is concerned
+typedef enum {
+    MIPSKind_Compute,   // Reads and writes registers only
+    MIPSKind_Load,      // Also reads memory
+    MIPSKind_Store,     // Also writes memory
+    MIPSKind_Branch,    // Jump, call or branch: ends a basic block
+    MIPSKind_Barrier,   // syscall: nothing moves across it
+    MIPSKind_Nop
+} MIPSKind;
+
+typedef enum {
+    MIPSOperand_Register,   // `reg`
+    MIPSOperand_Immediate,  // `value`
+    MIPSOperand_Label,      // `symbol`: a jump target, or the address la loads
+    MIPSOperand_Memory      // `symbol`+`value`, `value`(`reg`), or %gp_rel(`symbol`+`value`)(`reg`)
+} MIPSOperandKind;
+
+typedef struct MIPSOperand {
+    MIPSOperandKind kind;
+    int reg;            // Register, or the base register of a memory operand (-1 for a bare label)
+    int value;          // Immediate, or the byte offset of a memory operand
+    char* symbol;       // Label, NULL for a memory operand addressed by register only
+} MIPSOperand;
+
+// One line of MIPS code
+//  An instruction has `op` set. Otherwise the line is a label (`label` set), a comment
+//  line (`comment` set) or blank.
+typedef struct MIPSInstr {
+    char* label;
+    MIPSOpcode op;
+    MIPSOperand operands[MIPS_MAX_OPERANDS];
+    int operandCount;
+    char* comment;      // Trailing comment of an instruction, without the '#'
+} MIPSInstr;
+
+typedef struct MIPSProgram {
+    MIPSInstr* instrs;
+    int count;
+    int capacity;
+} MIPSProgram;
+
+// Operands; the program takes ownership of them along with their instruction
+MIPSOperand mipsRegister(int reg);
+MIPSOperand mipsImmediate(int value);
+MIPSOperand mipsLabel(const char* symbol);
+MIPSOperand mipsMemory(const char* symbol, int offset, int base);
+
+// Instruction with no operands or comment, e.g. nop
+MIPSInstr makeMIPSInstr(MIPSOpcode op);
+
+void appendMIPSInstr(MIPSProgram* program, MIPSInstr instr);
+
+// Assembly text of every line of `program`, as one malloc'd string of `length` bytes
+char* formatMIPSProgram(const MIPSProgram* program, size_t* length);
+
+void freeMIPSProgram(MIPSProgram* program);
+void freeMIPSInstr(MIPSInstr* instr);
+
+MIPSKind mipsInstrKind(const MIPSInstr* instr);
+
+// Do two operands name the same register, value or address?
+bool mipsSameOperand(const MIPSOperand* a, const MIPSOperand* b);
+
+// Index of the operand this instruction writes to, -1 if none
+int mipsDefOperand(const MIPSInstr* instr);
+
+/**
+ * Registers an instruction writes and reads.
+ * Both arrays must hold MIPS_MAX_REGISTER_REFS entries.
+ * Calls also write $ra (the registers the callee uses are not listed), and a
+ * syscall reads $v0, $a0, $a1 and $f12 and writes $v0.
+ */
+void mipsInstrRegisters(const MIPSInstr* instr, int* defs, int* defCount, int* uses, int* useCount);
+
+/**
+ * Label a load or store accesses.
+ * Returns NULL for accesses through a register ("0($t1)"), which may touch anything.
+ */
+const char* mipsMemorySymbol(const MIPSInstr* instr);
+
+// Cycles after issue before another instruction can use the result without stalling
+int mipsResultLatency(const MIPSInstr* instr);
+
+// Does the assembler turn this into exactly one machine instruction?
+//  Only those can go in a branch delay slot.
+bool isSingleMachineInstr(const MIPSInstr* instr);
+
+// Rename the registers in operand `index` at once: register n becomes newRegs[n],
+// or stays as it is where that is -1
+void renameMIPSRegisters(MIPSInstr* instr, int index, const int* newRegs);
+
+#endif
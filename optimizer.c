@@ -1,21 +1,36 @@
 #include "optimizer.h"
 #include "codeGenerator.h"
+#include "interpreter.h"
+#include "commons/options.h"
+#include "commons/outputWriter.h"
 #include <stdbool.h>
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <math.h>
 
 // Optimize the TAC by applying constant folding, propagation, and dead code elimination.
 TAC* optimizeTAC(TAC* head) {
     //Need to use global `tacHead` rather than the parameter because of seg fault errors when the head gets freed in some cases
     //Design-wise? I hate it. It will have to do for now.
 
-    // constantFolding(&head);          // Simplify constant expressions
-                                        // (Not really needed due to the structure of our TACs, const propagation handles this)
+    inlineFunctions(options.inlineThreshold);  // Splice small callees into their callers
+    copyPropagationAll();                       // Forward stored/loaded values to later loads, across calls that don't touch them
+    constantFoldingAll();                       // Fold constants so call sites see literal arguments
+    valueNumberingAll();                        // Share repeated arithmetic and repeated pure calls
+    evaluateConstantCalls(options.evalBudget);  // Run pure calls with constant arguments at compile time
+    constantFoldingAll();                       // Fold what those results feed into
+    specializeFunctions(options.cloneBudget);   // Clone functions for calls with constant arguments
+    evaluateConstantProgram(options.evalBudget); // Replace main with its output if the whole program is constant
+    coalesceWritesAll();                        // Print runs of constant writes as one string
+    hoistStaticInitializers();                  // Turn main's first constant stores into .data values
+    deadCodeEliminationAll();                   // Drop temps nothing reads anymore
+    layoutFunctions(options.affinityLayout);    // Drop functions main never reaches, then order the rest
+    lowerTailCalls();                           // Turn calls in return position into jumps
+
     constantPropagation(&tacHead);      // Propagate constants through the TAC
-    copyPropagation(&tacHead);          // Replace variables with assigned values
-    // deadCodeElimination(&head);      // Remove unused assignments
     return head;  // Return the optimized TAC list
 }
 
@@ -129,122 +144,1424 @@ bool constantCheck(TAC* start, TAC** arg1Return, TAC** arg2Return)
 }
 
 
+// Check if a name is a compiler temp (i0, f12, c3, ...)
+bool isTempVar(const char* name) {
+    if (!name || (name[0] != 'i' && name[0] != 'f' && name[0] != 'c') || !isdigit(name[1])) return false;
+    for (const char* cursor = name + 1; *cursor; cursor++) {
+        if (!isdigit(*cursor)) return false;
+    }
+    return true;
+}
+
+// Type of a compiler temp, taken from its prefix
+VarType tempVarType(const char* name) {
+    switch (name[0]) {
+        case 'f': return VarType_Float;
+        case 'c': return VarType_Char;
+        default: return VarType_Int;
+    }
+}
+
+// Get the FuncTAC a functionCall TAC jumps to (arg1 of the call is the function label)
+FuncTAC* findCallee(TAC* call) {
+    return findFuncTAC(call->arg1);
+}
+
+// Number of TACs in a list up to its first return, not counting funcStart
+static int tacListSize(TAC* head) {
+    int size = 0;
+    for (TAC* current = head; current && strcmp(current->op, "return") != 0; current = current->next) {
+        if (strcmp(current->op, "funcStart") != 0) size++;
+    }
+    return size;
+}
+
+// Cost of inlining a function: the number of TACs up to its first return
+//  funcStart and return disappear when the body is spliced in, so they are free
+int funcSize(FuncTAC* funcTac) {
+    return tacListSize(funcTac->func);
+}
+
+// Check if `from` can reach `target` through calls, looking at most `depth` calls deep
+bool callsFunction(FuncTAC* from, FuncTAC* target, int depth) {
+    if (depth <= 0) return false;
+    for (TAC* current = from->func; current; current = current->next) {
+        if (strcmp(current->op, "functionCall") != 0) continue;
+        FuncTAC* callee = findCallee(current);
+        if (!callee) continue;
+        if (callee == target || callsFunction(callee, target, depth - 1)) return true;
+    }
+    return false;
+}
+
+// Check if a function can call itself, directly or through other functions
+bool isRecursive(FuncTAC* funcTac) {
+    int funcCount = 0;
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) funcCount++;
+    return callsFunction(funcTac, funcTac, funcCount);
+}
+
+// Check if a function stores to one of its own variables (parameters included)
+static bool funcWritesVar(FuncTAC* funcTac, const char* varName) {
+    for (TAC* current = funcTac->func; current; current = current->next) {
+        if (current->result && strncmp(current->op, "store.", 6) == 0 && strcmp(current->result, varName) == 0) return true;
+    }
+    return false;
+}
+
+// Name-to-name map, used for temp renaming and for tracking constant temps
+//  Keys are borrowed from the TACs, values are owned by the map
+typedef struct NameMap {
+    const char** keys;
+    char** values;
+    int count;
+    int capacity;
+} NameMap;
+
+static void addMapping(NameMap* map, const char* key, const char* value) {
+    if (map->count == map->capacity) {
+        map->capacity = map->capacity ? map->capacity * 2 : 16;
+        map->keys = realloc(map->keys, map->capacity * sizeof(char*));
+        map->values = realloc(map->values, map->capacity * sizeof(char*));
+    }
+    map->keys[map->count] = key;
+    map->values[map->count] = strdup(value);
+    map->count++;
+}
+
+// Value mapped to `key`, or NULL if there is none
+static const char* findMapping(NameMap* map, const char* key) {
+    if (!key) return NULL;
+    for (int i = map->count - 1; i >= 0; i--) {
+        if (strcmp(map->keys[i], key) == 0) return map->values[i];
+    }
+    return NULL;
+}
+
+// Renamed version of `name`, or `name` itself if it isn't renamed
+static const char* lookupRename(NameMap* map, const char* name) {
+    const char* renamed = findMapping(map, name);
+    return renamed ? renamed : name;
+}
+
+static void freeNameMap(NameMap* map) {
+    for (int i = 0; i < map->count; i++) free(map->values[i]);
+    free(map->keys);
+    free(map->values);
+}
+
+// Replace every use of `oldName` after `start` with `newName`
+static void replaceUses(TAC* start, const char* oldName, const char* newName) {
+    for (TAC* current = start; current; current = current->next) {
+        if (current->arg1 && strcmp(current->arg1, oldName) == 0) {
+            free(current->arg1);
+            current->arg1 = strdup(newName);
+        }
+        if (current->arg2 && strcmp(current->arg2, oldName) == 0) {
+            free(current->arg2);
+            current->arg2 = strdup(newName);
+        }
+    }
+}
+
+// Replace a functionCall TAC with a copy of the callee body
+//  Parameters the callee never writes are bound straight to the argument temps, so their
+//  loads vanish. Parameters it does write get a store from the argument temp instead.
+//  Temps defined in the body are renamed so they stay single-definition.
+//  Returns the first TAC after the call's arguments, where scanning should resume.
+TAC* inlineCall(TAC** head, TAC** tail, TAC* call, FuncTAC* callee) {
+    printf("OPTIMIZER (inlineFunctions): Inlining call to %s\n", callee->funcName);
+    NameMap map = { NULL, NULL, 0, 0 };
+
+    //Arguments are contiguous right before the call, optionally preceded by reserveArgs
+    TAC* firstArg = call;
+    while (firstArg->prev && (strncmp(firstArg->prev->op, "arg.", 4) == 0 || strcmp(firstArg->prev->op, "reserveArgs") == 0)) {
+        firstArg = firstArg->prev;
+        if (strcmp(firstArg->op, "reserveArgs") == 0) break;
+    }
+
+    TAC* resume = NULL;
+    for (TAC* arg = firstArg; arg != call; arg = arg->next) {
+        if (strncmp(arg->op, "arg.", 4) != 0) continue;
+        if (isTempVar(arg->arg1) && !funcWritesVar(callee, arg->result)) {
+            addMapping(&map, arg->result, arg->arg1);
+        } else {
+            char storeOp[20];
+            snprintf(storeOp, 20, "store.%s", arg->op + 4);
+            TAC* copyInstr = createTAC(arg->result, arg->arg1, storeOp, NULL);
+            insertTACBefore(head, firstArg, copyInstr);
+            if (!resume) resume = copyInstr;
+        }
+    }
+
+    //Clone the body up to the first return; straight-line code never gets past it
+    char* returnValue = NULL;
+    for (TAC* current = callee->func; current && strcmp(current->op, "return") != 0; current = current->next) {
+        if (strcmp(current->op, "funcStart") == 0) continue;
+
+        if (strncmp(current->op, "setReturn.", 10) == 0) {
+            returnValue = strdup(lookupRename(&map, current->arg1));
+            continue;
+        }
+
+        //Loads of a bound parameter become uses of the argument temp
+        if (strncmp(current->op, "load.", 5) == 0 && !current->arg2 && lookupRename(&map, current->arg1) != current->arg1
+            && !isTempVar(current->arg1)) {
+            addMapping(&map, current->result, lookupRename(&map, current->arg1));
+            continue;
+        }
+
+        char* result = NULL;
+        if (isTempVar(current->result)) {
+            result = createTempVar(tempVarType(current->result));
+            addMapping(&map, current->result, result);
+        }
+        TAC* clone = createTAC(
+            result ? result : current->result,
+            (char*)lookupRename(&map, current->arg1),
+            current->op,
+            (char*)lookupRename(&map, current->arg2)
+        );
+        free(result);
+        insertTACBefore(head, firstArg, clone);
+        if (!resume) resume = clone;
+    }
+
+    //The call's result temp now refers to the callee's return value
+    if (call->result && returnValue) {
+        replaceUses(call->next, call->result, returnValue);
+    }
+    free(returnValue);
+    freeNameMap(&map);
+
+    //Drop the argument passing and the call itself
+    TAC* current = firstArg;
+    while (current != call) {
+        TAC* next = current->next;
+        removeTACFromList(head, tail, &current);
+        current = next;
+    }
+    TAC* next = call->next;
+    removeTACFromList(head, tail, &call);
+    return resume ? resume : next;
+}
+
+// Inline calls in one TAC list. `owner` is the function the list belongs to, NULL for main.
+static void inlineCallsInList(TAC** head, TAC** tail, FuncTAC* owner, int threshold) {
+    TAC* current = *head;
+    while (current) {
+        if (strcmp(current->op, "functionCall") == 0) {
+            FuncTAC* callee = findCallee(current);
+            //A non-void call needs a setReturn to take its value from
+            bool hasReturnValue = !current->result;
+            if (callee) {
+                for (TAC* body = callee->func; body && strcmp(body->op, "return") != 0; body = body->next) {
+                    if (strncmp(body->op, "setReturn.", 10) == 0) hasReturnValue = true;
+                }
+            }
+            if (callee && callee != owner && hasReturnValue && funcSize(callee) <= threshold && !isRecursive(callee)) {
+                current = inlineCall(head, tail, current, callee);
+                continue;
+            }
+        }
+        current = current->next;
+    }
+}
+
+// Inline every call to a small, non-recursive function
+//  `threshold` is the largest callee size (see funcSize) worth inlining; 0 turns inlining off.
+//  Callees keep their own body, since other calls may still need it.
+void inlineFunctions(int threshold) {
+    if (threshold <= 0) return;
+
+    inlineCallsInList(&tacHead, &tacTail, NULL, threshold);
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) {
+        TAC** funcTail = getFuncTACTail(currentFunc);
+        inlineCallsInList(&currentFunc->func, funcTail, currentFunc, threshold);
+    }
+}
+
+// Format a folded float so it reads back as the exact same single-precision value
+static void formatFloatConstant(char* buffer, size_t size, float value) {
+    InterpValue constant = { .type = VarType_Float, .floatValue = value };
+    formatInterpValue(constant, buffer, size);
+}
+
+// Evaluate an arithmetic TAC ("+.int", "/.float", ...) on constant operands
+//  Returns false if the result can't be computed at compile time: division by zero,
+//  or an int overflow that `add`/`sub` would trap on at runtime
+static bool foldArithmetic(const char* op, const char* value1, const char* value2, char* folded, size_t size) {
+    char operator = op[0];
+    if (strcmp(op + 1, ".int") == 0) {
+        long long a = atoll(value1);
+        long long b = atoll(value2);
+        long long result;
+        switch (operator) {
+            case '+': result = a + b; break;
+            case '-': result = a - b; break;
+            case '*': result = a * b; break;
+            case '/':
+                if (b == 0 || (a == INT_MIN && b == -1)) return false;
+                result = a / b;
+                break;
+            default: return false;
+        }
+        if (result < INT_MIN || result > INT_MAX) return false;
+        snprintf(folded, size, "%lld", result);
+        return true;
+    }
+    if (strcmp(op + 1, ".float") == 0) {
+        float a = strtof(value1, NULL);
+        float b = strtof(value2, NULL);
+        float result;
+        switch (operator) {
+            case '+': result = a + b; break;
+            case '-': result = a - b; break;
+            case '*': result = a * b; break;
+            case '/': result = a / b; break;
+            default: return false;
+        }
+        if (!isfinite(result)) return false;
+        formatFloatConstant(folded, size, result);
+        return true;
+    }
+    return false;
+}
+
+// Turn a TAC into "result = value assign.<type>"
+static void rewriteAsAssign(TAC* current, const char* type, const char* value) {
+    char assignOp[20];
+    snprintf(assignOp, 20, "assign.%s", type);
+    free(current->op);
+    free(current->arg1);
+    free(current->arg2);
+    current->op = strdup(assignOp);
+    current->arg1 = strdup(value);
+    current->arg2 = NULL;
+}
+
+// Perform constant folding on the typed TAC ops.
+//  Temps are single-definition, so once a temp is assigned a constant it keeps it.
+//  Arithmetic, int-to-float conversion and temp-to-temp copies with constant operands
+//  become assigns. float-to-int is left alone, since its rounding is up to the FPU mode.
+void constantFolding(TAC** head) {
+    NameMap constants = { NULL, NULL, 0, 0 };
+
+    for (TAC* current = *head; current; current = current->next) {
+        if (!isTempVar(current->result)) continue;
+
+        if (strncmp(current->op, "assign.", 7) == 0) {
+            addMapping(&constants, current->result, current->arg1);
+            continue;
+        }
+
+        const char* value1 = findMapping(&constants, current->arg1);
+        const char* value2 = findMapping(&constants, current->arg2);
+        char folded[40];
+        const char* type = NULL;
+
+        if (strncmp(current->op, "load.", 5) == 0 && !current->arg2 && value1) {
+            type = current->op + 5;   //Copy of a constant temp
+            snprintf(folded, 40, "%s", value1);
+        } else if (strcmp(current->op, "intToFloat") == 0 && value1) {
+            type = "float";
+            formatFloatConstant(folded, 40, (float)atoi(value1));
+        } else if (value1 && value2 && current->op[1] == '.' && foldArithmetic(current->op, value1, value2, folded, 40)) {
+            type = current->op + 2;
+        }
+
+        if (type) {
+            printf("OPTIMIZER (constantFolding): %s folded to %s\n", current->result, folded);
+            rewriteAsAssign(current, type, folded);
+            addMapping(&constants, current->result, folded);
+        }
+    }
+    freeNameMap(&constants);
+}
+
+// Fold constants in main and every function
+void constantFoldingAll() {
+    constantFolding(&tacHead);
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) {
+        constantFolding(&currentFunc->func);
+    }
+}
+
+// Check if any TAC from `start` on reads `name`
+static bool isUsed(TAC* start, const char* name) {
+    for (TAC* current = start; current; current = current->next) {
+        if ((current->arg1 && strcmp(current->arg1, name) == 0) || (current->arg2 && strcmp(current->arg2, name) == 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Perform dead code elimination on TAC instructions.
+//  Removes TACs that only define a temp nobody reads. Calls are kept for their side effects.
+//  Repeats until nothing changes, since removing one TAC can make its operands dead.
+void deadCodeElimination(TAC** head, TAC** tail) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        TAC* current = *head;
+        while (current) {
+            TAC* next = current->next;
+            if (isTempVar(current->result) && strcmp(current->op, "functionCall") != 0 && !isUsed(current->next, current->result)) {
+                printf("OPTIMIZER (deadCodeElimination): Removing the following TAC:\n");
+                printTAC(current);
+                removeTACFromList(head, tail, &current);
+                changed = true;
+            }
+            current = next;
+        }
+    }
+}
+
+// Remove dead code from main and every function
+void deadCodeEliminationAll() {
+    deadCodeElimination(&tacHead, &tacTail);
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) {
+        deadCodeElimination(&currentFunc->func, getFuncTACTail(currentFunc));
+    }
+}
+
+// Set of names with owned copies, so it survives TACs being freed
+typedef struct NameSet {
+    char** names;
+    int count;
+    int capacity;
+} NameSet;
+
+static bool setContains(NameSet* set, const char* name) {
+    for (int i = 0; i < set->count; i++) {
+        if (strcmp(set->names[i], name) == 0) return true;
+    }
+    return false;
+}
+
+// Add a name to the set. Returns true if it wasn't there yet.
+static bool setAdd(NameSet* set, const char* name) {
+    if (setContains(set, name)) return false;
+    if (set->count == set->capacity) {
+        set->capacity = set->capacity ? set->capacity * 2 : 16;
+        set->names = realloc(set->names, set->capacity * sizeof(char*));
+    }
+    set->names[set->count++] = strdup(name);
+    return true;
+}
+
+// Add every name of `from` to `to`. Returns true if `to` grew.
+static bool setUnion(NameSet* to, NameSet* from) {
+    bool grew = false;
+    for (int i = 0; i < from->count; i++) {
+        if (setAdd(to, from->names[i])) grew = true;
+    }
+    return grew;
+}
+
+static void freeNameSet(NameSet* set) {
+    for (int i = 0; i < set->count; i++) free(set->names[i]);
+    free(set->names);
+    set->names = NULL;
+    set->count = set->capacity = 0;
+}
+
+// Call graph node with the variables (globals, arrays, parameters and locals) a
+// function may read and write, including everything its callees may touch
+typedef struct FuncSummary {
+    FuncTAC* func;
+    NameSet callees;    //Labels of the functions called directly
+    NameSet reads;
+    NameSet writes;
+    bool callsUnknown;  //Calls something that isn't a known FuncTAC; may touch anything
+    FuncPurity purity;
+    struct FuncSummary* next;
+} FuncSummary;
+
+static FuncSummary* funcSummaries = NULL;
+
+// Get the summary of a function, NULL if summaries haven't been built for it
+FuncSummary* getFuncSummary(FuncTAC* funcTac) {
+    for (FuncSummary* summary = funcSummaries; summary; summary = summary->next) {
+        if (summary->func == funcTac) return summary;
+    }
+    return NULL;
+}
+
+static void freeFuncSummaries() {
+    while (funcSummaries) {
+        FuncSummary* next = funcSummaries->next;
+        freeNameSet(&funcSummaries->callees);
+        freeNameSet(&funcSummaries->reads);
+        freeNameSet(&funcSummaries->writes);
+        free(funcSummaries);
+        funcSummaries = next;
+    }
+}
+
+// Build the call graph and the transitive mod/ref summary of every function
+//  Temps are private to the list that defines them, so only named variables are tracked.
+//  A callee receives its parameters by spilling them to memory, so calling a function
+//  counts as writing all of its parameters.
+void buildFuncSummaries() {
+    freeFuncSummaries();
+
+    //Direct effects of each function
+    FuncSummary** tail = &funcSummaries;
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) {
+        FuncSummary* summary = calloc(1, sizeof(FuncSummary));
+        summary->func = currentFunc;
+        for (FuncParam* param = currentFunc->params; param; param = param->next) {
+            setAdd(&summary->writes, param->name);
+        }
+        for (TAC* current = currentFunc->func; current; current = current->next) {
+            if (strcmp(current->op, "functionCall") == 0 || strcmp(current->op, "tailCall") == 0) {
+                setAdd(&summary->callees, current->arg1);
+            } else if (strncmp(current->op, "load.", 5) == 0 && !isTempVar(current->arg1)) {
+                setAdd(&summary->reads, current->arg1);
+            } else if (strncmp(current->op, "store.", 6) == 0) {
+                setAdd(&summary->writes, current->result);
+            } else if (strcmp(current->op, "write.charArray") == 0) {
+                setAdd(&summary->reads, current->arg1);
+            }
+        }
+        *tail = summary;
+        tail = &summary->next;
+    }
+
+    //Fold in the effects of callees until nothing changes (handles recursion)
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (FuncSummary* summary = funcSummaries; summary; summary = summary->next) {
+            for (int i = 0; i < summary->callees.count; i++) {
+                FuncSummary* callee = getFuncSummary(findFuncTAC(summary->callees.names[i]));
+                if (!callee) {
+                    if (!summary->callsUnknown) changed = true;
+                    summary->callsUnknown = true;
+                    continue;
+                }
+                if (setUnion(&summary->reads, &callee->reads)) changed = true;
+                if (setUnion(&summary->writes, &callee->writes)) changed = true;
+                if (callee->callsUnknown && !summary->callsUnknown) {
+                    summary->callsUnknown = true;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    classifyPurity();
+}
+
+// Check if a variable belongs to a function (one of its parameters or locals)
+//  Function variables are named "<function>.<name>_var", and the function label is
+//  "<function>_var_func" (plus a suffix for specialized clones)
+static bool isOwnVar(FuncTAC* funcTac, const char* varName) {
+    const char* labelEnd = strstr(funcTac->funcName, "_var_func");
+    size_t baseLength = labelEnd ? (size_t)(labelEnd - funcTac->funcName) : strlen(funcTac->funcName);
+    return strncmp(varName, funcTac->funcName, baseLength) == 0 && varName[baseLength] == '.';
+}
+
+// Check if a variable is one of a function's parameters
+static bool isParam(FuncTAC* funcTac, const char* varName) {
+    for (FuncParam* param = funcTac->params; param; param = param->next) {
+        if (strcmp(param->name, varName) == 0) return true;
+    }
+    return false;
+}
+
+// Classify every summarized function as pure, read-only or impure
+//      Impure: writes output, stores to a variable it doesn't own, or keeps state
+//  between calls (stores a local that it reads before storing), directly or in a callee.
+//      Read-only: otherwise, but its result depends on memory it didn't set during the
+//  call (a variable read before it is stored), directly or in a callee.
+//      Pure: the result only depends on the arguments.
+//  Only the code up to the first return counts; nothing after it runs.
+void classifyPurity() {
+    for (FuncSummary* summary = funcSummaries; summary; summary = summary->next) {
+        FuncTAC* func = summary->func;
+        NameSet stored = { NULL, 0, 0 };
+        NameSet readFirst = { NULL, 0, 0 };   //Variables read before this call stores them
+        summary->purity = summary->callsUnknown ? Purity_Impure : Purity_Pure;
+
+        for (TAC* current = func->func; current && strcmp(current->op, "return") != 0; current = current->next) {
+            if (strncmp(current->op, "write.", 6) == 0) {
+                summary->purity = Purity_Impure;
+            } else if (strncmp(current->op, "store.", 6) == 0) {
+                if (!isOwnVar(func, current->result) || setContains(&readFirst, current->result)) summary->purity = Purity_Impure;
+                if (!strstr(current->op, "Index")) setAdd(&stored, current->result);
+            } else if (strncmp(current->op, "load.", 5) == 0 && !isTempVar(current->arg1)) {
+                if (!isParam(func, current->arg1) && !setContains(&stored, current->arg1)) setAdd(&readFirst, current->arg1);
+            }
+        }
+        if (summary->purity == Purity_Pure && readFirst.count > 0) summary->purity = Purity_ReadOnly;
+        freeNameSet(&stored);
+        freeNameSet(&readFirst);
+    }
+
+    //A function is at best as pure as the functions it calls
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (FuncSummary* summary = funcSummaries; summary; summary = summary->next) {
+            for (int i = 0; i < summary->callees.count; i++) {
+                FuncSummary* callee = getFuncSummary(findFuncTAC(summary->callees.names[i]));
+                FuncPurity calleePurity = callee ? callee->purity : Purity_Impure;
+                if (calleePurity > summary->purity) {
+                    summary->purity = calleePurity;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for (FuncSummary* summary = funcSummaries; summary; summary = summary->next) {
+        printf("OPTIMIZER (classifyPurity): %s is %s\n", summary->func->funcName,
+               summary->purity == Purity_Pure ? "pure" : summary->purity == Purity_ReadOnly ? "read-only" : "impure");
+    }
+}
+
+// Purity of a function, from the last buildFuncSummaries()
+FuncPurity getFuncPurity(FuncTAC* funcTac) {
+    FuncSummary* summary = getFuncSummary(funcTac);
+    return summary ? summary->purity : Purity_Impure;
+}
+
+// Check if calling a function may write a variable, directly or through its callees
+bool funcMayWrite(FuncTAC* funcTac, const char* varName) {
+    FuncSummary* summary = getFuncSummary(funcTac);
+    return !summary || summary->callsUnknown || setContains(&summary->writes, varName);
+}
+
+// Check if calling a function may read a variable, directly or through its callees
+bool funcMayRead(FuncTAC* funcTac, const char* varName) {
+    FuncSummary* summary = getFuncSummary(funcTac);
+    return !summary || summary->callsUnknown || setContains(&summary->reads, varName);
+}
+
+// Value known to be held by a variable (or array element) at some point of a TAC list
+typedef struct KnownValue {
+    char* var;
+    char* index;    //Index temp for array elements, NULL for scalars
+    char* temp;     //Temp holding the same value
+    struct KnownValue* next;
+} KnownValue;
+
+static const char* recallValue(KnownValue* known, const char* var, const char* index) {
+    for (; known; known = known->next) {
+        if (strcmp(known->var, var) == 0 && ((!index && !known->index) || (index && known->index && strcmp(known->index, index) == 0))) {
+            return known->temp;
+        }
+    }
+    return NULL;
+}
+
+static void rememberValue(KnownValue** known, const char* var, const char* index, const char* temp) {
+    KnownValue* value = malloc(sizeof(KnownValue));
+    value->var = strdup(var);
+    value->index = index ? strdup(index) : NULL;
+    value->temp = strdup(temp);
+    value->next = *known;
+    *known = value;
+}
+
+// Forget the values of every variable matching `var` (every variable if `var` is NULL),
+// or every variable the function `callee` may write
+static void forgetValues(KnownValue** known, const char* var, FuncTAC* callee) {
+    KnownValue** cursor = known;
+    while (*cursor) {
+        KnownValue* value = *cursor;
+        bool forget = callee ? funcMayWrite(callee, value->var) : (!var || strcmp(value->var, var) == 0);
+        if (forget) {
+            *cursor = value->next;
+            free(value->var);
+            free(value->index);
+            free(value->temp);
+            free(value);
+        } else {
+            cursor = &value->next;
+        }
+    }
+}
+
 // Perform copy propagation on TAC instructions.
-//      Specifically, if a load operation is encountered, any time the referenced variable is loaded,
-//  remove the load operation and instead use the first temp variable loaded into
-//      Stop once a store operation is encountered, as this will overwrite the original value of the var
+//      Tracks which temp holds the current value of each variable and array element,
+//  from stores and earlier loads. A later load of the same location is replaced by that
+//  temp (the now unused load is left for dead code elimination). Copies between temps
+//  are propagated the same way, since temps are never reassigned.
+//      A call only forgets the variables its mod/ref summary says it may write.
 void copyPropagation(TAC** head) {
+    KnownValue* known = NULL;
+
+    for (TAC* current = *head; current; current = current->next) {
+        if (strncmp(current->op, "load.", 5) == 0) {
+            const char* value = isTempVar(current->arg1) ? current->arg1 : recallValue(known, current->arg1, current->arg2);
+            if (value) {
+                printf("OPTIMIZER (copyPropagation): %s forwarded from %s\n", current->result, value);
+                replaceUses(current->next, current->result, value);
+            } else {
+                rememberValue(&known, current->arg1, current->arg2, current->result);
+            }
+        } else if (strncmp(current->op, "store.", 6) == 0) {
+            //An indexed store may hit any element, so every element of the array is forgotten
+            forgetValues(&known, current->result, NULL);
+            if (isTempVar(current->arg1)) rememberValue(&known, current->result, current->arg2, current->arg1);
+        } else if (strcmp(current->op, "functionCall") == 0) {
+            FuncTAC* callee = findCallee(current);
+            if (callee) {
+                forgetValues(&known, NULL, callee);
+            } else {
+                forgetValues(&known, NULL, NULL);
+            }
+        }
+    }
+    forgetValues(&known, NULL, NULL);
+}
+
+// Run copy propagation on main and every function, using fresh mod/ref summaries
+void copyPropagationAll() {
+    buildFuncSummaries();
+    copyPropagation(&tacHead);
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) {
+        copyPropagation(&currentFunc->func);
+    }
+}
+
+// Find the TAC defining a temp, looking backwards from `start`
+static TAC* findTempDef(TAC* start, const char* temp) {
+    for (TAC* current = start; current; current = current->prev) {
+        if (current->result && strcmp(current->result, temp) == 0) return current;
+    }
+    return NULL;
+}
+
+// Free a whole TAC list
+static void freeTACList(TAC* head) {
+    while (head) {
+        TAC* next = head->next;
+        freeTAC(&head);
+        head = next;
+    }
+}
+
+// Remove the arg.* TACs (and reserveArgs) that set up a call
+static void removeCallArgs(TAC** head, TAC** tail, TAC* call) {
+    TAC* arg = call->prev;
+    while (arg && (strncmp(arg->op, "arg.", 4) == 0 || strcmp(arg->op, "reserveArgs") == 0)) {
+        TAC* prev = arg->prev;
+        bool isReserve = (strcmp(arg->op, "reserveArgs") == 0);
+        removeTACFromList(head, tail, &arg);
+        if (isReserve) break;
+        arg = prev;
+    }
+}
+
+// Key identifying the value a TAC computes, for value numbering
+//  Constants are keyed by their value, arithmetic by op and operands (sorted for +
+//  and *), calls by label and arguments. Returns false for TACs that aren't candidates.
+static bool valueKey(TAC* current, char* key, size_t size) {
+    const char* op = current->op;
+    if (op[0] && op[1] == '.' && strchr("+-*/", op[0]) && current->arg1 && current->arg2) {
+        const char* a = current->arg1;
+        const char* b = current->arg2;
+        if ((op[0] == '+' || op[0] == '*') && strcmp(a, b) > 0) {
+            const char* swap = a;
+            a = b;
+            b = swap;
+        }
+        snprintf(key, size, "%s %s %s", op, a, b);
+        return true;
+    }
+    if (strncmp(op, "assign.", 7) == 0) {
+        snprintf(key, size, "%s %s", op, current->arg1);
+        return true;
+    }
+    if (strcmp(op, "intToFloat") == 0 || strcmp(op, "floatToInt") == 0) {
+        snprintf(key, size, "%s %s", op, current->arg1);
+        return true;
+    }
+    if (strcmp(op, "functionCall") == 0) {
+        int length = snprintf(key, size, "call %s", current->arg1);
+        for (TAC* arg = current->prev; arg && strncmp(arg->op, "arg.", 4) == 0; arg = arg->prev) {
+            if (length >= (int)size) return false;
+            length += snprintf(key + length, size - length, " %s=%s", arg->result, arg->arg1);
+        }
+        return length < (int)size;
+    }
+    return false;
+}
+
+// Computed value available for reuse: a key and the temp holding its value
+typedef struct NumberedValue {
+    char* key;
+    char* temp;
+    FuncTAC* callee;    //Read-only calls: dropped once something may change what they read
+    struct NumberedValue* next;
+} NumberedValue;
+
+static void forgetNumberedValue(NumberedValue** cursor) {
+    NumberedValue* value = *cursor;
+    *cursor = value->next;
+    free(value->key);
+    free(value->temp);
+    free(value);
+}
+
+// Perform local value numbering on a TAC list
+//      A TAC computing the same value as an earlier one (same op on the same operands)
+//  is replaced by the earlier temp. Calls count when the callee is pure, or read-only
+//  with nothing in between that may write what it reads. The duplicate arithmetic is
+//  left for dead code elimination; duplicate calls are removed here, along with pure
+//  calls whose result is never used.
+//      Temps are never reassigned, so operands can't change between the two TACs.
+void valueNumbering(TAC** head, TAC** tail) {
+    NumberedValue* values = NULL;
+    char key[512];
+
     TAC* current = *head;
+    while (current) {
+        TAC* next = current->next;
+        bool isCall = (strcmp(current->op, "functionCall") == 0);
+        FuncTAC* callee = isCall ? findCallee(current) : NULL;
+        FuncPurity purity = callee ? getFuncPurity(callee) : Purity_Impure;
+
+        if (isCall && purity == Purity_Pure && (!current->result || !isUsed(current->next, current->result))) {
+            printf("OPTIMIZER (valueNumbering): Removing unused pure call to %s\n", callee->funcName);
+            removeCallArgs(head, tail, current);
+            removeTACFromList(head, tail, &current);
+            current = next;
+            continue;
+        }
+
+        NumberedValue* match = NULL;
+        bool candidate = current->result && (!isCall || purity != Purity_Impure) && valueKey(current, key, sizeof(key));
+        if (candidate) {
+            match = values;
+            while (match && strcmp(match->key, key) != 0) match = match->next;
+        }
+
+        if (match) {
+            printf("OPTIMIZER (valueNumbering): %s is the same value as %s\n", current->result, match->temp);
+            replaceUses(current->next, current->result, match->temp);
+            if (isCall) {
+                removeCallArgs(head, tail, current);
+                removeTACFromList(head, tail, &current);
+            }
+            current = next;
+            continue;
+        }
+
+        //Stores and calls may change what read-only calls read
+        if (strncmp(current->op, "store.", 6) == 0 || isCall) {
+            NumberedValue** cursor = &values;
+            while (*cursor) {
+                FuncTAC* numberedCallee = (*cursor)->callee;
+                bool clobbered = false;
+                if (numberedCallee) {
+                    FuncSummary* summary = getFuncSummary(numberedCallee);
+                    for (int i = 0; summary && i < summary->reads.count && !clobbered; i++) {
+                        const char* read = summary->reads.names[i];
+                        clobbered = isCall ? (!callee || funcMayWrite(callee, read)) : (strcmp(current->result, read) == 0);
+                    }
+                }
+                if (clobbered) {
+                    forgetNumberedValue(cursor);
+                } else {
+                    cursor = &(*cursor)->next;
+                }
+            }
+        }
+
+        if (candidate) {
+            NumberedValue* value = malloc(sizeof(NumberedValue));
+            value->key = strdup(key);
+            value->temp = strdup(current->result);
+            value->callee = (isCall && purity == Purity_ReadOnly) ? callee : NULL;
+            value->next = values;
+            values = value;
+        }
+        current = next;
+    }
 
+    while (values) forgetNumberedValue(&values);
+}
+
+// Run value numbering on main and every function, using the current purity classes
+void valueNumberingAll() {
+    valueNumbering(&tacHead, &tacTail);
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) {
+        valueNumbering(&currentFunc->func, getFuncTACTail(currentFunc));
+    }
+}
+
+// Replace calls whose arguments are all constants with their result, computed by the TAC
+// interpreter. Calls that write output, depend on earlier calls or overrun `budget` stay.
+static void evaluateCallsInList(TAC** head, TAC** tail, int budget) {
+    TAC* current = *head;
     while (current) {
-        if ((current->op) && (strcmp(current->op, "load") == 0)) {
-            printf("OPTIMIZER (copyPropagation): The following load operation was detected:\n");
-            printTAC(current);
-            // char* originalTemp = current->op; //Should only need a shallow copy, original var is not being deleted
-            replaceCopies(current);
+        TAC* next = current->next;
+        FuncTAC* callee = (strcmp(current->op, "functionCall") == 0) ? findCallee(current) : NULL;
+        if (!callee) {
+            current = next;
+            continue;
         }
-        else
-        {
-            printf("Rejected the following operation:\n");
+
+        //Every argument has to be a constant
+        InterpArg args[32];
+        int argCount = 0;
+        bool allConstant = true;
+        TAC* arg;
+        for (arg = current->prev; arg && strncmp(arg->op, "arg.", 4) == 0; arg = arg->prev) {
+            TAC* def = findTempDef(arg->prev, arg->arg1);
+            if (argCount == 32 || !def || strncmp(def->op, "assign.", 7) != 0) {
+                allConstant = false;
+                break;
+            }
+            args[argCount].param = arg->result;
+            args[argCount].value.type = tempVarType(def->result);
+            args[argCount].value.intValue = (args[argCount].value.type == VarType_Char) ? def->arg1[0] : atoi(def->arg1);
+            args[argCount].value.floatValue = strtof(def->arg1, NULL);
+            argCount++;
+        }
+
+        InterpValue result;
+        if (allConstant && evaluateCall(callee, args, argCount, budget, &result)) {
+            printf("OPTIMIZER (evaluateConstantCalls): Evaluated call to %s\n", callee->funcName);
+            //Drop the argument passing, then the call becomes an assign
+            removeCallArgs(head, tail, current);
+            if (current->result) {
+                char value[40];
+                formatInterpValue(result, value, 40);
+                const char* type = (result.type == VarType_Float) ? "float" : (result.type == VarType_Char) ? "char" : "int";
+                rewriteAsAssign(current, type, value);
+            } else {
+                removeTACFromList(head, tail, &current);
+            }
+        }
+        current = next;
+    }
+}
+
+// Evaluate pure calls with constant arguments in main and every function
+void evaluateConstantCalls(int budget) {
+    if (budget <= 0) return;
+
+    evaluateCallsInList(&tacHead, &tacTail, budget);
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) {
+        evaluateCallsInList(&currentFunc->func, getFuncTACTail(currentFunc), budget);
+    }
+}
+
+// If the whole program runs to completion at compile time, replace main with its output
+//  The language has no input, so such a program always prints the same thing. Functions
+//  main no longer calls are dropped later by layoutFunctions.
+void evaluateConstantProgram(int budget) {
+    if (budget <= 0) return;
+
+    TAC* writesHead = NULL;
+    TAC* writesTail = NULL;
+    if (!evaluateProgram(tacHead, budget, &writesHead, &writesTail)) return;
+
+    printf("OPTIMIZER (evaluateConstantProgram): Program evaluated at compile time\n");
+    freeTACList(tacHead);
+    tacHead = writesHead;
+    tacTail = writesTail;
+}
+
+// Specializations made so far, so call sites with the same constants share a clone
+typedef struct Specialization {
+    FuncTAC* original;
+    char* signature;    //"param=value;" for every constant parameter
+    FuncTAC* clone;
+    struct Specialization* next;
+} Specialization;
+
+static Specialization* specializations = NULL;
+static int cloneCount = 0;
+
+// Copy a function body with its temps renamed and constant parameters substituted
+//  `constants` maps parameter names to their values. Loads of those parameters become assigns.
+static void cloneFuncBody(FuncTAC* original, NameMap* constants, TAC** head, TAC** tail) {
+    NameMap map = { NULL, NULL, 0, 0 };
+
+    for (TAC* current = original->func; current; current = current->next) {
+        char* result = NULL;
+        if (isTempVar(current->result)) {
+            result = createTempVar(tempVarType(current->result));
+            addMapping(&map, current->result, result);
+        }
+
+        TAC* clone;
+        const char* constValue = findMapping(constants, current->arg1);
+        if (strncmp(current->op, "load.", 5) == 0 && !current->arg2 && constValue && !isTempVar(current->arg1)) {
+            char assignOp[20];
+            snprintf(assignOp, 20, "assign.%s", current->op + 5);
+            clone = createTAC(result, (char*)constValue, assignOp, NULL);
+        } else {
+            clone = createTAC(
+                result ? result : current->result,
+                (char*)lookupRename(&map, current->arg1),
+                current->op,
+                (char*)lookupRename(&map, current->arg2)
+            );
+        }
+        free(result);
+        appendTAC(head, tail, clone);
+    }
+    freeNameMap(&map);
+}
+
+// Copy a parameter list without the parameters in `constants`
+//  Register parameters keep their registers. Stack parameters are packed again, so the
+//  outgoing argument area only holds the arguments that are still passed.
+static FuncParam* copyPassedParams(FuncParam* params, NameMap* constants) {
+    FuncParam* head = NULL;
+    FuncParam* tail = NULL;
+    int stackOffset = 0;
+    for (FuncParam* param = params; param; param = param->next) {
+        if (findMapping(constants, param->name)) continue;
+
+        FuncParam* copy = malloc(sizeof(FuncParam));
+        *copy = *param;
+        copy->name = strdup(param->name);
+        if (!copy->argRegister) {
+            copy->stackOffset = stackOffset;
+            stackOffset += 4;
+        }
+        copy->prev = tail;
+        copy->next = NULL;
+        if (tail) {
+            tail->next = copy;
+        } else {
+            head = copy;
+        }
+        tail = copy;
+    }
+    return head;
+}
+
+// Get (or make) the clone of `callee` for the constant parameters in `constants`
+//  A new clone is only kept if folding makes it smaller than the original.
+//  Returns NULL if there is no worthwhile clone or the budget is spent.
+static FuncTAC* getSpecialization(FuncTAC* callee, NameMap* constants, const char* signature, int budget) {
+    for (Specialization* spec = specializations; spec; spec = spec->next) {
+        if (spec->original == callee && strcmp(spec->signature, signature) == 0) return spec->clone;
+    }
+    if (cloneCount >= budget) return NULL;
+
+    TAC* cloneHead = NULL;
+    TAC* cloneTail = NULL;
+    cloneFuncBody(callee, constants, &cloneHead, &cloneTail);
+    constantFolding(&cloneHead);
+    deadCodeElimination(&cloneHead, &cloneTail);
+
+    FuncTAC* clone = NULL;
+    if (tacListSize(cloneHead) < funcSize(callee)) {
+        int labelLength = snprintf(NULL, 0, "%s_spec%d", callee->funcName, cloneCount);
+        char* labelName = malloc(labelLength + 1);
+        snprintf(labelName, labelLength + 1, "%s_spec%d", callee->funcName, cloneCount);
+        cloneCount++;
+
+        clone = createFuncTAC(labelName, callee->returnType);
+        clone->returnsValue = callee->returnsValue;
+        clone->params = copyPassedParams(callee->params, constants);
+        clone->func = cloneHead;
+        *getFuncTACTail(clone) = cloneTail;
+        printf("OPTIMIZER (specializeFunctions): Created %s for %s\n", labelName, signature);
+    } else {
+        freeTACList(cloneHead);
+    }
+
+    Specialization* spec = malloc(sizeof(Specialization));
+    spec->original = callee;
+    spec->signature = strdup(signature);
+    spec->clone = clone;
+    spec->next = specializations;
+    specializations = spec;
+    return clone;
+}
+
+// Move a redirected call's stack arguments to the clone's offsets and resize its
+// outgoing argument area to match (removing it when nothing is left on the stack)
+static void passCloneStackArgs(TAC** head, TAC** tail, TAC* call, FuncTAC* clone) {
+    int stackArgBytes = 0;
+    TAC* reserve = NULL;
+    for (TAC* arg = call->prev; arg && (strncmp(arg->op, "arg.", 4) == 0 || strcmp(arg->op, "reserveArgs") == 0); arg = arg->prev) {
+        if (strcmp(arg->op, "reserveArgs") == 0) {
+            reserve = arg;
+            break;
+        }
+        if (arg->arg2[0] == '$') continue;
+        for (FuncParam* param = clone->params; param; param = param->next) {
+            if (strcmp(param->name, arg->result) != 0) continue;
+            char location[20];
+            snprintf(location, 20, "%d", param->stackOffset);
+            free(arg->arg2);
+            arg->arg2 = strdup(location);
+            stackArgBytes += 4;
+            break;
+        }
+    }
+    if (!reserve) return;
+
+    free(call->arg2);
+    call->arg2 = NULL;
+    if (stackArgBytes == 0) {
+        removeTACFromList(head, tail, &reserve);
+        return;
+    }
+    char stackArgString[20];
+    snprintf(stackArgString, 20, "%d", stackArgBytes);
+    free(reserve->arg1);
+    reserve->arg1 = strdup(stackArgString);
+    call->arg2 = strdup(stackArgString);
+}
+
+// Redirect calls with constant arguments in one TAC list to specialized clones
+static void specializeCallsInList(TAC** head, TAC** tail, FuncTAC* owner, int budget) {
+    for (TAC* current = *head; current; current = current->next) {
+        if (strcmp(current->op, "functionCall") != 0) continue;
+        FuncTAC* callee = findCallee(current);
+        if (!callee || callee == owner || isRecursive(callee)) continue;
+
+        //Collect the constant arguments to parameters the callee never writes
+        NameMap constants = { NULL, NULL, 0, 0 };
+        char signature[512] = "";
+        for (TAC* arg = current->prev; arg && strncmp(arg->op, "arg.", 4) == 0; arg = arg->prev) {
+            TAC* def = findTempDef(arg->prev, arg->arg1);
+            if (!def || strncmp(def->op, "assign.", 7) != 0 || funcWritesVar(callee, arg->result)) continue;
+            addMapping(&constants, arg->result, def->arg1);
+            snprintf(signature + strlen(signature), sizeof(signature) - strlen(signature), "%s=%s;", arg->result, def->arg1);
+        }
+
+        FuncTAC* clone = constants.count ? getSpecialization(callee, &constants, signature, budget) : NULL;
+        if (clone) {
+            //Constant arguments are baked into the clone, so stop passing them
+            //  The map's keys are the args' own names, so find them all before removing any
+            TAC** constantArgs = malloc(constants.count * sizeof(TAC*));
+            int constantArgCount = 0;
+            for (TAC* arg = current->prev; arg && strncmp(arg->op, "arg.", 4) == 0; arg = arg->prev) {
+                if (findMapping(&constants, arg->result)) constantArgs[constantArgCount++] = arg;
+            }
+            for (int i = 0; i < constantArgCount; i++) {
+                removeTACFromList(head, tail, &constantArgs[i]);
+            }
+            free(constantArgs);
+            free(current->arg1);
+            current->arg1 = strdup(clone->funcName);
+            passCloneStackArgs(head, tail, current, clone);
+        }
+        freeNameMap(&constants);
+    }
+}
+
+// Clone functions for call sites that pass constant arguments
+//  Each clone has its constant parameters folded in. Call sites with the same constants
+//  share a clone, and at most `budget` clones are made in total; 0 turns this pass off.
+void specializeFunctions(int budget) {
+    if (budget <= 0) return;
+
+    specializeCallsInList(&tacHead, &tacTail, NULL, budget);
+    //Clones are appended to the function list, so they get specialized too
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) {
+        specializeCallsInList(&currentFunc->func, getFuncTACTail(currentFunc), currentFunc, budget);
+    }
+}
+
+// Append the text a write of a constant int or char prints (value and newline) to an
+// .asciiz literal. Returns false for values that can't go in a literal.
+static bool appendWriteText(TAC* write, TAC* def, char* literal, size_t size) {
+    size_t length = strlen(literal);
+    bool fits;
+    if (strcmp(write->op, "write.int") == 0) {
+        char text[20];
+        snprintf(text, 20, "%d", atoi(def->arg1));
+        fits = (length + strlen(text) < size);
+        if (fits) strcat(literal, text);
+    } else {
+        fits = appendAsciizChar(literal, size, def->arg1[0]);
+    }
+    if (fits) fits = appendAsciizChar(literal, size, '\n');
+    if (!fits) literal[length] = '\0';
+    return fits;
+}
+
+// Does the write print a compile-time string or a value that could be one?
+static bool isCoalescableWrite(TAC* write) {
+    return strcmp(write->op, "write.int") == 0 || strcmp(write->op, "write.char") == 0 || strcmp(write->op, "write.string") == 0;
+}
+
+// Merge runs of writes of constant ints and chars into one "write.string"
+//      Each int/char write costs a value syscall plus a newline syscall; a run of them
+//  prints the same text with a single print-string syscall. Strings already merged
+//  (e.g. by evaluateConstantProgram) join the run too. The run may have other TACs in
+//  between, as long as none of them prints anything (writes or calls).
+//      Float writes end a run, since simulators format floats differently than printf.
+void coalesceWrites(TAC** head, TAC** tail) {
+    char literal[1024];
+
+    TAC* current = *head;
+    while (current) {
+        TAC* runStart = NULL;
+        int runLength = 0;
+        literal[0] = '\0';
+
+        //Extend the run from `current` while writes are constant
+        TAC* cursor = current;
+        for (; cursor; cursor = cursor->next) {
+            if (strcmp(cursor->op, "write.string") == 0) {
+                if (strlen(literal) + strlen(cursor->arg1) >= sizeof(literal)) break;
+                strcat(literal, cursor->arg1);
+                if (!runStart) runStart = cursor;
+                runLength++;
+            } else if (isCoalescableWrite(cursor)) {
+                TAC* def = findTempDef(cursor->prev, cursor->arg1);
+                if (!def || strncmp(def->op, "assign.", 7) != 0 || !appendWriteText(cursor, def, literal, sizeof(literal))) break;
+                if (!runStart) runStart = cursor;
+                runLength++;
+            } else if (strncmp(cursor->op, "write.", 6) == 0 || strcmp(cursor->op, "functionCall") == 0 || strcmp(cursor->op, "tailCall") == 0
+                       || strcmp(cursor->op, "return") == 0) {
+                break;
+            }
+        }
+
+        if (!runStart) {
+            current = cursor ? cursor->next : NULL;
+            continue;
+        }
+        if (runLength == 1 && strcmp(runStart->op, "write.string") == 0) {
+            current = cursor;
+            continue;
+        }
+
+        //Replace the first write of the run with the string and drop the rest
+        printf("OPTIMIZER (coalesceWrites): Merged %d writes into \"%s\"\n", runLength, literal);
+        TAC* stringWrite = createTAC(NULL, literal, "write.string", NULL);
+        insertTACBefore(head, runStart, stringWrite);
+        TAC* write = runStart;
+        while (write != cursor) {
+            TAC* next = write->next;
+            if (isCoalescableWrite(write)) {
+                removeTACFromList(head, tail, &write);
+            }
+            write = next;
+        }
+        current = cursor;
+    }
+}
+
+// Coalesce constant writes in main and every function
+void coalesceWritesAll() {
+    coalesceWrites(&tacHead, &tacTail);
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) {
+        coalesceWrites(&currentFunc->func, getFuncTACTail(currentFunc));
+    }
+}
+
+// Try to make a store in main the static initial value of its variable or element
+//  `touched` holds the variables ("x_var") and elements ("arr_var[3]") read or stored
+//  so far; a whole array is touched once any element is read or stored by a variable index.
+//  Returns false if the store has to stay, and sets `stop` if nothing after it can be hoisted.
+static bool hoistStore(TAC* store, NameSet* touched, bool* stop) {
+    Symbol* symbol = lookupSymbol(symTabRef, store->result);
+    if (!symbol) {
+        *stop = true;
+        return false;
+    }
+
+    int index = 0;
+    char key[256];
+    snprintf(key, sizeof(key), "%s", store->result);
+    if (strstr(store->op, "Index")) {
+        TAC* indexDef = findTempDef(store->prev, store->arg2);
+        if (!indexDef || strcmp(indexDef->op, "assign.int") != 0) {
+            setAdd(touched, store->result);
+            return false;
+        }
+        index = atoi(indexDef->arg1);
+        if (index < 0 || index >= symbol->arrSize) {
+            *stop = true;   //Writes past the array, into whatever the assembler put next to it
+            return false;
+        }
+        if (setContains(touched, store->result)) return false;
+        snprintf(key, sizeof(key), "%s[%d]", store->result, index);
+    }
+
+    bool firstStore = setAdd(touched, key);
+    TAC* valueDef = findTempDef(store->prev, store->arg1);
+    if (!firstStore || !valueDef || strncmp(valueDef->op, "assign.", 7) != 0) return false;
+
+    //Char arrays are laid out as a string literal, so their chars must fit in one
+    char escaped[4] = "";
+    if (symbol->type == VarType_Char && symbol->isArray && !appendAsciizChar(escaped, sizeof(escaped), valueDef->arg1[0])) return false;
+
+    setInitValue(symbol, index, valueDef->arg1);
+    return true;
+}
+
+// Turn main's first stores of constants into .data initializers
+//      Variables start out with their default value in .data, so a constant stored to a
+//  variable (or array element) before anything reads or stores it can be its initial
+//  value instead. Main is straight-line code, so this holds for every store up to the
+//  first call, after which the callee's effects would have to be considered.
+void hoistStaticInitializers() {
+    NameSet touched = { NULL, 0, 0 };
+    bool stop = false;
+
+    TAC* current = tacHead;
+    while (current && !stop) {
+        TAC* next = current->next;
+        if (strcmp(current->op, "functionCall") == 0 || strcmp(current->op, "tailCall") == 0) {
+            break;
+        } else if (strncmp(current->op, "load.", 5) == 0 && !isTempVar(current->arg1)) {
+            setAdd(&touched, current->arg1);    //Also covers every element of an indexed array
+        } else if (strcmp(current->op, "write.charArray") == 0) {
+            setAdd(&touched, current->arg1);
+        } else if (strncmp(current->op, "store.", 6) == 0 && hoistStore(current, &touched, &stop)) {
+            printf("OPTIMIZER (hoistStaticInitializers): Initializing %s in .data:\n", current->result);
             printTAC(current);
+            removeTACFromList(&tacHead, &tacTail, &current);
         }
-        current = current->next;
+        current = next;
     }
+    freeNameSet(&touched);
 }
 
+// Index of a function in the funcTacHeads list, -1 if it isn't there
+static int funcIndex(FuncTAC* funcTac) {
+    int index = 0;
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc, index++) {
+        if (currentFunc == funcTac) return index;
+    }
+    return -1;
+}
 
-//Replace all tempVar copies that occur after `start` TAC
-//  Assumes `start` is a load instruction
-void replaceCopies(TAC* start)
-{
-    TAC* current = start->next;
-    while(current)
-    {
-        if ((current->result) && (strcmp(current->result, start->arg1) == 0)) { //If a store operation which overwrites our variable is read...
-            return; //Stop; our variable has been overwritten
+// Count the calls from one TAC list to each function
+static void countCalls(TAC* head, double* callCounts) {
+    for (TAC* current = head; current; current = current->next) {
+        if (strcmp(current->op, "functionCall") != 0) continue;
+        int calleeIndex = funcIndex(findCallee(current));
+        if (calleeIndex >= 0) callCounts[calleeIndex]++;
+    }
+}
+
+// Place `caller`'s callees after it, hottest call edge first, then their callees (depth first)
+static void placeCallees(int caller, int funcCount, double* edgeWeights, bool* placed, FuncTAC** funcs) {
+    while (true) {
+        int hottest = -1;
+        for (int callee = 0; callee < funcCount; callee++) {
+            if (placed[callee] || edgeWeights[caller * funcCount + callee] <= 0) continue;
+            if (hottest < 0 || edgeWeights[caller * funcCount + callee] > edgeWeights[caller * funcCount + hottest]) hottest = callee;
         }
+        if (hottest < 0) return;
 
-        //A load operation for the same variable occurs before a store operation -- a copy is created
-        if ((strcmp(current->op, "load") == 0) && (strcmp(start->arg1, current->arg1) == 0))
-        {
-            char* redundantVar = current->result; //ID of temp var to be replaced
-            TAC* redundancyCursor = current->next;
-            while(redundancyCursor)
-            {
-                if ((redundancyCursor->result) && (strcmp(redundancyCursor->result, start->arg1) == 0)) { //If a store operation which overwrites our variable is read...
-                    break; //Stop; our variable has been overwritten
-                }
-                if (strcmp(redundancyCursor->arg1, redundantVar) == 0) {
-                    free(redundancyCursor->arg1);
-                    redundancyCursor->arg1 = strdup(start->result);
-                }
-                if ((redundancyCursor->arg2) && (strcmp(redundancyCursor->arg2, redundantVar) == 0)) {
-                    free(redundancyCursor->arg2);
-                    redundancyCursor->arg2 = strdup(start->result);
-                }
+        placed[hottest] = true;
+        moveFuncTACToEnd(funcs[hottest]);
+        placeCallees(hottest, funcCount, edgeWeights, placed, funcs);
+    }
+}
+
+// Remove functions main can never reach, and optionally order the rest by call affinity
+//      Programs have no branches or loops, so static call counts are exact execution
+//  counts: a function runs once per call from each run of its callers. Those counts
+//  weight the call graph edges (calls x caller runs), and serve as the profile.
+//      With `affinity` set, functions are laid out depth first from main, following the
+//  heaviest edge first, so each callee sits right after the caller that uses it most.
+//  Otherwise the surviving functions keep their source order.
+void layoutFunctions(bool affinity) {
+    int funcCount = 0;
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) funcCount++;
+    if (funcCount == 0) return;
 
-                redundancyCursor = redundancyCursor->next;
+    //Row funcCount of the call matrix is main
+    FuncTAC** funcs = malloc(funcCount * sizeof(FuncTAC*));
+    double* callCounts = calloc((funcCount + 1) * funcCount, sizeof(double));
+    int index = 0;
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc, index++) {
+        funcs[index] = currentFunc;
+        countCalls(currentFunc->func, &callCounts[index * funcCount]);
+    }
+    countCalls(tacHead, &callCounts[funcCount * funcCount]);
+
+    //Runs of each function. Chains of calls are at most funcCount deep (recursion never
+    //terminates here anyway), so funcCount rounds of propagation are enough.
+    double* runs = calloc(funcCount + 1, sizeof(double));
+    runs[funcCount] = 1;
+    for (int round = 0; round < funcCount; round++) {
+        for (int callee = 0; callee < funcCount; callee++) {
+            double calleeRuns = 0;
+            for (int caller = 0; caller <= funcCount; caller++) {
+                calleeRuns += runs[caller] * callCounts[caller * funcCount + callee];
             }
-            //NOTE: TAC deletion is too buggy for the time being. We need a better
-            //  algorithm for liveness analysis.
-            // printf("OPTIMIZER(replaceCopies): Deleting the following TAC:\n");
-            // printTAC(current);
-            // removeTAC(&current);
-            return;
+            runs[callee] = calleeRuns;
         }
-        current = current->next;
     }
-    //EOF; no more copies to be found
-    return;
+
+    //Drop what main never reaches
+    bool* placed = calloc(funcCount + 1, sizeof(bool));
+    for (int i = 0; i < funcCount; i++) {
+        if (runs[i] > 0) continue;
+        printf("OPTIMIZER (layoutFunctions): Removing unreachable function %s\n", funcs[i]->funcName);
+        removeFuncTAC(funcs[i]);
+        funcs[i] = NULL;
+        placed[i] = true;
+    }
+
+    if (affinity) {
+        double* edgeWeights = malloc((funcCount + 1) * funcCount * sizeof(double));
+        for (int caller = 0; caller <= funcCount; caller++) {
+            for (int callee = 0; callee < funcCount; callee++) {
+                edgeWeights[caller * funcCount + callee] = runs[caller] * callCounts[caller * funcCount + callee];
+            }
+        }
+        placeCallees(funcCount, funcCount, edgeWeights, placed, funcs);
+        free(edgeWeights);
+    }
+
+    free(placed);
+    free(runs);
+    free(callCounts);
+    free(funcs);
 }
 
+// Turn calls whose result is returned right away into tail calls
+//      Matches "functionCall" followed by "setReturn" of its result and "return" (or just
+//  "return" in a void function), and rewrites the call to "tailCall", dropping the
+//  setReturn. The callee then returns straight to our caller.
+//      Calls with stack arguments are left alone, since the callee reads those from the
+//  caller's outgoing area, which would have to outlive our frame.
+void lowerTailCalls() {
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) {
+        TAC** tail = getFuncTACTail(currentFunc);
+        for (TAC* current = currentFunc->func; current; current = current->next) {
+            if (strcmp(current->op, "functionCall") != 0 || current->arg2) continue;
+            FuncTAC* callee = findCallee(current);
+            TAC* next = current->next;
+            if (!callee || !next) continue;
 
+            if (current->result && strncmp(next->op, "setReturn.", 10) == 0 && strcmp(next->arg1, current->result) == 0
+                && next->next && strcmp(next->next->op, "return") == 0 && callee->returnType == currentFunc->returnType) {
+                removeTACFromList(&currentFunc->func, tail, &next);
+            } else if (!(strcmp(next->op, "return") == 0 && currentFunc->returnType == VarType_Void)) {
+                continue;
+            }
 
-// Perform dead code elimination on TAC instructions.
-// void deadCodeElimination(TAC** head) {
-//     TAC* current = *head;
-//     TAC* prev = NULL;
-
-//     while (current != NULL) {
-//         if (current->op != NULL && strcmp(current->op, "assign") == 0) {
-//             // Check if the result is ever used
-//             int isUsed = 0;
-//             TAC* temp = current->next;
-//             while (temp != NULL) {
-//                 if ((temp->arg1 != NULL && strcmp(temp->arg1, current->result) == 0) ||
-//                     (temp->arg2 != NULL && strcmp(temp->arg2, current->result) == 0)) {
-//                     isUsed = 1;
-//                     break;
-//                 }
-//                 temp = temp->next;
-//             }
-
-//             if (!isUsed) {
-//                 // Remove the dead code (the assignment is not used)
-//                 if (prev == NULL) {
-//                     *head = current->next; // Move head forward
-//                 } else {
-//                     prev->next = current->next; // Skip the current TAC instruction
-//                 }
-//                 free(current->op);
-//                 free(current->arg1);
-//                 free(current->arg2);
-//                 free(current->result);
-//                 free(current);
-//                 current = prev ? prev->next : *head;
-//                 continue;
-//             }
-//         }
-//         prev = current;
-//         current = current->next;
-//     }
-// }
+            printf("OPTIMIZER (lowerTailCalls): Call to %s in %s is a tail call\n", current->arg1, currentFunc->funcName);
+            free(current->op);
+            current->op = strdup("tailCall");
+            free(current->result);
+            current->result = NULL;
+        }
+    }
+}
 
 // Print optimized TAC to terminal and file
 void printOptimizedTAC(const char* filename, TAC* head) {
     
-    FILE* outputFile = fopen(filename, "w");
-    if (outputFile == NULL) {
+    OutputWriter outputFile;
+    if (!openOutputWriter(&outputFile, filename)) {
         perror("Failed to open output file");
         exit(EXIT_FAILURE);
     }
@@ -258,11 +1575,11 @@ void printOptimizedTAC(const char* filename, TAC* head) {
     while (current != NULL) {
         // printf("%s = %s %s %s\n", current->result ? current->result : "(null)", current->arg1 ? current->arg1 : "(null)", current->op ? current->op : "(null)", current->arg2 ? current->arg2 : "(null)"); 
         printf("%s = %s %s %s\n", current->result, current->arg1, current->op, current->arg2);
-        fprintf(outputFile, "%s = %s %s %s\n", current->result, current->arg1, current->op, current->arg2);
+        writerPrintf(&outputFile, "%s = %s %s %s\n", current->result, current->arg1, current->op, current->arg2);
         current = current->next;
     }
 
     printf("Optimized TAC written to %s\n", filename);
-    fclose(outputFile);
+    closeOutputWriter(&outputFile);
 }
 
@@ -5,6 +5,14 @@
 #include <stdbool.h>
 #include <ctype.h>
 
+// How much a function call depends on and affects the rest of the program
+//  Ordered from best to worst, so the purity of a caller is the max over its callees
+typedef enum FuncPurity {
+    Purity_Pure,        //Result depends only on the arguments, no side effects
+    Purity_ReadOnly,    //No side effects, but may read state left by earlier calls
+    Purity_Impure       //Writes output or state other calls can see
+} FuncPurity;
+
 /**
  * Perform a series of optimizations on the given TAC list.
  * This function applies constant folding, constant propagation,
@@ -66,7 +74,55 @@ bool constantCheck(TAC* start, TAC** arg1Assignment, TAC** arg2Assignment);
  */
 void copyPropagation(TAC** head);
 
-void replaceCopies(TAC* start);
+/**
+ * Run copy propagation on main and every function TAC, after rebuilding the
+ * mod/ref summaries.
+ */
+void copyPropagationAll();
+
+/**
+ * Build the call graph and, for each function, the set of variables it may
+ * read and write, including through the functions it calls.
+ */
+void buildFuncSummaries();
+
+/**
+ * Classify every function as pure, read-only or impure. Called by
+ * buildFuncSummaries().
+ */
+void classifyPurity();
+
+/**
+ * Purity of a function, from the last buildFuncSummaries().
+ */
+FuncPurity getFuncPurity(FuncTAC* funcTac);
+
+/**
+ * Perform local value numbering on a TAC list: reuse the temp of an earlier
+ * identical computation, including identical calls to pure (and unclobbered
+ * read-only) functions.
+ *
+ * @param head Pointer to the head of the TAC list.
+ * @param tail Pointer to the tail of the TAC list.
+ */
+void valueNumbering(TAC** head, TAC** tail);
+
+/**
+ * Run value numbering on main and every function TAC.
+ */
+void valueNumberingAll();
+
+/**
+ * Check if calling a function may write a variable. Uses the summaries from
+ * the last buildFuncSummaries().
+ */
+bool funcMayWrite(FuncTAC* funcTac, const char* varName);
+
+/**
+ * Check if calling a function may read a variable. Uses the summaries from
+ * the last buildFuncSummaries().
+ */
+bool funcMayRead(FuncTAC* funcTac, const char* varName);
 
 /**
  * Perform dead code elimination on the TAC list. This optimization removes
@@ -74,8 +130,133 @@ void replaceCopies(TAC* start);
  * the program's output.
  *
  * @param head Pointer to the head of the TAC list.
+ * @param tail Pointer to the tail of the TAC list.
+ */
+void deadCodeElimination(TAC** head, TAC** tail);
+
+/**
+ * Run constant folding on main and every function TAC.
+ */
+void constantFoldingAll();
+
+/**
+ * Run dead code elimination on main and every function TAC.
+ */
+void deadCodeEliminationAll();
+
+/**
+ * Clone functions for call sites that pass constant arguments, fold the
+ * constants into the clone, and point the call at the clone's label.
+ *
+ * @param budget Most clones to create. 0 disables specialization.
+ */
+void specializeFunctions(int budget);
+
+/**
+ * Inline calls to small, non-recursive functions. The callee body is spliced
+ * into the caller with its temps renamed and its parameters bound directly to
+ * the argument temps.
+ *
+ * @param threshold Largest callee size, in TAC instructions, that gets inlined.
+ *                  0 disables inlining.
+ */
+void inlineFunctions(int threshold);
+
+/**
+ * Replace a single functionCall TAC with a copy of the callee body.
+ *
+ * @param head Pointer to the head of the TAC list holding the call.
+ * @param tail Pointer to the tail of the TAC list holding the call.
+ * @param call The functionCall TAC.
+ * @param callee The function being called.
+ * @return The TAC where scanning for further calls should resume.
+ */
+TAC* inlineCall(TAC** head, TAC** tail, TAC* call, FuncTAC* callee);
+
+/**
+ * Find the function a functionCall TAC jumps to.
+ *
+ * @param call The functionCall TAC.
+ * @return The callee, or NULL if it can't be found.
+ */
+FuncTAC* findCallee(TAC* call);
+
+/**
+ * Size of a function for the inlining cost model: the number of TACs up to
+ * its first return, not counting funcStart and return.
+ */
+int funcSize(FuncTAC* funcTac);
+
+/**
+ * Check if `from` can reach `target` through at most `depth` nested calls.
+ */
+bool callsFunction(FuncTAC* from, FuncTAC* target, int depth);
+
+/**
+ * Check if a function can call itself, directly or indirectly.
+ */
+bool isRecursive(FuncTAC* funcTac);
+
+/**
+ * Check if a name is a compiler temp (i0, f12, c3, ...).
+ */
+bool isTempVar(const char* name);
+
+/**
+ * Type of a compiler temp, taken from its prefix.
+ */
+VarType tempVarType(const char* name);
+
+/**
+ * Remove functions that main can never reach. With `affinity` set, also
+ * reorder the remaining functions so each callee follows the caller that
+ * calls it most, weighted by exact static call counts.
+ */
+void layoutFunctions(bool affinity);
+
+/**
+ * Rewrite calls in return position to "tailCall", which the code generator
+ * lowers to a jump that reuses the caller's return address.
+ */
+void lowerTailCalls();
+
+/**
+ * Replace calls whose arguments are all constants with the value the call
+ * returns, computed by the TAC interpreter. Only calls that produce no output
+ * and don't depend on earlier calls are replaced.
+ *
+ * @param budget Most TACs the interpreter may run per call. 0 disables.
+ */
+void evaluateConstantCalls(int budget);
+
+/**
+ * If the whole program can be run at compile time, replace main with the
+ * writes it performs.
+ *
+ * @param budget Most TACs the interpreter may run. 0 disables.
+ */
+void evaluateConstantProgram(int budget);
+
+/**
+ * Merge runs of writes of constant ints and chars (with their newlines) into a
+ * single "write.string" TAC printed with one syscall.
+ *
+ * @param head Pointer to the head of the TAC list.
+ * @param tail Pointer to the tail of the TAC list.
+ */
+void coalesceWrites(TAC** head, TAC** tail);
+
+/**
+ * Coalesce constant writes in main and every function TAC.
+ */
+void coalesceWritesAll();
+
+/**
+ * Turn main's first constant stores to variables and array elements, made before
+ * anything reads them, into static initial values in the symbol table, which
+ * declareMipsVars() emits in .data.
  */
-void deadCodeElimination(TAC** head);
+void hoistStaticInitializers();
 
 /**
  * Print the optimized TAC list to a file and also print to the terminal.
@@ -7,8 +7,14 @@
 #include "symbolTable.h"
 #include "semantic.h"
 #include "codeGenerator.h"
+#include "x86CodeGenerator.h"
+#include "cCodeGenerator.h"
+#include "vm.h"
+#include "jit.h"
 #include "optimizer.h"
 #include "commons/types.h"
+#include "commons/options.h"
+#include "commons/outputWriter.h"
 
 #define TABLE_SIZE 100
 #define MAX_ID_LENGTH 10
@@ -453,9 +459,21 @@ void yyerror(const char *s) {
 }
 
 int main(int argc, char **argv) {
-    ++argv, --argc;  /* Skip over program name */
-    if (argc > 0)
-        yyin = fopen(argv[0], "r");
+	parseOptions(argc, argv);
+	// Keep the assembly stream (or the program's output) clean of the progress messages
+	if (strcmp(options.outputFile, "-") == 0 || options.runProgram)
+		claimStandardOutput();
+	// Saved bytecode runs without being compiled again
+	if (options.runProgram && options.inputFile && isVMProgramFile(options.inputFile)) {
+		VMProgram program;
+		if (!loadVMProgram(options.inputFile, &program))
+			return EXIT_FAILURE;
+		bool finished = options.useJIT ? runJITProgram(&program) : runVMProgram(&program);
+		freeVMProgram(&program);
+		return finished ? 0 : EXIT_FAILURE;
+	}
+    if (options.inputFile)
+        yyin = fopen(options.inputFile, "r");
     else
         yyin = stdin;
 	
@@ -473,7 +491,8 @@ int main(int argc, char **argv) {
 	{
         // Successfully parsed
 		printf("Parsing successful!\n");
-        traverseAST(root, 0, drawVertical, false);
+        if (options.dumpAST)
+            traverseAST(root, 0, drawVertical, false);
 		// Print symbol table for debugging
 		printSymbolTable(symTab);
 		// Semantic analysis
@@ -481,24 +500,49 @@ int main(int argc, char **argv) {
 		initSemantic(symTab);
 		semanticAnalysis(root);
 		printf("\n=== TAC GENERATION ===\n");
-		printTACToFile("output/TAC.ir", tacHead);
-		printFuncTACsToFile();
+		char irPath[1024];
+		if (options.dumpIR) {
+			outputSiblingPath(irPath, sizeof(irPath), "TAC.ir");
+			printTACToFile(irPath, tacHead);
+			printFuncTACsToFile();
+		}
 
 		// Code optimization
 		printf("\n=== CODE OPTIMIZATION ===\n");
 		// Traverse the linked list of TAC entries and optimize
 		// But - you MIGHT need to traverse the AST again to optimize
 
-		/* optimizeTAC(tacHead); */
-		/* printOptimizedTAC("output/TACOptimized.ir", tacHead); */
+		optimizeTAC(tacHead);
+		if (options.dumpIR) {
+			outputSiblingPath(irPath, sizeof(irPath), "TACOptimized.ir");
+			printOptimizedTAC(irPath, tacHead);
+		}
 
 		// Code generation
 		printf("\n=== CODE GENERATION ===\n");
-		/* initCodeGenerator("output/output.asm", symTab); */
-		initCodeGenerator("output/output.asm");
-		/* generateMIPS(tacHead); */
-		generateMIPS(tacHead, symTab);
-		finalizeCodeGenerator("output/output.asm");
+		if (options.runProgram || options.target == Target_Bytecode) {
+			VMProgram program;
+			if (!compileVMProgram(tacHead, symTab, &program))
+				return EXIT_FAILURE;
+			bool finished = true;
+			if (options.runProgram)
+				finished = options.useJIT ? runJITProgram(&program) : runVMProgram(&program);
+			else if (saveVMProgram(&program, options.outputFile))
+				printf("Bytecode generated and saved to file %s\n", options.outputFile);
+			freeVMProgram(&program);
+			if (!finished)
+				return EXIT_FAILURE;
+		} else if (options.target == Target_X86_64) {
+			generateX86(tacHead, symTab, options.outputFile);
+		} else if (options.target == Target_C) {
+			generateC(tacHead, symTab, options.outputFile);
+		} else {
+			/* initCodeGenerator("output/output.asm", symTab); */
+			initCodeGenerator(options.outputFile);
+			/* generateMIPS(tacHead); */
+			generateMIPS(tacHead, symTab);
+			finalizeCodeGenerator(options.outputFile);
+		}
 
         freeAST(root);
 		freeSymbolTable(symTab);
@@ -0,0 +1,278 @@
+// peephole.c
+#include "peephole.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A rewrite of the instructions around instrs[index]
+//  `apply` returns true if it changed anything; `hits` counts how often it did in the whole compile.
+typedef struct PeepholeRule {
+    const char* name;
+    bool (*apply)(MIPSProgram* program, int index);
+    int hits;
+} PeepholeRule;
+
+// Registers whose value is dead at the end of a block, set by runPeephole()
+static bool isTemp[MIPS_REGISTER_COUNT];
+
+static bool readsRegister(const MIPSInstr* instr, int reg) {
+    int defs[MIPS_MAX_REGISTER_REFS], uses[MIPS_MAX_REGISTER_REFS], defCount, useCount;
+    mipsInstrRegisters(instr, defs, &defCount, uses, &useCount);
+    for (int i = 0; i < useCount; i++) {
+        if (uses[i] == reg) return true;
+    }
+    return false;
+}
+
+static bool writesRegister(const MIPSInstr* instr, int reg) {
+    int defs[MIPS_MAX_REGISTER_REFS], uses[MIPS_MAX_REGISTER_REFS], defCount, useCount;
+    mipsInstrRegisters(instr, defs, &defCount, uses, &useCount);
+    for (int i = 0; i < defCount; i++) {
+        if (defs[i] == reg) return true;
+    }
+    return false;
+}
+
+// Can register values be reasoned about across this instruction?
+//  A syscall only touches the registers it lists; anything unknown may do anything.
+static bool isOpaque(const MIPSInstr* instr) {
+    return mipsInstrKind(instr) == MIPSKind_Barrier && instr->op != MIPSOp_Syscall;
+}
+
+// First instruction of the basic block holding instrs[index]
+static int blockStart(const MIPSProgram* program, int index) {
+    int k = index;
+    while (k > 0 && program->instrs[k - 1].op && mipsInstrKind(&program->instrs[k - 1]) != MIPSKind_Branch) k--;
+    return k;
+}
+
+// One past the last instruction (the branch, if any) of the basic block holding instrs[index]
+static int blockEnd(const MIPSProgram* program, int index) {
+    int k = index;
+    while (k < program->count && program->instrs[k].op) {
+        k++;
+        if (mipsInstrKind(&program->instrs[k - 1]) == MIPSKind_Branch) break;
+    }
+    return k;
+}
+
+static void removeInstr(MIPSProgram* program, int index) {
+    freeMIPSInstr(&program->instrs[index]);
+    memmove(&program->instrs[index], &program->instrs[index + 1], (program->count - index - 1) * sizeof(MIPSInstr));
+    program->count--;
+}
+
+// Turn instrs[index] into a register copy, keeping its comment
+static void replaceWithMove(MIPSProgram* program, int index, MIPSOpcode op, int dest, int src) {
+    MIPSInstr* instr = &program->instrs[index];
+    MIPSInstr move = makeMIPSInstr(op);
+    move.operands[0] = mipsRegister(dest);
+    move.operands[1] = mipsRegister(src);
+    move.operandCount = 2;
+    move.comment = instr->comment;
+    instr->comment = NULL;
+    freeMIPSInstr(instr);
+    *instr = move;
+}
+
+// Rename the registers an instruction reads; returns whether any operand changed
+static bool renameReads(MIPSInstr* instr, const int* newRegs) {
+    bool changed = false;
+    int defOperand = mipsDefOperand(instr);
+    for (int i = 0; i < instr->operandCount; i++) {
+        if (i == defOperand) continue;
+        int before = instr->operands[i].reg;
+        renameMIPSRegisters(instr, i, newRegs);
+        changed |= instr->operands[i].reg != before;
+    }
+    return changed;
+}
+
+// Is the value `reg` holds after instrs[index] never read?
+//  Whatever follows the block may read anything but a temp.
+static bool isDeadAfter(const MIPSProgram* program, int index, int reg) {
+    int end = blockEnd(program, index);
+    for (int k = index + 1; k < end; k++) {
+        const MIPSInstr* instr = &program->instrs[k];
+        if (readsRegister(instr, reg) || isOpaque(instr)) return false;
+        if (mipsInstrKind(instr) == MIPSKind_Branch) return isTemp[reg];
+        if (writesRegister(instr, reg)) return true;
+    }
+    return isTemp[reg];
+}
+
+// Does `reg` hold a sign-extended byte when instrs[index] runs, so storing it with sb
+// and loading it back with lb gives the same value?
+static bool holdsByte(const MIPSProgram* program, int index, int reg) {
+    if (reg == 0) return true;
+    for (int k = index - 1; k >= blockStart(program, index); k--) {
+        const MIPSInstr* instr = &program->instrs[k];
+        if (!writesRegister(instr, reg)) continue;
+        if (instr->op == MIPSOp_Lb) return true;
+        if (instr->op == MIPSOp_Li) {
+            int value = instr->operands[1].value;
+            return value >= -128 && value <= 127;
+        }
+        return false;
+    }
+    return false;
+}
+
+// lw/lb/l.s of a label stored to just before: copy the stored register instead
+static bool forwardStoredValue(MIPSProgram* program, int index) {
+    static const MIPSOpcode pairs[][3] = {{MIPSOp_Lw, MIPSOp_Sw, MIPSOp_Move}, {MIPSOp_Lb, MIPSOp_Sb, MIPSOp_Move}, {MIPSOp_LS, MIPSOp_SS, MIPSOp_MovS}};
+    MIPSInstr* load = &program->instrs[index];
+    const char* symbol = (mipsInstrKind(load) == MIPSKind_Load && load->operandCount == 2) ? mipsMemorySymbol(load) : NULL;
+    if (!symbol) return false;
+    int pair = -1;
+    for (int i = 0; i < 3; i++) {
+        if (load->op == pairs[i][0]) pair = i;
+    }
+    if (pair < 0) return false;
+
+    int start = blockStart(program, index);
+    for (int k = index - 1; k >= start && k >= index - PEEPHOLE_WINDOW; k--) {
+        MIPSInstr* store = &program->instrs[k];
+        if (isOpaque(store) || store->op == MIPSOp_Syscall) return false;
+        if (mipsInstrKind(store) != MIPSKind_Store) continue;
+
+        if (store->op == pairs[pair][1] && mipsSameOperand(&store->operands[1], &load->operands[1])) {
+            int valueReg = store->operands[0].reg;
+            for (int j = k + 1; j < index; j++) {
+                if (writesRegister(&program->instrs[j], valueReg)) return false;
+            }
+            if (pair == 1 && !holdsByte(program, k, valueReg)) return false;
+
+            if (valueReg == load->operands[0].reg) {
+                removeInstr(program, index);
+            } else {
+                replaceWithMove(program, index, pairs[pair][2], load->operands[0].reg, valueReg);
+            }
+            return true;
+        }
+        // Any other store that may write the same bytes ends the search
+        const char* storeSymbol = mipsMemorySymbol(store);
+        if (!storeSymbol || strcmp(storeSymbol, symbol) == 0) return false;
+    }
+    return false;
+}
+
+// move/mov.s: read the source in later instructions instead, then drop the copy once
+// nothing reads it (and drop copies of a register to itself)
+static bool propagateMove(MIPSProgram* program, int index) {
+    MIPSInstr* move = &program->instrs[index];
+    if ((move->op != MIPSOp_Move && move->op != MIPSOp_MovS) || move->operandCount != 2) return false;
+    int dest = move->operands[0].reg;
+    int src = move->operands[1].reg;
+    if (dest == src) {
+        removeInstr(program, index);
+        return true;
+    }
+
+    int newRegs[MIPS_REGISTER_COUNT];
+    for (int r = 0; r < MIPS_REGISTER_COUNT; r++) newRegs[r] = -1;
+    newRegs[dest] = src;
+
+    bool changed = false;
+    int end = blockEnd(program, index);
+    for (int k = index + 1; k < end && k <= index + PEEPHOLE_WINDOW; k++) {
+        MIPSInstr* instr = &program->instrs[k];
+        if (isOpaque(instr)) break;
+        changed |= renameReads(instr, newRegs);
+        if (writesRegister(instr, dest) || writesRegister(instr, src)) break;
+    }
+    if (isDeadAfter(program, index, dest)) {
+        removeInstr(program, index);
+        return true;
+    }
+    return changed;
+}
+
+// la of a label another register still holds the address of: copy that register
+static bool reuseAddress(MIPSProgram* program, int index) {
+    MIPSInstr* la = &program->instrs[index];
+    if (la->op != MIPSOp_La || la->operandCount != 2) return false;
+
+    int start = blockStart(program, index);
+    for (int k = index - 1; k >= start && k >= index - PEEPHOLE_WINDOW; k--) {
+        MIPSInstr* earlier = &program->instrs[k];
+        if (isOpaque(earlier)) return false;
+        if (earlier->op != MIPSOp_La || !mipsSameOperand(&earlier->operands[1], &la->operands[1])) continue;
+
+        int reg = earlier->operands[0].reg;
+        bool unchanged = true;
+        for (int j = k + 1; j < index && unchanged; j++) {
+            unchanged = !writesRegister(&program->instrs[j], reg);
+        }
+        if (!unchanged) continue;
+
+        if (reg == la->operands[0].reg) {
+            removeInstr(program, index);
+        } else {
+            replaceWithMove(program, index, MIPSOp_Move, la->operands[0].reg, reg);
+        }
+        return true;
+    }
+    return false;
+}
+
+// li of 0: read $zero instead, then drop the li once nothing reads it
+static bool useZeroRegister(MIPSProgram* program, int index) {
+    MIPSInstr* li = &program->instrs[index];
+    if (li->op != MIPSOp_Li || li->operandCount != 2 || li->operands[1].value != 0) return false;
+    int reg = li->operands[0].reg;
+    if (reg <= 0 || reg >= MIPS_FLOAT_REGISTER_BASE) return false;
+
+    int newRegs[MIPS_REGISTER_COUNT];
+    for (int r = 0; r < MIPS_REGISTER_COUNT; r++) newRegs[r] = -1;
+    newRegs[reg] = MIPS_ZERO;
+
+    bool changed = false;
+    int end = blockEnd(program, index);
+    for (int k = index + 1; k < end && k <= index + PEEPHOLE_WINDOW; k++) {
+        MIPSInstr* instr = &program->instrs[k];
+        if (isOpaque(instr)) break;
+        changed |= renameReads(instr, newRegs);
+        if (writesRegister(instr, reg)) break;
+    }
+    if (isDeadAfter(program, index, reg)) {
+        removeInstr(program, index);
+        return true;
+    }
+    return changed;
+}
+
+static PeepholeRule rules[] = {
+    {"forwardStoredValue", forwardStoredValue, 0},
+    {"propagateMove", propagateMove, 0},
+    {"reuseAddress", reuseAddress, 0},
+    {"useZeroRegister", useZeroRegister, 0},
+};
+#define RULE_COUNT (sizeof(rules) / sizeof(rules[0]))
+
+void runPeephole(MIPSProgram* program, const int* tempRegisters, int tempRegisterCount) {
+    for (int r = 0; r < MIPS_REGISTER_COUNT; r++) isTemp[r] = false;
+    for (int i = 0; i < tempRegisterCount; i++) isTemp[tempRegisters[i]] = true;
+
+    // A rewrite can expose another one earlier in the block, so repeat until nothing matches
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < program->count; i++) {
+            if (!program->instrs[i].op) continue;
+            for (size_t r = 0; r < RULE_COUNT; r++) {
+                if (rules[r].apply(program, i)) {
+                    rules[r].hits++;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void printPeepholeStats() {
+    for (size_t r = 0; r < RULE_COUNT; r++) {
+        printf("PEEPHOLE (%s): %d hits\n", rules[r].name, rules[r].hits);
+    }
+}
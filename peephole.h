@@ -0,0 +1,22 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include "mipsInstr.h"
+
+// How far back or ahead a rule looks for the instructions it pairs up
+#define PEEPHOLE_WINDOW 16
+
+/**
+ * Apply the peephole rules to every basic block until none matches.
+ *
+ * @param program The code to rewrite in place.
+ * @param tempRegisters Registers that hold nothing at block boundaries, so a value left
+ *        in one at the end of a block is dead. May be NULL with a count of 0.
+ * @param tempRegisterCount Number of entries in `tempRegisters`.
+ */
+void runPeephole(MIPSProgram* program, const int* tempRegisters, int tempRegisterCount);
+
+// Print how often each rule fired across every runPeephole() call of the compile
+void printPeepholeStats();
+
+#endif
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "cmmRuntime.h"
+
+// Most a single int/char/float write (sign, digits, point, newline) can add
+#define RT_MAX_VALUE_LENGTH 32
+
+static char buffer[RT_BUFFER_SIZE];
+static size_t length = 0;
+
+void rt_flush(void) {
+    size_t written = 0;
+    while (written < length) {
+        ssize_t count = write(STDOUT_FILENO, buffer + written, length - written);
+        if (count <= 0) break;
+        written += count;
+    }
+    length = 0;
+}
+
+void rt_overflow(void) {
+    rt_flush();
+    fputs("Arithmetic overflow\n", stderr);
+    exit(1);
+}
+
+// Make room for one value
+static void reserve(void) {
+    if (length > RT_BUFFER_SIZE - RT_MAX_VALUE_LENGTH) rt_flush();
+}
+
+// Digits of a value taken as -|value|, so INT_MIN needs no special case
+static void putDigits(int negated) {
+    char digits[12];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' - negated % 10);
+        negated /= 10;
+    } while (negated != 0);
+    while (count > 0) buffer[length++] = digits[--count];
+}
+
+void rt_write_int(int value) {
+    reserve();
+    if (value < 0) {
+        buffer[length++] = '-';
+        putDigits(value);
+    } else {
+        putDigits(-value);
+    }
+    buffer[length++] = '\n';
+}
+
+void rt_write_char(int value) {
+    reserve();
+    buffer[length++] = (char)value;
+    buffer[length++] = '\n';
+}
+
+// Up to six fraction digits, without trailing zeros but with at least one ("2.5", "3.0")
+//  Values of 2^31 and above (and inf/NaN) are printed with %g instead.
+void rt_write_float(float value) {
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    reserve();
+    if ((bits & 0x7fffffff) >= 0x4f000000) {
+        length += snprintf(buffer + length, RT_MAX_VALUE_LENGTH, "%g\n", value);
+        return;
+    }
+
+    if (bits & 0x80000000) {
+        buffer[length++] = '-';
+        value = -value;
+    }
+    int whole = (int)value;
+    // One float operation per statement, rounding after each step like the MIPS runtime
+    float scaled = (value - (float)whole);
+    scaled = scaled * 1000000.0f;
+    scaled = scaled + 0.5f;
+    int fraction = (int)scaled;
+    if (fraction >= 1000000) {
+        whole++;
+        fraction = 0;
+    }
+    putDigits(-whole);
+    buffer[length++] = '.';
+    for (int divisor = 100000; divisor > 0; divisor /= 10) {
+        buffer[length++] = (char)('0' + fraction / divisor);
+        fraction %= divisor;
+        if (fraction == 0) break;
+    }
+    buffer[length++] = '\n';
+}
+
+void rt_write_string(const char* text) {
+    while (*text) {
+        if (length == RT_BUFFER_SIZE) rt_flush();
+        buffer[length++] = *text++;
+    }
+}
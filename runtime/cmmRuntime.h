@@ -0,0 +1,24 @@
+#ifndef CMM_RUNTIME_H
+#define CMM_RUNTIME_H
+
+// Output routines for natively compiled programs (see --target)
+//  Writes are formatted into a buffer that goes to standard output with one write()
+//  whenever it fills up and when rt_flush() is called before the program exits.
+//  Values are printed like the MIPS --buffered-output runtime prints them.
+
+#define RT_BUFFER_SIZE 65536
+
+void rt_write_int(int value);
+void rt_write_float(float value);
+void rt_write_char(int value);
+
+// Write a NUL-terminated string as it is (no newline is added)
+void rt_write_string(const char* text);
+
+void rt_flush(void);
+
+// Flush the output and stop the program with an error, for an int addition or
+// subtraction that overflowed (MIPS add and sub trap there)
+void rt_overflow(void);
+
+#endif
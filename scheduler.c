@@ -0,0 +1,346 @@
+// scheduler.c
+#include "scheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// What an instruction reads, writes and how long its result takes
+typedef struct SchedNode {
+    MIPSKind kind;
+    int defs[MIPS_MAX_REGISTER_REFS];
+    int defCount;
+    int uses[MIPS_MAX_REGISTER_REFS];
+    int useCount;
+    const char* symbol;     // Label of a memory access, NULL if it may touch anything
+    int latency;
+} SchedNode;
+
+// Live range of a temp register within a block
+typedef struct LiveRange {
+    int reg;
+    int start;              // Instruction that writes it (the block start for live-in values)
+    int end;                // Last instruction that reads it
+    bool renamable;
+    int newReg;
+} LiveRange;
+
+// Totals for the code being scheduled, printed at the end
+static int stallsBefore = 0;
+static int stallsAfter = 0;
+static int delaySlots = 0;
+static int filledDelaySlots = 0;
+
+static void describeNode(const MIPSInstr* instr, SchedNode* node) {
+    node->kind = mipsInstrKind(instr);
+    mipsInstrRegisters(instr, node->defs, &node->defCount, node->uses, &node->useCount);
+    node->symbol = (node->kind == MIPSKind_Load || node->kind == MIPSKind_Store) ? mipsMemorySymbol(instr) : NULL;
+    node->latency = mipsResultLatency(instr);
+}
+
+static bool containsRegister(const int* regs, int count, int reg) {
+    for (int i = 0; i < count; i++) {
+        if (regs[i] == reg) return true;
+    }
+    return false;
+}
+
+// Cycles `later` must issue after `earlier`, -1 if their order doesn't matter
+//  Accesses to different labels never overlap; an access through a register may touch anything.
+static int dependence(const SchedNode* earlier, const SchedNode* later) {
+    int latency = -1;
+    for (int i = 0; i < later->useCount; i++) {
+        if (containsRegister(earlier->defs, earlier->defCount, later->uses[i])) latency = earlier->latency;
+    }
+    for (int i = 0; i < later->defCount && latency < 0; i++) {
+        if (containsRegister(earlier->uses, earlier->useCount, later->defs[i])
+            || containsRegister(earlier->defs, earlier->defCount, later->defs[i])) {
+            latency = 0;
+        }
+    }
+    bool earlierWrites = earlier->kind == MIPSKind_Store;
+    bool laterWrites = later->kind == MIPSKind_Store;
+    bool earlierAccesses = earlierWrites || earlier->kind == MIPSKind_Load;
+    bool laterAccesses = laterWrites || later->kind == MIPSKind_Load;
+    if (latency < 0 && earlierAccesses && laterAccesses && (earlierWrites || laterWrites)) {
+        if (!earlier->symbol || !later->symbol || strcmp(earlier->symbol, later->symbol) == 0) latency = 0;
+    }
+    return latency;
+}
+
+// Stall cycles issuing a window's instructions in `order`, with `dep` giving their dependences
+static int countStalls(int count, const int* order, int dep[SCHEDULE_WINDOW + 1][SCHEDULE_WINDOW + 1]) {
+    int issue[SCHEDULE_WINDOW + 1];
+    int cycle = 0;
+    int stalls = 0;
+    for (int k = 0; k < count; k++) {
+        int node = order[k];
+        int ready = cycle;
+        for (int j = 0; j < k; j++) {
+            int pred = order[j];
+            if (pred < node && dep[pred][node] > 0 && issue[pred] + dep[pred][node] > ready) {
+                ready = issue[pred] + dep[pred][node];
+            }
+        }
+        stalls += ready - cycle;
+        issue[node] = ready;
+        cycle = ready + 1;
+    }
+    return stalls;
+}
+
+// List-schedule `count` instructions with no branches or barriers among them
+//  Each cycle issues the ready instruction with the longest path to the end of the window,
+//  stalling only when every instruction left still waits on a load. `terminator` is the
+//  branch or barrier right after the window (NULL if none): it stays last, but what it
+//  reads is loaded early.
+static void scheduleWindow(MIPSInstr* instrs, int count, const MIPSInstr* terminator) {
+    SchedNode nodes[SCHEDULE_WINDOW + 1];
+    int dep[SCHEDULE_WINDOW + 1][SCHEDULE_WINDOW + 1];
+    int height[SCHEDULE_WINDOW + 1];
+    int predCount[SCHEDULE_WINDOW + 1];
+    int earliest[SCHEDULE_WINDOW + 1];
+    bool scheduled[SCHEDULE_WINDOW + 1];
+    int order[SCHEDULE_WINDOW + 1];
+
+    int nodeCount = count + (terminator ? 1 : 0);
+    if (count == 0) return;
+    for (int i = 0; i < nodeCount; i++) {
+        describeNode((i < count) ? &instrs[i] : terminator, &nodes[i]);
+        predCount[i] = 0;
+        earliest[i] = 0;
+        scheduled[i] = false;
+    }
+    for (int i = 0; i < nodeCount; i++) {
+        for (int j = i + 1; j < nodeCount; j++) {
+            dep[i][j] = dependence(&nodes[i], &nodes[j]);
+            if (j == count && dep[i][j] < 0) dep[i][j] = 0;     // Nothing moves past the terminator
+            if (dep[i][j] >= 0) predCount[j]++;
+        }
+    }
+    for (int i = nodeCount - 1; i >= 0; i--) {
+        height[i] = 1;
+        for (int j = i + 1; j < nodeCount; j++) {
+            if (dep[i][j] >= 0 && dep[i][j] + height[j] > height[i]) height[i] = dep[i][j] + height[j];
+        }
+    }
+
+    int cycle = 0;
+    for (int k = 0; k < nodeCount; k++) {
+        int best = -1;
+        for (int i = 0; i < nodeCount; i++) {
+            if (scheduled[i] || predCount[i] > 0) continue;
+            if (best < 0) {
+                best = i;
+                continue;
+            }
+            bool ready = earliest[i] <= cycle;
+            bool bestReady = earliest[best] <= cycle;
+            if (ready != bestReady) {
+                if (ready) best = i;
+            } else if (!ready && earliest[i] != earliest[best]) {
+                if (earliest[i] < earliest[best]) best = i;
+            } else if (height[i] > height[best]) {
+                best = i;
+            }
+        }
+
+        if (earliest[best] > cycle) cycle = earliest[best];
+        scheduled[best] = true;
+        order[k] = best;
+        for (int j = best + 1; j < nodeCount; j++) {
+            if (dep[best][j] < 0) continue;
+            predCount[j]--;
+            if (cycle + dep[best][j] > earliest[j]) earliest[j] = cycle + dep[best][j];
+        }
+        cycle++;
+    }
+
+    int original[SCHEDULE_WINDOW + 1];
+    for (int i = 0; i < nodeCount; i++) original[i] = i;
+    stallsBefore += countStalls(nodeCount, original, dep);
+    stallsAfter += countStalls(nodeCount, order, dep);
+
+    MIPSInstr reordered[SCHEDULE_WINDOW];
+    for (int k = 0; k < count; k++) reordered[k] = instrs[order[k]];
+    memcpy(instrs, reordered, count * sizeof(MIPSInstr));
+}
+
+// Does interval [start, end] of one value overlap that of another in the same register?
+//  A value may be written by the instruction that last reads the previous one.
+static bool rangesOverlap(const LiveRange* a, const LiveRange* b) {
+    return a->start < b->end && b->start < a->end;
+}
+
+// Give every temp live range in block [start, end) its own register where possible,
+// so the only dependences left between statements are real ones
+static void renameTemps(MIPSInstr* instrs, int start, int end, const bool* isTemp) {
+    LiveRange* ranges = NULL;
+    int rangeCount = 0;
+    int current[MIPS_REGISTER_COUNT];
+    for (int r = 0; r < MIPS_REGISTER_COUNT; r++) current[r] = -1;
+
+    for (int k = start; k < end; k++) {
+        int defs[MIPS_MAX_REGISTER_REFS], uses[MIPS_MAX_REGISTER_REFS], defCount, useCount;
+        mipsInstrRegisters(&instrs[k], defs, &defCount, uses, &useCount);
+        for (int i = 0; i < useCount; i++) {
+            int reg = uses[i];
+            if (!isTemp[reg]) continue;
+            if (current[reg] < 0) {
+                // Read before being written: leave whatever it holds where it is
+                ranges = realloc(ranges, (rangeCount + 1) * sizeof(LiveRange));
+                ranges[rangeCount] = (LiveRange){reg, start, k, false, reg};
+                current[reg] = rangeCount++;
+            }
+            ranges[current[reg]].end = k;
+        }
+        for (int i = 0; i < defCount; i++) {
+            int reg = defs[i];
+            if (!isTemp[reg]) continue;
+            ranges = realloc(ranges, (rangeCount + 1) * sizeof(LiveRange));
+            ranges[rangeCount] = (LiveRange){reg, k, k, true, -1};
+            current[reg] = rangeCount++;
+        }
+    }
+
+    // Assign registers in order of first write, each to the temp free the longest
+    int freeSince[MIPS_REGISTER_COUNT];
+    for (int r = 0; r < MIPS_REGISTER_COUNT; r++) freeSince[r] = -1;
+    for (int i = 0; i < rangeCount; i++) {
+        if (!ranges[i].renamable) continue;
+        bool isFloat = ranges[i].reg >= MIPS_FLOAT_REGISTER_BASE;
+        int best = -1;
+        for (int r = 0; r < MIPS_REGISTER_COUNT; r++) {
+            if (!isTemp[r] || (r >= MIPS_FLOAT_REGISTER_BASE) != isFloat || freeSince[r] > ranges[i].start) continue;
+            bool taken = false;
+            for (int j = 0; j < rangeCount && !taken; j++) {
+                taken = !ranges[j].renamable && ranges[j].newReg == r && rangesOverlap(&ranges[i], &ranges[j]);
+            }
+            if (!taken && (best < 0 || freeSince[r] < freeSince[best])) best = r;
+        }
+        if (best < 0) {
+            // More values live at once than temps: keep the block as generated
+            free(ranges);
+            return;
+        }
+        ranges[i].newReg = best;
+        freeSince[best] = ranges[i].end;
+    }
+
+    // Rewrite the operands, replaying the reads and writes in the order the ranges were found
+    int newRegs[MIPS_REGISTER_COUNT];
+    int next = 0;
+    for (int r = 0; r < MIPS_REGISTER_COUNT; r++) current[r] = -1;
+    for (int k = start; k < end; k++) {
+        int defs[MIPS_MAX_REGISTER_REFS], uses[MIPS_MAX_REGISTER_REFS], defCount, useCount;
+        mipsInstrRegisters(&instrs[k], defs, &defCount, uses, &useCount);
+        int defOperand = mipsDefOperand(&instrs[k]);
+
+        for (int i = 0; i < useCount; i++) {
+            if (isTemp[uses[i]] && current[uses[i]] < 0) current[uses[i]] = next++;
+        }
+        for (int r = 0; r < MIPS_REGISTER_COUNT; r++) {
+            newRegs[r] = (current[r] >= 0) ? ranges[current[r]].newReg : -1;
+        }
+        for (int i = 0; i < instrs[k].operandCount; i++) {
+            if (i != defOperand) renameMIPSRegisters(&instrs[k], i, newRegs);
+        }
+
+        for (int i = 0; i < defCount; i++) {
+            if (!isTemp[defs[i]]) continue;
+            current[defs[i]] = next++;
+            newRegs[defs[i]] = ranges[current[defs[i]]].newReg;
+        }
+        if (defOperand >= 0) renameMIPSRegisters(&instrs[k], defOperand, newRegs);
+    }
+    free(ranges);
+}
+
+// Move an instruction from before the branch ending `out` into its delay slot, or add a nop
+//  The instruction must be a single machine instruction that neither the branch nor
+//  anything between them depends on.
+static void fillDelaySlot(MIPSProgram* out, int blockStart) {
+    int branch = out->count - 1;
+    SchedNode branchNode;
+    describeNode(&out->instrs[branch], &branchNode);
+    delaySlots++;
+
+    for (int k = branch - 1; k >= blockStart; k--) {
+        SchedNode candidate;
+        describeNode(&out->instrs[k], &candidate);
+        if (candidate.kind == MIPSKind_Barrier) break;
+        if (!isSingleMachineInstr(&out->instrs[k]) || dependence(&candidate, &branchNode) >= 0) continue;
+
+        bool movable = true;
+        for (int j = k + 1; j < branch && movable; j++) {
+            SchedNode between;
+            describeNode(&out->instrs[j], &between);
+            movable = dependence(&candidate, &between) < 0;
+        }
+        if (!movable) continue;
+
+        MIPSInstr filler = out->instrs[k];
+        memmove(&out->instrs[k], &out->instrs[k + 1], (branch - k) * sizeof(MIPSInstr));
+        out->instrs[branch] = filler;
+        filledDelaySlots++;
+        return;
+    }
+
+    if (out->count == out->capacity) {
+        out->capacity *= 2;
+        out->instrs = realloc(out->instrs, out->capacity * sizeof(MIPSInstr));
+    }
+    out->instrs[out->count++] = makeMIPSInstr(MIPSOp_Nop);
+}
+
+void scheduleMIPS(MIPSProgram* program, const int* tempRegisters, int tempRegisterCount, bool fillDelaySlots) {
+    stallsBefore = stallsAfter = delaySlots = filledDelaySlots = 0;
+
+    bool isTemp[MIPS_REGISTER_COUNT] = {false};
+    for (int i = 0; i < tempRegisterCount; i++) isTemp[tempRegisters[i]] = true;
+
+    // Delay slots can add one nop per branch
+    MIPSProgram out = {0};
+    out.capacity = program->count * 2 + 1;
+    out.instrs = malloc(out.capacity * sizeof(MIPSInstr));
+
+    int k = 0;
+    while (k < program->count) {
+        if (!program->instrs[k].op) {
+            out.instrs[out.count++] = program->instrs[k++];
+            continue;
+        }
+
+        // A basic block runs up to the next label or directive, or through a branch
+        int start = k;
+        while (k < program->count && program->instrs[k].op) {
+            k++;
+            if (mipsInstrKind(&program->instrs[k - 1]) == MIPSKind_Branch) break;
+        }
+        if (tempRegisterCount > 0) renameTemps(program->instrs, start, k, isTemp);
+
+        int blockStart = out.count;
+        int window = out.count;
+        for (int i = start; i < k; i++) {
+            MIPSKind kind = mipsInstrKind(&program->instrs[i]);
+            bool ends = (kind == MIPSKind_Branch || kind == MIPSKind_Barrier);
+            if (ends || out.count - window == SCHEDULE_WINDOW) {
+                scheduleWindow(&out.instrs[window], out.count - window, ends ? &program->instrs[i] : NULL);
+                window = out.count + ends;
+            }
+            out.instrs[out.count++] = program->instrs[i];
+        }
+        scheduleWindow(&out.instrs[window], out.count - window, NULL);
+
+        if (fillDelaySlots && mipsInstrKind(&out.instrs[out.count - 1]) == MIPSKind_Branch) {
+            fillDelaySlot(&out, blockStart);
+        }
+    }
+
+    free(program->instrs);
+    *program = out;
+
+    printf("SCHEDULER: %d load-use stall cycles reduced to %d\n", stallsBefore, stallsAfter);
+    if (fillDelaySlots) {
+        printf("SCHEDULER: Filled %d of %d delay slots\n", filledDelaySlots, delaySlots);
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "mipsInstr.h"
+#include <stdbool.h>
+
+// Instructions the list scheduler reorders at a time
+#define SCHEDULE_WINDOW 64
+
+/**
+ * Reorder the instructions of each basic block so loaded values aren't used
+ * right away, on a single-issue pipeline where a load's result arrives one cycle
+ * after any other result.
+ *
+ * @param program The code to schedule, rewritten in place.
+ * @param tempRegisters Registers that hold nothing at block boundaries. Their live
+ *        ranges are renamed among these first, so statements that reuse the same
+ *        temp no longer have to stay in order. May be NULL with a count of 0.
+ * @param tempRegisterCount Number of entries in `tempRegisters`.
+ * @param fillDelaySlots Write code for `.set noreorder`: every jump and branch is
+ *        followed by an instruction moved from before it, or a nop.
+ */
+void scheduleMIPS(MIPSProgram* program, const int* tempRegisters, int tempRegisterCount, bool fillDelaySlots);
+
+#endif
@@ -2,6 +2,8 @@
 #include "symbolTable.h"
 #include "codeGenerator.h"
 #include "operandStack.h"
+#include "commons/options.h"
+#include "commons/outputWriter.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -192,6 +194,10 @@ void handleFunctionDeclaration(ASTNode* node) {
         currentParamList = currentParamList->data.paramList.next;
     }
 
+    //Decide which registers (or stack slots) each argument is passed in
+    assignArgLocations(funcSymbol);
+    currentFuncTAC->params = funcSymbol->params;
+
     semanticAnalysis(node->data.funcDecl.paramList);
     semanticAnalysis(node->data.funcDecl.varDeclList);
     semanticAnalysis(node->data.funcDecl.stmtList);
@@ -267,34 +273,33 @@ void handleReturnStmt(ASTNode* node)
     {
         semanticAnalysis(node->data.returnStmt.returnExpr);
         Operand* returnOperand = popOperand();
-        char* result;
         char* operator;
         
+        //Return values are passed back in $v0 (int/char) or $f0 (float)
         switch (returnOperand->operandType)
         {
             case (VarType_Int):
-                result = "returnInt";
-                operator = "store.int";
+                operator = "setReturn.int";
                 break;
             case (VarType_Float):
-                result = "returnFloat";
-                operator = "store.float";
+                operator = "setReturn.float";
                 break;
             case (VarType_Char):
-                result = "returnChar";
-                operator = "store.char";
+                operator = "setReturn.char";
                 break;
             default:
                 printf("Invalid return type: %s\n", varTypeToString(returnOperand->operandType));
+                exit(1);
                 break;
         }
         TAC* returnValueInstr = createTAC(  //Output return value
-            result,
+            NULL,
             returnOperand->operandID,
             operator,
             NULL            
         );
         appendTAC(currentTacHead, currentTacTail, returnValueInstr);
+        freeOperand(returnOperand);
     }
     else
     {
@@ -565,10 +570,21 @@ TAC* generateTACForExpr(ASTNode* expr) {
 
 // Generate TACs for function call
 void generateTACForFuncCall(ASTNode* funcCall) {
-    //Copy all argument variables into function parameter variables
+    //Pass each argument in the location chosen by the calling convention
     Symbol* funcSymbol = lookupSymbol(symTabRef, funcCall->data.funcCall.name);
     FuncParam* currentParam = getParamsTail(funcSymbol); //Arguments pop in reverse order-- get end of params list
-    printf("paramsTail: %s %s\n", varTypeToString(currentParam->type), currentParam->name);
+
+    //Arguments that don't fit in registers are passed in an outgoing area on the stack
+    int stackArgBytes = 0;
+    for (FuncParam* param = funcSymbol->params; param; param = param->next) {
+        if (!param->argRegister) stackArgBytes += 4;
+    }
+    char stackArgString[20];
+    snprintf(stackArgString, 20, "%d", stackArgBytes);
+    if (stackArgBytes > 0) {
+        TAC* reserveInstr = createTAC(NULL, stackArgString, "reserveArgs", NULL);
+        appendTAC(currentTacHead, currentTacTail, reserveInstr);
+    }
 
     while (currentParam) {
         //Arguments are special expr nodes. Each argument should still be on the stack.
@@ -586,10 +602,13 @@ void generateTACForFuncCall(ASTNode* funcCall) {
         switch (argOperand->operandType)
         {
             case (VarType_Int):
-                operandString = "load.int";
+                operandString = "arg.int";
                 break;
             case (VarType_Float):
-                operandString = "load.float";
+                operandString = "arg.float";
+                break;
+            case (VarType_Char):
+                operandString = "arg.char";
                 break;
             default:
                 printf("SEMANTIC: Invalid argument type, halting...\n");
@@ -597,62 +616,50 @@ void generateTACForFuncCall(ASTNode* funcCall) {
                 break;
         }
 
+        //arg2 holds the argument register, or the offset into the outgoing argument area
+        char location[20];
+        if (currentParam->argRegister) {
+            snprintf(location, 20, "%s", currentParam->argRegister);
+        } else {
+            snprintf(location, 20, "%d", currentParam->stackOffset);
+        }
+
         TAC* argInstr = createTAC(
             currentParam->name,     //result
             argOperand->operandID,  //operand 1
             operandString,          //operator
-            NULL                    //operand 2
+            location                //operand 2
         );
-        // appendTAC(&tacHead, &tacTail, argInstr);
         appendTAC(currentTacHead, currentTacTail, argInstr);
         freeOperand(argOperand);
         currentParam = currentParam->prev; //Traverse backwards
     }
-    //Jump to function label
-    //  Not implemented yet. IMO, the easiest way to handle this would be saving function
-    //  declarations in a separate TAC structure. We could use the address of the head of
-    //  a function TAC as an operand in order to call the function call in question, like so:
 
-    //  (Assume &functionTAC = 4539821)
-    //  returnVar = 4539821 functionCall (NULL)
-    
-    //First, get the return variable's name
-    char* result;
-    switch(funcSymbol->type)
+    //The return value arrives in $v0/$f0 and is copied into a fresh temp right after
+    //the call, so nested calls can't clobber it before it is used
+    char* result = NULL;
+    if (funcSymbol->type != VarType_Void) 
     {
-        case (VarType_Int):
-            result = "returnInt";
-            break;
-        case (VarType_Float):
-            result = "returnFloat";
-            break;
-        case (VarType_Void):
-            result = NULL;
-            break;
-        default:
-            break;
+        result = createTempVar(funcSymbol->type);
+        pushOperand(createOperandStruct(result, funcSymbol->type));
     }
 
     //Get the name of the label, used here as an operand
     int labelLength = snprintf(NULL, 0, "%s_func", funcCall->data.funcCall.name); //Get length of const sum so we can allocate appropriate string length
     char* labelName = malloc(labelLength + 1);
     snprintf(labelName, labelLength + 1, "%s_func", funcCall->data.funcCall.name);
-    // char* labelName = currentFuncTAC->funcName;
-
-    //Create a return operand and push it to the stack (if return is non-void)
-    if (funcSymbol->type != VarType_Void) 
-    {
-        pushOperand(createOperandStruct(result, funcSymbol->type));
-    }
     
     //Create and append TAC
+    //  arg2 holds the size of the outgoing argument area to release after the call
     TAC* functionCallTAC = createTAC(
         result,
         labelName,
         "functionCall",
-        NULL
+        (stackArgBytes > 0) ? stackArgString : NULL
     );
     appendTAC(currentTacHead, currentTacTail, functionCallTAC);
+    free(labelName);
+    free(result);
 }
 
 // Generate TAC for variable assignment
@@ -770,6 +777,21 @@ TAC* generateTACForAssignArr(ASTNode* assignArrStmt) {
 // Generate TAC for write statements
 TAC* generateTACForWrite(ASTNode* expr) {
 
+    //A whole char array is printed as a string
+    ASTNode* writeExpr = expr->data.writeStmt.expr;
+    if (writeExpr->type == NodeType_SimpleID) {
+        Symbol* arrSymbol = lookupSymbol(symTabRef, writeExpr->data.simpleID.name);
+        if (arrSymbol && arrSymbol->isArray) {
+            if (arrSymbol->type != VarType_Char) {
+                printf("SEMANTIC ERROR: Only char arrays can be written without an index (%s)\n", arrSymbol->name);
+                exit(1);
+            }
+            TAC* writeInstr = createTAC(NULL, arrSymbol->name, "write.charArray", NULL);
+            appendTAC(currentTacHead, currentTacTail, writeInstr);
+            return writeInstr;
+        }
+    }
+
     semanticAnalysis(expr->data.writeStmt.expr);
     
     //Get the result of the most recent expr evaluation
@@ -912,20 +934,20 @@ void printTAC(TAC* tac) {
 
 // Print TAC to a file
 void printTACToFile(const char* filename, TAC* tac) {
-    FILE* file = fopen(filename, "w");
-    if (!file) {
+    OutputWriter file;
+    if (!openOutputWriter(&file, filename)) {
         perror("Failed to open file");
         return;
     }
     TAC* current = tac;
     while (current) {
-        fprintf(file, "%s = %s %s %s\n", current->result ? current->result : "(null)",
+        writerPrintf(&file, "%s = %s %s %s\n", current->result ? current->result : "(null)",
                 current->arg1 ? current->arg1 : "(null)",
                 current->op ? current->op : "(null)",
                 current->arg2 ? current->arg2 : "(null)");
         current = current->next;
     }
-    fclose(file);
+    closeOutputWriter(&file);
     printf("TAC written to %s\n", filename);
 }
 
@@ -935,13 +957,14 @@ void printFuncTACsToFile() {
     FuncTAC* currentFunc = funcTacHeads; //Get the start of all func TACs
 
     while(currentFunc) {
-        //Allocate space for filename, and print the name to the allocated buffer
-        int filenameLength = snprintf(NULL, 0, "output/FunctionTAC%d.ir", functionNum); //Get length of const sum so we can allocate appropriate string length
-	    char* filename = malloc(filenameLength + 1);
-        snprintf(filename, filenameLength + 1, "output/FunctionTAC%d.ir", functionNum);
+        //Name the file after the function's position, next to the assembly output
+        char baseName[32];
+        char filename[1024];
+        snprintf(baseName, sizeof(baseName), "FunctionTAC%d.ir", functionNum);
+        outputSiblingPath(filename, sizeof(filename), baseName);
         //Create file with generated name
-        FILE* file = fopen(filename, "w");
-        if (!file) {
+        OutputWriter file;
+        if (!openOutputWriter(&file, filename)) {
             perror("Failed to open file");
             return;
         }
@@ -950,14 +973,14 @@ void printFuncTACsToFile() {
         printf("==Function %d TAC==\n", functionNum);
         // printf("currentTAC->next: %d\n", currentTAC->next);
         while (currentTAC) {
-            fprintf(file, "%s = %s %s %s\n", currentTAC->result ? currentTAC->result : "(null)",
+            writerPrintf(&file, "%s = %s %s %s\n", currentTAC->result ? currentTAC->result : "(null)",
                     currentTAC->arg1 ? currentTAC->arg1 : "(null)",
                     currentTAC->op ? currentTAC->op : "(null)",
                     currentTAC->arg2 ? currentTAC->arg2 : "(null)");
             printTAC(currentTAC);
             currentTAC = currentTAC->next;
         }
-        fclose(file);
+        closeOutputWriter(&file);
         printf("Function TAC written to %s\n", filename);
 
         //Go to the next function, if it exists
@@ -968,23 +991,40 @@ void printFuncTACsToFile() {
 
 // Destroy a TAC and re-link list
 void removeTAC(TAC** del) {
+    removeTACFromList(&tacHead, &tacTail, del);
+}
+
+// Destroy a TAC and re-link the list it belongs to (main or function TAC)
+void removeTACFromList(TAC** head, TAC** tail, TAC** del) {
     if (!*del) return;
 
-    if (tacHead == (*del)) {
-        tacHead = (*del)->next;
-        if (tacHead) tacHead->prev = NULL;
+    if (*head == (*del)) {
+        *head = (*del)->next;
+        if (*head) (*head)->prev = NULL;
     } else {
         (*del)->prev->next = (*del)->next;
     }
-    if (tacTail == (*del)) {
-        tacTail = (*del)->prev;
-        if (tacTail) tacTail->next = NULL;
+    if (*tail == (*del)) {
+        *tail = (*del)->prev;
+        if (*tail) (*tail)->next = NULL;
     } else {
         (*del)->next->prev = (*del)->prev;
     }
     freeTAC(del);
 }
 
+// Link a new TAC into a list right before `position`
+void insertTACBefore(TAC** head, TAC* position, TAC* newInstruction) {
+    newInstruction->prev = position->prev;
+    newInstruction->next = position;
+    if (position->prev) {
+        position->prev->next = newInstruction;
+    } else {
+        *head = newInstruction;
+    }
+    position->prev = newInstruction;
+}
+
 // Free the memory of a TAC
 void freeTAC(TAC** del) {
     if (!*del) return;
@@ -1017,16 +1057,9 @@ void replaceTAC(TAC** oldTAC, TAC** newTAC) {
     freeTAC(oldTAC);
 }
 
-void initFuncTAC(char* funcName, VarType returnType) {
-    //  It shouldn't be possible for this to run while already in a function TAC
-    // Should that ever change, insert a check to see if we're in global scope
-    // at the start.
-
-    //Generate the label name of the function
-    int labelLength = snprintf(NULL, 0, "%s_func", funcName); //Get length of const sum so we can allocate appropriate string length
-    char* labelName = malloc(labelLength + 1);
-    snprintf(labelName, labelLength + 1, "%s_func", funcName);
-
+// Create an empty function TAC and append it to the funcTacHeads/funcTacTails lists
+//  The head and tail entries share `labelName`
+FuncTAC* createFuncTAC(char* labelName, VarType returnType) {
     //Create new FuncTAC struct for head
     FuncTAC* newFuncTacHead = malloc(sizeof(FuncTAC));
     newFuncTacHead->func = NULL;
@@ -1034,6 +1067,7 @@ void initFuncTAC(char* funcName, VarType returnType) {
     newFuncTacHead->funcName = labelName;
     newFuncTacHead->returnType = returnType;
     newFuncTacHead->returnsValue = false;
+    newFuncTacHead->params = NULL;
     
     //Create new FuncTAC struct for head
     FuncTAC* newFuncTacTail = malloc(sizeof(FuncTAC));
@@ -1041,6 +1075,7 @@ void initFuncTAC(char* funcName, VarType returnType) {
     newFuncTacTail->nextFunc = NULL;
     newFuncTacTail->funcName = labelName;
     newFuncTacTail->returnType = returnType;
+    newFuncTacTail->params = NULL;
     // newFuncTacTail->returnType = false; //Should be unused
 
     // Append to existing lists
@@ -1064,9 +1099,24 @@ void initFuncTAC(char* funcName, VarType returnType) {
         funcTacTails = newFuncTacTail;
     }
 
+    return newFuncTacHead;
+}
+
+void initFuncTAC(char* funcName, VarType returnType) {
+    //  It shouldn't be possible for this to run while already in a function TAC
+    // Should that ever change, insert a check to see if we're in global scope
+    // at the start.
+
+    //Generate the label name of the function
+    int labelLength = snprintf(NULL, 0, "%s_func", funcName); //Get length of const sum so we can allocate appropriate string length
+    char* labelName = malloc(labelLength + 1);
+    snprintf(labelName, labelLength + 1, "%s_func", funcName);
+
+    FuncTAC* newFuncTacHead = createFuncTAC(labelName, returnType);
+
     // Set up the new TAC to be modified by other functions
     currentTacHead = &(newFuncTacHead->func); 
-    currentTacTail = &(newFuncTacTail->func); 
+    currentTacTail = getFuncTACTail(newFuncTacHead); 
     
     // Used for easy access to function name
     currentFuncTAC = newFuncTacHead;
@@ -1095,16 +1145,92 @@ void finalizeFuncTAC() {
     
     //Every functionTAC should end with "return"
     //  This operation signals MIPS to pop a return address from the stack and jump to it
-    TAC* returnInstr = createTAC(
-        NULL,
-        NULL,
-        "return",
-        NULL
-    );
-    appendTAC(currentTacHead, currentTacTail, returnInstr);
+    //  If the function already ends in an explicit return, reuse it instead of emitting
+    //  a second epilogue
+    if (strcmp((*currentTacTail)->op, "return") != 0) {
+        TAC* returnInstr = createTAC(
+            NULL,
+            NULL,
+            "return",
+            NULL
+        );
+        appendTAC(currentTacHead, currentTacTail, returnInstr);
+    }
 
     currentTacHead = &tacHead;
     currentTacTail = &tacTail;
     currentFuncTAC = NULL;
     inFunction = false;
 }
+
+// Find the function TAC with the given label name (e.g. "foo_var_func")
+FuncTAC* findFuncTAC(const char* funcName) {
+    for (FuncTAC* currentFunc = funcTacHeads; currentFunc; currentFunc = currentFunc->nextFunc) {
+        if (strcmp(currentFunc->funcName, funcName) == 0) return currentFunc;
+    }
+    return NULL;
+}
+
+// Get the tail pointer of a function TAC
+//  Tails are kept in the funcTacTails list, parallel to funcTacHeads
+TAC** getFuncTACTail(FuncTAC* funcTac) {
+    FuncTAC* currentHead = funcTacHeads;
+    FuncTAC* currentTail = funcTacTails;
+    while (currentHead && currentHead != funcTac) {
+        currentHead = currentHead->nextFunc;
+        currentTail = currentTail->nextFunc;
+    }
+    return currentHead ? &(currentTail->func) : NULL;
+}
+
+// Unlink a function TAC from the funcTacHeads/funcTacTails lists and free it
+void removeFuncTAC(FuncTAC* funcTac) {
+    FuncTAC** currentHead = &funcTacHeads;
+    FuncTAC** currentTail = &funcTacTails;
+    while (*currentHead && *currentHead != funcTac) {
+        currentHead = &((*currentHead)->nextFunc);
+        currentTail = &((*currentTail)->nextFunc);
+    }
+    if (!*currentHead) return;
+
+    FuncTAC* tailEntry = *currentTail;
+    *currentHead = funcTac->nextFunc;
+    *currentTail = tailEntry->nextFunc;
+
+    TAC* current = funcTac->func;
+    while (current) {
+        TAC* next = current->next;
+        freeTAC(&current);
+        current = next;
+    }
+    free(funcTac->funcName);    //Shared by the head and tail entries
+    free(funcTac);
+    free(tailEntry);
+}
+
+// Move a function TAC to the end of the funcTacHeads/funcTacTails lists
+//  Calling this on every function in turn lays the lists out in that order
+void moveFuncTACToEnd(FuncTAC* funcTac) {
+    FuncTAC** currentHead = &funcTacHeads;
+    FuncTAC** currentTail = &funcTacTails;
+    while (*currentHead && *currentHead != funcTac) {
+        currentHead = &((*currentHead)->nextFunc);
+        currentTail = &((*currentTail)->nextFunc);
+    }
+    if (!*currentHead) return;
+
+    //Unlink
+    FuncTAC* tailEntry = *currentTail;
+    *currentHead = funcTac->nextFunc;
+    *currentTail = tailEntry->nextFunc;
+    funcTac->nextFunc = NULL;
+    tailEntry->nextFunc = NULL;
+
+    //Append
+    while (*currentHead) {
+        currentHead = &((*currentHead)->nextFunc);
+        currentTail = &((*currentTail)->nextFunc);
+    }
+    *currentHead = funcTac;
+    *currentTail = tailEntry;
+}
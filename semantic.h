@@ -24,6 +24,7 @@ typedef struct FuncTAC {
     char* funcName;
     VarType returnType;
     bool returnsValue;  //Does this function include a return statement?
+    struct FuncParam* params;   //Parameters of the function, used to receive arguments on entry
 } FuncTAC;
 
 // Global variables
@@ -67,10 +68,17 @@ void printTAC(TAC* tac);
 void printTACToFile(const char* filename, TAC* tac);
 void printFuncTACsToFile();
 void removeTAC(TAC** del);
+void removeTACFromList(TAC** head, TAC** tail, TAC** del);
+void insertTACBefore(TAC** head, TAC* position, TAC* newInstruction);
 void freeTAC(TAC** del);                                        // Free memory of a TAC instruction
 void replaceTAC(TAC** oldTAC, TAC** newTAC);
 
+FuncTAC* createFuncTAC(char* labelName, VarType returnType);
 void initFuncTAC(char* funcName, VarType returnType);
 void finalizeFuncTAC();
+FuncTAC* findFuncTAC(const char* funcName);
+TAC** getFuncTACTail(FuncTAC* funcTac);
+void removeFuncTAC(FuncTAC* funcTac);
+void moveFuncTACToEnd(FuncTAC* funcTac);
 
 #endif // SEMANTIC_H
@@ -56,6 +56,10 @@ void freeSymbolTable(SymbolTable* symTab) {
             Symbol* nextSym = sym->next;
             free(sym->name);
             // free(sym->type);
+            if (sym->initValues) {
+                for (int i = 0; i < (sym->isArray ? sym->arrSize : 1); i++) free(sym->initValues[i]);
+                free(sym->initValues);
+            }
             free(sym);
             sym = nextSym;
         }
@@ -110,6 +114,7 @@ Symbol* addSymbol(SymbolTable* table, const char* name, const char* typeString)
     //Array elements are unused
     newSymbol->isArray = false;
     newSymbol->arrSize = 0;
+    newSymbol->initValues = NULL;
 
     //Function parameters are unused for non-functions
     //  Specialized function will be added to assign params
@@ -160,6 +165,7 @@ void addArrSymbol(SymbolTable* table, const char* name, const char* typeString,
     //Set array elements
     newSymbol->isArray = true;
     newSymbol->arrSize = size;
+    newSymbol->initValues = NULL;
 
     //Arrays are always non-functions
     newSymbol->params = NULL;
@@ -167,6 +173,22 @@ void addArrSymbol(SymbolTable* table, const char* name, const char* typeString,
     table->table[hashval] = newSymbol;
 }
 
+// Set the static initial value of a variable, or of one element of an array
+void setInitValue(Symbol* symbol, int index, const char* value) {
+    int count = symbol->isArray ? symbol->arrSize : 1;
+    if (index < 0 || index >= count) return;
+    if (!symbol->initValues) symbol->initValues = calloc(count, sizeof(char*));
+    free(symbol->initValues[index]);
+    symbol->initValues[index] = strdup(value);
+}
+
+// Get the static initial value of a variable or array element, NULL if it keeps the default
+const char* getInitValue(Symbol* symbol, int index) {
+    if (!symbol->initValues) return NULL;
+    if (index < 0 || index >= (symbol->isArray ? symbol->arrSize : 1)) return NULL;
+    return symbol->initValues[index];
+}
+
 //Add a parameter to a function symbol
 //  Now that I'm writing this, I don't like that repeatedly calling this method is 
 //  O(n^2) time. Should probably just handle parameters when a func symbol is declared,
@@ -180,6 +202,8 @@ void addParameter(Symbol* symbol, const char* name, VarType type) {
     newParam->name = strdup(name);  //Name duplication might be unnecessary (source ASTNode won't be freed until program ends)
                                     //...However, I'm not taking chances.
     newParam->type = type;
+    newParam->argRegister = NULL;
+    newParam->stackOffset = 0;
     newParam->next = NULL;
     printf("newParam->name: %s\n",newParam->name);
     printf("newParam->type: %s\n",varTypeToString(newParam->type));
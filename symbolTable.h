@@ -17,6 +17,10 @@ typedef struct Symbol {
     bool isArray; //If false, array fields are ignored
     int arrSize; //Length of array. Note: arrays are one-dimensional
 
+    //Static initial value of each element (a single one for scalars) as TAC constant
+    //text, set by the optimizer. NULL, or a NULL entry, keeps the default.
+    char** initValues;
+
     //Parameter fields, ignored for non-function symbols
     struct FuncParam* params;
 } Symbol;
@@ -26,6 +30,11 @@ typedef struct Symbol {
 typedef struct FuncParam {
     char* name;
     VarType type;
+
+    //Calling convention fields, assigned by assignArgLocations() in the code generator
+    const char* argRegister;    //Register the argument is passed in (e.g. "$a0", "$f12"), NULL if passed on the stack
+    int stackOffset;            //Offset of the argument in the caller's outgoing argument area (stack arguments only)
+
     struct FuncParam* prev; //Arguments are popped from the stack in reverse order,
                             //2-way linked list simplifies assignment of args to param vars
     struct FuncParam* next;
@@ -49,6 +58,8 @@ void addParameter(Symbol* symbol, const char* name, VarType type);
 Symbol* lookupSymbol(SymbolTable* symTab, const char* varName);
 Symbol* lookupSymbolInCurrentScope(SymbolTable* symTab, const char* varName);
 FuncParam* getParamsTail(Symbol* symbol);
+void setInitValue(Symbol* symbol, int index, const char* value);
+const char* getInitValue(Symbol* symbol, int index);
 void printSymbolTable(SymbolTable* symTab);
 
 char* getMipsVarName(char* varName, char* functionName);
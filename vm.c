@@ -0,0 +1,930 @@
+// vm.c
+#include "vm.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Bytecode file header; the code and the memory image follow it. Words are stored
+// in the byte order of the machine that wrote them.
+#define VM_MAGIC "CMMB"
+#define VM_VERSION 1
+
+typedef struct VMFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t codeLength;
+    uint32_t memorySize;
+} VMFileHeader;
+
+// Deepest recursion a program can reach
+#define VM_MAX_CALL_DEPTH (1 << 20)
+
+// Buckets of the table mapping variable and temp names to their cells
+#define VM_CELL_BUCKETS 4096
+
+// Operands of each opcode, one character each:
+//  w = 4-byte cell, b = 1-byte cell, A/B = array of 4-byte/1-byte elements (its length
+//  is the n that follows), n = array length, i = immediate, s = string, p = code position
+static const char* operandKinds[VM_OPCODE_COUNT] = {
+    [VM_HALT] = "",
+    [VM_CONST] = "wi",
+    [VM_CONST_BYTE] = "bi",
+    [VM_MOVE] = "ww",
+    [VM_MOVE_BYTE] = "bb",
+    [VM_LOAD_INDEX] = "wAwn",
+    [VM_LOAD_INDEX_BYTE] = "bBwn",
+    [VM_STORE_INDEX] = "Awwn",
+    [VM_STORE_INDEX_BYTE] = "Bbwn",
+    [VM_ADD] = "www",
+    [VM_SUB] = "www",
+    [VM_MUL] = "www",
+    [VM_DIV] = "www",
+    [VM_FADD] = "www",
+    [VM_FSUB] = "www",
+    [VM_FMUL] = "www",
+    [VM_FDIV] = "www",
+    [VM_INT_TO_FLOAT] = "ww",
+    [VM_FLOAT_TO_INT] = "ww",
+    [VM_WRITE_INT] = "w",
+    [VM_WRITE_FLOAT] = "w",
+    [VM_WRITE_CHAR] = "b",
+    [VM_WRITE_STRING] = "s",
+    [VM_CALL] = "p",
+    [VM_JUMP] = "p",
+    [VM_RETURN] = "",
+    [VM_MOVE2] = "wwww",
+    [VM_ADD_MOVE] = "wwww",
+    [VM_SUB_MOVE] = "wwww",
+    [VM_MUL_MOVE] = "wwww",
+    [VM_DIV_MOVE] = "wwww",
+    [VM_FADD_MOVE] = "wwww",
+    [VM_FSUB_MOVE] = "wwww",
+    [VM_FMUL_MOVE] = "wwww",
+    [VM_FDIV_MOVE] = "wwww",
+};
+
+uint32_t vmInstrLength(VMOpcode op) {
+    return 1 + (uint32_t)strlen(operandKinds[op]);
+}
+
+/* ---------------------------------------------------------------- lowering */
+
+// Variable, parameter or temp and where it lives in the memory image
+typedef struct VMCell {
+    const char* name;
+    uint32_t offset;
+    VarType type;
+    uint32_t length;    //Elements, 1 for scalars
+    bool ownsName;      //Temp names are made here, variable names belong to the symbol table
+    struct VMCell* next;
+} VMCell;
+
+// Instruction while a TAC list is lowered, before it is encoded into words
+typedef struct VMInstr {
+    VMOpcode op;
+    uint32_t operands[4];
+    FuncTAC* callee;    //VM_CALL and VM_JUMP target
+} VMInstr;
+
+// A call or jump word waiting for its callee's address
+typedef struct VMFixup {
+    uint32_t position;
+    FuncTAC* callee;
+} VMFixup;
+
+typedef struct VMCompiler {
+    VMCell* cells[VM_CELL_BUCKETS];
+    uint8_t* memory;
+    uint32_t memorySize;
+    uint32_t memoryCapacity;
+    uint32_t returnCell;
+    uint32_t* argCells;     //Cell of each pending argument, by position
+    int argCellCount;
+
+    VMInstr* instrs;        //Instructions of the list being lowered
+    int instrCount;
+    int instrCapacity;
+
+    uint32_t* code;
+    uint32_t codeLength;
+    uint32_t codeCapacity;
+    VMFixup* fixups;
+    int fixupCount;
+    FuncTAC** entryFuncs;   //Word each function starts at
+    uint32_t* entries;
+    int entryCount;
+    int fusedCount;
+} VMCompiler;
+
+static unsigned int cellHash(const char* name) {
+    unsigned int hash = 0;
+    while (*name) hash = hash * 31 + (unsigned char)*name++;
+    return hash % VM_CELL_BUCKETS;
+}
+
+static VMCell* findCell(VMCompiler* compiler, const char* name) {
+    for (VMCell* cell = compiler->cells[cellHash(name)]; cell; cell = cell->next) {
+        if (strcmp(cell->name, name) == 0) return cell;
+    }
+    return NULL;
+}
+
+// Reserve `size` bytes of zeroed memory at a multiple of `align`
+static uint32_t allocateMemory(VMCompiler* compiler, uint32_t size, uint32_t align) {
+    uint32_t offset = (compiler->memorySize + align - 1) & ~(align - 1);
+    if (offset + size > compiler->memoryCapacity) {
+        while (offset + size > compiler->memoryCapacity) {
+            compiler->memoryCapacity = compiler->memoryCapacity ? compiler->memoryCapacity * 2 : 4096;
+        }
+        compiler->memory = realloc(compiler->memory, compiler->memoryCapacity);
+    }
+    memset(compiler->memory + compiler->memorySize, 0, offset + size - compiler->memorySize);
+    compiler->memorySize = offset + size;
+    return offset;
+}
+
+static VMCell* addCell(VMCompiler* compiler, const char* name, VarType type, uint32_t length, bool isArray) {
+    // Written whole by write.charArray, so char arrays end with a newline and NUL
+    uint32_t size = (type == VarType_Char) ? length : 4 * length;
+    if (type == VarType_Char && isArray) size += 2;
+    VMCell* cell = malloc(sizeof(VMCell));
+    cell->name = name;
+    cell->ownsName = false;
+    cell->offset = allocateMemory(compiler, size, (type == VarType_Char) ? 1 : 4);
+    cell->type = type;
+    cell->length = length;
+    unsigned int bucket = cellHash(name);
+    cell->next = compiler->cells[bucket];
+    compiler->cells[bucket] = cell;
+    return cell;
+}
+
+static void storeWord(uint8_t* memory, uint32_t offset, uint32_t value) {
+    memcpy(memory + offset, &value, sizeof(value));
+}
+
+// Word holding a TAC constant of the given type
+static uint32_t constantBits(const char* text, VarType type) {
+    if (type == VarType_Float) {
+        float value = strtof(text, NULL);
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+    if (type == VarType_Char) return (unsigned char)text[0];
+    return (uint32_t)atoi(text);
+}
+
+// Lay out every variable and temp, zeroed (chars as 'U') unless the optimizer gave
+// them a static initial value
+static void layoutCells(VMCompiler* compiler, SymbolTable* table) {
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        for (Symbol* current = table->table[i]; current; current = current->next) {
+            if (current->type != VarType_Int && current->type != VarType_Float && current->type != VarType_Char) continue;
+            uint32_t length = current->isArray ? current->arrSize : 1;
+            VMCell* cell = addCell(compiler, current->name, current->type, length, current->isArray);
+            for (uint32_t j = 0; j < length; j++) {
+                const char* initValue = getInitValue(current, j);
+                if (current->type == VarType_Char) {
+                    compiler->memory[cell->offset + j] = initValue ? (uint8_t)initValue[0] : 'U';
+                } else if (initValue) {
+                    storeWord(compiler->memory, cell->offset + 4 * j, constantBits(initValue, current->type));
+                }
+            }
+            if (current->type == VarType_Char && current->isArray) compiler->memory[cell->offset + length] = '\n';
+        }
+    }
+
+    // Temps are named like "i3"
+    const char kinds[3] = { 'i', 'f', 'c' };
+    const VarType types[3] = { VarType_Int, VarType_Float, VarType_Char };
+    int counts[3] = { getTempIntCount(), getTempFloatCount(), getTempCharCount() };
+    for (int kind = 0; kind < 3; kind++) {
+        for (int i = 0; i < counts[kind]; i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "%c%d", kinds[kind], i);
+            addCell(compiler, strdup(name), types[kind], 1, false)->ownsName = true;
+        }
+    }
+    compiler->returnCell = allocateMemory(compiler, 4, 4);
+}
+
+static void freeCells(VMCompiler* compiler) {
+    for (int i = 0; i < VM_CELL_BUCKETS; i++) {
+        VMCell* cell = compiler->cells[i];
+        while (cell) {
+            VMCell* next = cell->next;
+            if (cell->ownsName) free((char*)cell->name);
+            free(cell);
+            cell = next;
+        }
+    }
+}
+
+// Cell of an operand, NULL (with a message) if the program has no such variable
+static VMCell* operandCell(VMCompiler* compiler, const char* name) {
+    VMCell* cell = name ? findCell(compiler, name) : NULL;
+    if (!cell) fprintf(stderr, "VM: Unknown variable %s\n", name ? name : "(none)");
+    return cell;
+}
+
+// Copy a write.string literal into memory, undoing its .asciiz escapes
+static uint32_t addString(VMCompiler* compiler, const char* literal) {
+    uint32_t offset = allocateMemory(compiler, (uint32_t)strlen(literal) + 1, 1);
+    uint8_t* text = compiler->memory + offset;
+    for (const char* c = literal; *c; c++) {
+        if (*c == '\\' && c[1]) {
+            c++;
+            *text++ = (*c == 'n') ? '\n' : (*c == 't') ? '\t' : *c;
+        } else {
+            *text++ = *c;
+        }
+    }
+    *text = '\0';
+    return offset;
+}
+
+// Cell of the pending argument at `position`
+static uint32_t argCell(VMCompiler* compiler, int position) {
+    while (compiler->argCellCount <= position) {
+        compiler->argCells = realloc(compiler->argCells, (compiler->argCellCount + 1) * sizeof(uint32_t));
+        compiler->argCells[compiler->argCellCount++] = allocateMemory(compiler, 4, 4);
+    }
+    return compiler->argCells[position];
+}
+
+static void addInstr(VMCompiler* compiler, VMOpcode op, uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    if (compiler->instrCount == compiler->instrCapacity) {
+        compiler->instrCapacity = compiler->instrCapacity ? compiler->instrCapacity * 2 : 256;
+        compiler->instrs = realloc(compiler->instrs, compiler->instrCapacity * sizeof(VMInstr));
+    }
+    VMInstr* instr = &compiler->instrs[compiler->instrCount++];
+    instr->op = op;
+    instr->operands[0] = a;
+    instr->operands[1] = b;
+    instr->operands[2] = c;
+    instr->operands[3] = d;
+    instr->callee = NULL;
+}
+
+static VarType vmOpType(const char* suffix) {
+    if (strncmp(suffix, "float", 5) == 0) return VarType_Float;
+    if (strncmp(suffix, "char", 4) == 0) return VarType_Char;
+    return VarType_Int;
+}
+
+static VMOpcode moveOp(VarType type) {
+    return (type == VarType_Char) ? VM_MOVE_BYTE : VM_MOVE;
+}
+
+static VMOpcode arithmeticOp(char operator, VarType type) {
+    static const VMOpcode intOps[4] = { VM_ADD, VM_SUB, VM_MUL, VM_DIV };
+    static const VMOpcode floatOps[4] = { VM_FADD, VM_FSUB, VM_FMUL, VM_FDIV };
+    int index = (operator == '+') ? 0 : (operator == '-') ? 1 : (operator == '*') ? 2 : 3;
+    return (type == VarType_Float) ? floatOps[index] : intOps[index];
+}
+
+// Pending arguments are copied into the callee's parameters when the call is made
+static bool addCall(VMCompiler* compiler, VMOpcode op, TAC* call, TAC** pendingArgs, int* pendingArgCount) {
+    for (int i = 0; i < *pendingArgCount; i++) {
+        VMCell* param = operandCell(compiler, pendingArgs[i]->result);
+        if (!param) return false;
+        addInstr(compiler, moveOp(param->type), param->offset, argCell(compiler, i), 0, 0);
+    }
+    *pendingArgCount = 0;
+
+    FuncTAC* callee = findFuncTAC(call->arg1);
+    if (!callee) {
+        fprintf(stderr, "VM: Unknown function %s\n", call->arg1);
+        return false;
+    }
+    addInstr(compiler, op, 0, 0, 0, 0);
+    compiler->instrs[compiler->instrCount - 1].callee = callee;
+    if (op == VM_CALL && call->result && callee->returnType != VarType_Void) {
+        VMCell* result = operandCell(compiler, call->result);
+        if (!result) return false;
+        addInstr(compiler, moveOp(result->type), result->offset, compiler->returnCell, 0, 0);
+    }
+    return true;
+}
+
+// Lower one TAC list, main's or a function's, into compiler->instrs
+static bool lowerList(VMCompiler* compiler, TAC* current, bool isMain) {
+    TAC* pendingArgs[64];
+    int pendingArgCount = 0;
+    compiler->instrCount = 0;
+
+    for (; current; current = current->next) {
+        const char* op = current->op;
+        VMCell *result = NULL, *arg1 = NULL, *arg2 = NULL;
+        if (strcmp(op, "funcStart") == 0 || strcmp(op, "reserveArgs") == 0) {
+            // Nothing to set up, arguments have their own cells
+        } else if (strcmp(op, "return") == 0) {
+            addInstr(compiler, isMain ? VM_HALT : VM_RETURN, 0, 0, 0, 0);
+        } else if (strncmp(op, "assign.", 7) == 0) {
+            VarType type = vmOpType(op + 7);
+            if (!(result = operandCell(compiler, current->result))) return false;
+            addInstr(compiler, (type == VarType_Char) ? VM_CONST_BYTE : VM_CONST, result->offset, constantBits(current->arg1, type), 0, 0);
+        } else if ((strncmp(op, "load.", 5) == 0 || strncmp(op, "store.", 6) == 0) && strstr(op, "Index")) {
+            // load: result = arg1[arg2], store: result[arg2] = arg1
+            bool isLoad = (op[0] == 'l');
+            VarType type = vmOpType(op + (isLoad ? 5 : 6));
+            if (!(result = operandCell(compiler, current->result)) || !(arg1 = operandCell(compiler, current->arg1)) ||
+                !(arg2 = operandCell(compiler, current->arg2))) return false;
+            VMCell* array = isLoad ? arg1 : result;
+            VMOpcode opcode = isLoad ? ((type == VarType_Char) ? VM_LOAD_INDEX_BYTE : VM_LOAD_INDEX)
+                                     : ((type == VarType_Char) ? VM_STORE_INDEX_BYTE : VM_STORE_INDEX);
+            addInstr(compiler, opcode, result->offset, arg1->offset, arg2->offset, array->length);
+        } else if (strncmp(op, "load.", 5) == 0 || strncmp(op, "store.", 6) == 0) {
+            if (!(result = operandCell(compiler, current->result)) || !(arg1 = operandCell(compiler, current->arg1))) return false;
+            addInstr(compiler, moveOp(result->type), result->offset, arg1->offset, 0, 0);
+        } else if (op[0] && op[1] == '.' && strchr("+-*/", op[0])) {
+            if (!(result = operandCell(compiler, current->result)) || !(arg1 = operandCell(compiler, current->arg1)) ||
+                !(arg2 = operandCell(compiler, current->arg2))) return false;
+            addInstr(compiler, arithmeticOp(op[0], vmOpType(op + 2)), result->offset, arg1->offset, arg2->offset, 0);
+        } else if (strcmp(op, "intToFloat") == 0 || strcmp(op, "floatToInt") == 0) {
+            if (!(result = operandCell(compiler, current->result)) || !(arg1 = operandCell(compiler, current->arg1))) return false;
+            addInstr(compiler, (op[0] == 'i') ? VM_INT_TO_FLOAT : VM_FLOAT_TO_INT, result->offset, arg1->offset, 0, 0);
+        } else if (strcmp(op, "write.string") == 0) {
+            addInstr(compiler, VM_WRITE_STRING, addString(compiler, current->arg1), 0, 0, 0);
+        } else if (strncmp(op, "write.", 6) == 0) {
+            if (!(arg1 = operandCell(compiler, current->arg1))) return false;
+            const char* suffix = op + 6;
+            VMOpcode opcode = (strcmp(suffix, "charArray") == 0) ? VM_WRITE_STRING
+                            : (strcmp(suffix, "float") == 0) ? VM_WRITE_FLOAT
+                            : (strcmp(suffix, "char") == 0) ? VM_WRITE_CHAR : VM_WRITE_INT;
+            addInstr(compiler, opcode, arg1->offset, 0, 0, 0);
+        } else if (strncmp(op, "arg.", 4) == 0) {
+            // The value is kept until the call, which copies it into the parameter
+            if (pendingArgCount == 64) {
+                fprintf(stderr, "VM: More than 64 pending arguments\n");
+                return false;
+            }
+            if (!(arg1 = operandCell(compiler, current->arg1))) return false;
+            addInstr(compiler, moveOp(vmOpType(op + 4)), argCell(compiler, pendingArgCount), arg1->offset, 0, 0);
+            pendingArgs[pendingArgCount++] = current;
+        } else if (strcmp(op, "functionCall") == 0) {
+            if (!addCall(compiler, VM_CALL, current, pendingArgs, &pendingArgCount)) return false;
+        } else if (strcmp(op, "tailCall") == 0) {
+            // The callee returns straight to our caller, leaving its value in the return cell
+            if (!addCall(compiler, VM_JUMP, current, pendingArgs, &pendingArgCount)) return false;
+        } else if (strncmp(op, "setReturn.", 10) == 0) {
+            if (!(arg1 = operandCell(compiler, current->arg1))) return false;
+            addInstr(compiler, moveOp(vmOpType(op + 10)), compiler->returnCell, arg1->offset, 0, 0);
+        } else {
+            fprintf(stderr, "VM: Unsupported TAC op %s\n", op);
+            return false;
+        }
+    }
+    addInstr(compiler, isMain ? VM_HALT : VM_RETURN, 0, 0, 0, 0);
+    return true;
+}
+
+// Combine the most common pairs into superinstructions: two 4-byte moves (the loads
+// of an operation's operands), and an operation followed by a move of its result
+// (storing it to a variable). Lists have no jumps into them, so any neighbours can be fused.
+static void fuseInstrs(VMCompiler* compiler) {
+    int count = 0;
+    for (int i = 0; i < compiler->instrCount; i++) {
+        VMInstr* instr = &compiler->instrs[i];
+        VMInstr* next = (i + 1 < compiler->instrCount) ? &compiler->instrs[i + 1] : NULL;
+        if (next && next->op == VM_MOVE && instr->op >= VM_ADD && instr->op <= VM_FDIV && next->operands[1] == instr->operands[0]) {
+            instr->op = VM_ADD_MOVE + (instr->op - VM_ADD);
+            instr->operands[3] = next->operands[0];
+            i++;
+            compiler->fusedCount++;
+        } else if (next && instr->op == VM_MOVE && next->op == VM_MOVE) {
+            instr->op = VM_MOVE2;
+            instr->operands[2] = next->operands[0];
+            instr->operands[3] = next->operands[1];
+            i++;
+            compiler->fusedCount++;
+        }
+        compiler->instrs[count++] = *instr;
+    }
+    compiler->instrCount = count;
+}
+
+static void emitWord(VMCompiler* compiler, uint32_t word) {
+    if (compiler->codeLength == compiler->codeCapacity) {
+        compiler->codeCapacity = compiler->codeCapacity ? compiler->codeCapacity * 2 : 1024;
+        compiler->code = realloc(compiler->code, compiler->codeCapacity * sizeof(uint32_t));
+    }
+    compiler->code[compiler->codeLength++] = word;
+}
+
+static void encodeInstrs(VMCompiler* compiler) {
+    for (int i = 0; i < compiler->instrCount; i++) {
+        VMInstr* instr = &compiler->instrs[i];
+        emitWord(compiler, instr->op);
+        if (instr->callee) {
+            compiler->fixups = realloc(compiler->fixups, (compiler->fixupCount + 1) * sizeof(VMFixup));
+            compiler->fixups[compiler->fixupCount++] = (VMFixup){ compiler->codeLength, instr->callee };
+        }
+        for (uint32_t j = 0; j + 1 < vmInstrLength(instr->op); j++) emitWord(compiler, instr->operands[j]);
+    }
+}
+
+static bool lowerFunction(VMCompiler* compiler, TAC* head, FuncTAC* func) {
+    if (func) {
+        compiler->entryFuncs = realloc(compiler->entryFuncs, (compiler->entryCount + 1) * sizeof(FuncTAC*));
+        compiler->entries = realloc(compiler->entries, (compiler->entryCount + 1) * sizeof(uint32_t));
+        compiler->entryFuncs[compiler->entryCount] = func;
+        compiler->entries[compiler->entryCount++] = compiler->codeLength;
+    }
+    if (!lowerList(compiler, head, func == NULL)) return false;
+    fuseInstrs(compiler);
+    encodeInstrs(compiler);
+    return true;
+}
+
+static bool resolveFixups(VMCompiler* compiler) {
+    for (int i = 0; i < compiler->fixupCount; i++) {
+        int entry = 0;
+        while (entry < compiler->entryCount && compiler->entryFuncs[entry] != compiler->fixups[i].callee) entry++;
+        if (entry == compiler->entryCount) {
+            fprintf(stderr, "VM: Function %s has no code\n", compiler->fixups[i].callee->funcName);
+            return false;
+        }
+        compiler->code[compiler->fixups[i].position] = compiler->entries[entry];
+    }
+    return true;
+}
+
+bool compileVMProgram(TAC* tacInstructions, SymbolTable* table, VMProgram* program) {
+    VMCompiler compiler;
+    memset(&compiler, 0, sizeof(compiler));
+    memset(program, 0, sizeof(*program));
+    layoutCells(&compiler, table);
+
+    bool success = lowerFunction(&compiler, tacInstructions, NULL);
+    for (FuncTAC* func = funcTacHeads; success && func; func = func->nextFunc) {
+        success = lowerFunction(&compiler, func->func, func);
+    }
+    success = success && resolveFixups(&compiler);
+
+    // Strings always find a NUL before the end of memory, see verifyVMProgram()
+    allocateMemory(&compiler, 1, 1);
+
+    if (success) {
+        program->code = compiler.code;
+        program->codeLength = compiler.codeLength;
+        program->memory = compiler.memory;
+        program->memorySize = compiler.memorySize;
+        printf("VM: %u words of code (%d superinstructions), %u bytes of memory\n",
+               compiler.codeLength, compiler.fusedCount, compiler.memorySize);
+    } else {
+        free(compiler.code);
+        free(compiler.memory);
+    }
+    freeCells(&compiler);
+    free(compiler.argCells);
+    free(compiler.instrs);
+    free(compiler.fixups);
+    free(compiler.entryFuncs);
+    free(compiler.entries);
+    return success;
+}
+
+/* ---------------------------------------------------------------- files */
+
+bool saveVMProgram(const VMProgram* program, const char* path) {
+    OutputWriter writer;
+    if (!openOutputWriter(&writer, path)) {
+        perror("Failed to open bytecode file");
+        return false;
+    }
+    VMFileHeader header;
+    memcpy(header.magic, VM_MAGIC, 4);
+    header.version = VM_VERSION;
+    header.codeLength = program->codeLength;
+    header.memorySize = program->memorySize;
+    writerWrite(&writer, (const char*)&header, sizeof(header));
+    writerWrite(&writer, (const char*)program->code, program->codeLength * sizeof(uint32_t));
+    writerWrite(&writer, (const char*)program->memory, program->memorySize);
+    closeOutputWriter(&writer);
+    return true;
+}
+
+bool isVMProgramFile(const char* path) {
+    char magic[4];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    bool isProgram = read(fd, magic, sizeof(magic)) == sizeof(magic) && memcmp(magic, VM_MAGIC, 4) == 0;
+    close(fd);
+    return isProgram;
+}
+
+// Check that every instruction is valid and every operand inside memory, so a
+// damaged file can't make the VM touch anything else
+//  Strings are read up to a NUL, so memory must end in one and no cell operand may
+//  reach that last byte, or the program could overwrite it.
+static bool verifyVMProgram(const VMProgram* program) {
+    if (program->memorySize == 0 || program->memory[program->memorySize - 1] != '\0') return false;
+    uint64_t cellsEnd = program->memorySize - 1;
+
+    // Where instructions start, for checking call and jump targets
+    uint8_t* starts = calloc(program->codeLength + 1, 1);
+    bool valid = (program->codeLength > 0);
+    uint32_t pc = 0, last = 0;
+    while (valid && pc < program->codeLength) {
+        uint32_t op = program->code[pc];
+        if (op >= VM_OPCODE_COUNT || pc + vmInstrLength(op) > program->codeLength) {
+            valid = false;
+            break;
+        }
+        starts[pc] = 1;
+        last = op;
+        pc += vmInstrLength(op);
+    }
+    // Execution must not run off the end of the code
+    if (valid && last != VM_HALT && last != VM_RETURN && last != VM_JUMP) valid = false;
+
+    for (pc = 0; valid && pc < program->codeLength; pc += vmInstrLength(program->code[pc])) {
+        const char* kinds = operandKinds[program->code[pc]];
+        const uint32_t* operands = program->code + pc + 1;
+        for (int i = 0; valid && kinds[i]; i++) {
+            uint64_t operand = operands[i];
+            switch (kinds[i]) {
+                case 'w': valid = operand + 4 <= cellsEnd; break;
+                case 'b': valid = operand < cellsEnd; break;
+                case 's': valid = operand < program->memorySize; break;
+                case 'A': valid = operand + 4 * (uint64_t)operands[strchr(kinds, 'n') - kinds] <= cellsEnd; break;
+                case 'B': valid = operand + (uint64_t)operands[strchr(kinds, 'n') - kinds] <= cellsEnd; break;
+                case 'p': valid = operand < program->codeLength && starts[operand]; break;
+                default: break;
+            }
+        }
+    }
+    free(starts);
+    return valid;
+}
+
+bool loadVMProgram(const char* path, VMProgram* program) {
+    memset(program, 0, sizeof(*program));
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0) {
+        perror("Failed to open bytecode file");
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    if ((size_t)info.st_size < sizeof(VMFileHeader)) {
+        fprintf(stderr, "VM: %s is not a bytecode file\n", path);
+        close(fd);
+        return false;
+    }
+
+    // Private mapping: the program writes to its memory image without changing the file
+    void* mapping = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Failed to map bytecode file");
+        return false;
+    }
+    program->mapping = mapping;
+    program->mappingSize = info.st_size;
+
+    VMFileHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    uint64_t expectedSize = sizeof(header) + (uint64_t)header.codeLength * sizeof(uint32_t) + header.memorySize;
+    if (memcmp(header.magic, VM_MAGIC, 4) != 0 || header.version != VM_VERSION || expectedSize != (uint64_t)info.st_size) {
+        fprintf(stderr, "VM: %s is not a bytecode file of this version\n", path);
+        freeVMProgram(program);
+        return false;
+    }
+    program->code = (uint32_t*)((char*)mapping + sizeof(header));
+    program->codeLength = header.codeLength;
+    program->memory = (uint8_t*)(program->code + header.codeLength);
+    program->memorySize = header.memorySize;
+
+    if (!verifyVMProgram(program)) {
+        fprintf(stderr, "VM: %s is damaged\n", path);
+        freeVMProgram(program);
+        return false;
+    }
+    return true;
+}
+
+void freeVMProgram(VMProgram* program) {
+    if (program->mapping) {
+        munmap(program->mapping, program->mappingSize);
+    } else {
+        free(program->code);
+        free(program->memory);
+    }
+    memset(program, 0, sizeof(*program));
+}
+
+/* ---------------------------------------------------------------- execution */
+
+// Threaded code: each opcode is replaced by its handler's address and each call or
+// jump target by the slot it refers to
+typedef union VMSlot {
+    const void* handler;
+    uint32_t operand;
+    union VMSlot* target;
+} VMSlot;
+
+// Cells are accessed through memcpy(), which compiles to plain loads and stores
+static inline int32_t getInt(const uint8_t* memory, uint32_t offset) {
+    int32_t value;
+    memcpy(&value, memory + offset, sizeof(value));
+    return value;
+}
+
+static inline void setInt(uint8_t* memory, uint32_t offset, int32_t value) {
+    memcpy(memory + offset, &value, sizeof(value));
+}
+
+static inline float getFloat(const uint8_t* memory, uint32_t offset) {
+    float value;
+    memcpy(&value, memory + offset, sizeof(value));
+    return value;
+}
+
+static inline void setFloat(uint8_t* memory, uint32_t offset, float value) {
+    memcpy(memory + offset, &value, sizeof(value));
+}
+
+// Most a single int/char/float write (sign, digits, point, newline) can add
+#define VM_MAX_VALUE_LENGTH 32
+
+// Digits of a value taken as -|value|, so INT_MIN needs no special case
+static int formatDigits(char* text, int negated) {
+    char digits[12];
+    int count = 0, length = 0;
+    do {
+        digits[count++] = (char)('0' - negated % 10);
+        negated /= 10;
+    } while (negated != 0);
+    while (count > 0) text[length++] = digits[--count];
+    return length;
+}
+
+void vmWriteInt(OutputWriter* writer, int32_t value) {
+    char text[VM_MAX_VALUE_LENGTH];
+    int length = 0;
+    if (value < 0) text[length++] = '-';
+    length += formatDigits(text + length, (value < 0) ? value : -value);
+    text[length++] = '\n';
+    writerWrite(writer, text, length);
+}
+
+// Up to six fraction digits, without trailing zeros but with at least one ("2.5", "3.0")
+//  Values of 2^31 and above (and inf/NaN) are printed with %g instead.
+void vmWriteFloat(OutputWriter* writer, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7fffffff) >= 0x4f000000) {
+        writerPrintf(writer, "%g\n", value);
+        return;
+    }
+
+    char text[VM_MAX_VALUE_LENGTH];
+    int length = 0;
+    if (bits & 0x80000000) {
+        text[length++] = '-';
+        value = -value;
+    }
+    int whole = (int)value;
+    // One float operation per statement, rounding after each step like the MIPS runtime
+    float scaled = (value - (float)whole);
+    scaled = scaled * 1000000.0f;
+    scaled = scaled + 0.5f;
+    int fraction = (int)scaled;
+    if (fraction >= 1000000) {
+        whole++;
+        fraction = 0;
+    }
+    length += formatDigits(text + length, -whole);
+    text[length++] = '.';
+    for (int divisor = 100000; divisor > 0; divisor /= 10) {
+        text[length++] = (char)('0' + fraction / divisor);
+        fraction %= divisor;
+        if (fraction == 0) break;
+    }
+    text[length++] = '\n';
+    writerWrite(writer, text, length);
+}
+
+// Truncating conversion, giving INT_MIN like cvttss2si for values an int can't hold
+static inline int32_t truncateFloat(float value) {
+    if (value > -2147483649.0f && value < 2147483648.0f) return (int32_t)value;
+    return INT32_MIN;
+}
+
+static inline int32_t divideInts(int32_t a, int32_t b) {
+    return (b == -1) ? (int32_t)(0u - (uint32_t)a) : a / b;
+}
+
+bool runVMProgram(VMProgram* program) {
+    static const void* handlers[VM_OPCODE_COUNT] = {
+        [VM_HALT] = &&op_HALT,
+        [VM_CONST] = &&op_CONST,
+        [VM_CONST_BYTE] = &&op_CONST_BYTE,
+        [VM_MOVE] = &&op_MOVE,
+        [VM_MOVE_BYTE] = &&op_MOVE_BYTE,
+        [VM_LOAD_INDEX] = &&op_LOAD_INDEX,
+        [VM_LOAD_INDEX_BYTE] = &&op_LOAD_INDEX_BYTE,
+        [VM_STORE_INDEX] = &&op_STORE_INDEX,
+        [VM_STORE_INDEX_BYTE] = &&op_STORE_INDEX_BYTE,
+        [VM_ADD] = &&op_ADD,
+        [VM_SUB] = &&op_SUB,
+        [VM_MUL] = &&op_MUL,
+        [VM_DIV] = &&op_DIV,
+        [VM_FADD] = &&op_FADD,
+        [VM_FSUB] = &&op_FSUB,
+        [VM_FMUL] = &&op_FMUL,
+        [VM_FDIV] = &&op_FDIV,
+        [VM_INT_TO_FLOAT] = &&op_INT_TO_FLOAT,
+        [VM_FLOAT_TO_INT] = &&op_FLOAT_TO_INT,
+        [VM_WRITE_INT] = &&op_WRITE_INT,
+        [VM_WRITE_FLOAT] = &&op_WRITE_FLOAT,
+        [VM_WRITE_CHAR] = &&op_WRITE_CHAR,
+        [VM_WRITE_STRING] = &&op_WRITE_STRING,
+        [VM_CALL] = &&op_CALL,
+        [VM_JUMP] = &&op_JUMP,
+        [VM_RETURN] = &&op_RETURN,
+        [VM_MOVE2] = &&op_MOVE2,
+        [VM_ADD_MOVE] = &&op_ADD_MOVE,
+        [VM_SUB_MOVE] = &&op_SUB_MOVE,
+        [VM_MUL_MOVE] = &&op_MUL_MOVE,
+        [VM_DIV_MOVE] = &&op_DIV_MOVE,
+        [VM_FADD_MOVE] = &&op_FADD_MOVE,
+        [VM_FSUB_MOVE] = &&op_FSUB_MOVE,
+        [VM_FMUL_MOVE] = &&op_FMUL_MOVE,
+        [VM_FDIV_MOVE] = &&op_FDIV_MOVE,
+    };
+
+    VMSlot* threaded = malloc((program->codeLength + 1) * sizeof(VMSlot));
+    for (uint32_t pc = 0; pc < program->codeLength; pc += vmInstrLength(program->code[pc])) {
+        VMOpcode op = program->code[pc];
+        threaded[pc].handler = handlers[op];
+        for (uint32_t i = 1; i < vmInstrLength(op); i++) threaded[pc + i].operand = program->code[pc + i];
+        if (op == VM_CALL || op == VM_JUMP) threaded[pc + 1].target = &threaded[program->code[pc + 1]];
+    }
+    // Nothing verified ever reaches it, but running past the end stops rather than jumping anywhere
+    threaded[program->codeLength].handler = &&op_HALT;
+
+    // Progress messages go out before the program's output
+    fflush(stdout);
+    OutputWriter writer;
+    if (!openOutputWriter(&writer, "-")) {
+        perror("Failed to open standard output");
+        free(threaded);
+        return false;
+    }
+
+    VMSlot** callStack = malloc(VM_MAX_CALL_DEPTH * sizeof(VMSlot*));
+    int depth = 0;
+    uint8_t* memory = program->memory;
+    const char* error = NULL;
+    VMSlot* pc = threaded;
+    int32_t result;
+
+#define A (pc[1].operand)
+#define B (pc[2].operand)
+#define C (pc[3].operand)
+#define D (pc[4].operand)
+#define NEXT(length) do { pc += (length); goto *pc->handler; } while (0)
+#define INT_OP(name, expr) op_##name: setInt(memory, A, (int32_t)(expr)); NEXT(4); \
+    op_##name##_MOVE: setInt(memory, A, (int32_t)(expr)); setInt(memory, D, getInt(memory, A)); NEXT(5);
+#define CHECKED_INT_OP(name, builtin) \
+    op_##name: if (builtin(getInt(memory, B), getInt(memory, C), &result)) goto overflowError; \
+        setInt(memory, A, result); NEXT(4); \
+    op_##name##_MOVE: if (builtin(getInt(memory, B), getInt(memory, C), &result)) goto overflowError; \
+        setInt(memory, A, result); setInt(memory, D, result); NEXT(5);
+#define FLOAT_OP(name, operator) op_##name: setFloat(memory, A, getFloat(memory, B) operator getFloat(memory, C)); NEXT(4); \
+    op_##name##_MOVE: setFloat(memory, A, getFloat(memory, B) operator getFloat(memory, C)); setInt(memory, D, getInt(memory, A)); NEXT(5);
+
+    goto *pc->handler;
+
+op_CONST:
+    setInt(memory, A, (int32_t)B);
+    NEXT(3);
+op_CONST_BYTE:
+    memory[A] = (uint8_t)B;
+    NEXT(3);
+op_MOVE:
+    setInt(memory, A, getInt(memory, B));
+    NEXT(3);
+op_MOVE_BYTE:
+    memory[A] = memory[B];
+    NEXT(3);
+op_MOVE2:
+    setInt(memory, A, getInt(memory, B));
+    setInt(memory, C, getInt(memory, D));
+    NEXT(5);
+op_LOAD_INDEX: {
+    uint32_t index = (uint32_t)getInt(memory, C);
+    if (index >= D) goto indexError;
+    setInt(memory, A, getInt(memory, B + 4 * index));
+    NEXT(5);
+}
+op_LOAD_INDEX_BYTE: {
+    uint32_t index = (uint32_t)getInt(memory, C);
+    if (index >= D) goto indexError;
+    memory[A] = memory[B + index];
+    NEXT(5);
+}
+op_STORE_INDEX: {
+    uint32_t index = (uint32_t)getInt(memory, C);
+    if (index >= D) goto indexError;
+    setInt(memory, A + 4 * index, getInt(memory, B));
+    NEXT(5);
+}
+op_STORE_INDEX_BYTE: {
+    uint32_t index = (uint32_t)getInt(memory, C);
+    if (index >= D) goto indexError;
+    memory[A + index] = memory[B];
+    NEXT(5);
+}
+
+    // Addition and subtraction stop the program on overflow, like MIPS add and sub trap.
+    // Multiplication wraps around like mul, and division by zero stops the program.
+    CHECKED_INT_OP(ADD, __builtin_add_overflow)
+    CHECKED_INT_OP(SUB, __builtin_sub_overflow)
+    INT_OP(MUL, (uint32_t)getInt(memory, B) * (uint32_t)getInt(memory, C))
+op_DIV:
+    if (getInt(memory, C) == 0) goto divisionError;
+    setInt(memory, A, divideInts(getInt(memory, B), getInt(memory, C)));
+    NEXT(4);
+op_DIV_MOVE:
+    if (getInt(memory, C) == 0) goto divisionError;
+    setInt(memory, A, divideInts(getInt(memory, B), getInt(memory, C)));
+    setInt(memory, D, getInt(memory, A));
+    NEXT(5);
+    FLOAT_OP(FADD, +)
+    FLOAT_OP(FSUB, -)
+    FLOAT_OP(FMUL, *)
+    FLOAT_OP(FDIV, /)
+
+op_INT_TO_FLOAT:
+    setFloat(memory, A, (float)getInt(memory, B));
+    NEXT(3);
+op_FLOAT_TO_INT:
+    setInt(memory, A, truncateFloat(getFloat(memory, B)));
+    NEXT(3);
+
+op_WRITE_INT:
+    vmWriteInt(&writer, getInt(memory, A));
+    NEXT(2);
+op_WRITE_FLOAT:
+    vmWriteFloat(&writer, getFloat(memory, A));
+    NEXT(2);
+op_WRITE_CHAR: {
+    char text[2] = { (char)memory[A], '\n' };
+    writerWrite(&writer, text, 2);
+    NEXT(2);
+}
+op_WRITE_STRING: {
+    const char* text = (const char*)memory + A;
+    writerWrite(&writer, text, strlen(text));
+    NEXT(2);
+}
+
+op_CALL:
+    if (depth == VM_MAX_CALL_DEPTH) {
+        error = "Call stack overflow";
+        goto halt;
+    }
+    callStack[depth++] = pc + 2;
+    pc = pc[1].target;
+    goto *pc->handler;
+op_JUMP:
+    pc = pc[1].target;
+    goto *pc->handler;
+op_RETURN:
+    if (depth == 0) goto halt;
+    pc = callStack[--depth];
+    goto *pc->handler;
+
+indexError:
+    error = "Array index out of bounds";
+    goto halt;
+divisionError:
+    error = "Division by zero";
+    goto halt;
+overflowError:
+    error = "Arithmetic overflow";
+op_HALT:
+halt:
+#undef A
+#undef B
+#undef C
+#undef D
+#undef NEXT
+#undef INT_OP
+#undef CHECKED_INT_OP
+#undef FLOAT_OP
+    closeOutputWriter(&writer);
+    free(callStack);
+    free(threaded);
+    if (error) fprintf(stderr, "VM: %s\n", error);
+    return error == NULL;
+}
@@ -0,0 +1,111 @@
+#ifndef VM_H
+#define VM_H
+
+#include "semantic.h"  // For TAC and FuncTAC definitions
+#include "symbolTable.h"
+#include "commons/outputWriter.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Bytecode virtual machine, used by --run and --target=bytecode
+//  Memory follows the generated MIPS: every variable, parameter and temp is a cell at
+//  a fixed byte offset of one memory image, and instructions name their operands by
+//  offset (register-based, no operand stack). The code is a sequence of 32-bit words,
+//  an opcode followed by its operands, which is threaded into handler addresses before
+//  it runs (computed goto, so GCC or Clang is needed).
+
+// Opcodes; a = destination, b and c = sources, n = array length, d = second destination
+typedef enum VMOpcode {
+    VM_HALT,                //Stop the program
+    VM_CONST,               //a = immediate b (int or float bits)
+    VM_CONST_BYTE,          //a = immediate b (char)
+    VM_MOVE,                //a = b, a 4-byte int or float
+    VM_MOVE_BYTE,           //a = b, a char
+    VM_LOAD_INDEX,          //a = b[c], b of n ints or floats
+    VM_LOAD_INDEX_BYTE,     //a = b[c], b of n chars
+    VM_STORE_INDEX,         //a[c] = b, a of n ints or floats
+    VM_STORE_INDEX_BYTE,    //a[c] = b, a of n chars
+    VM_ADD,                 //a = b + c on ints, and so on
+    VM_SUB,
+    VM_MUL,
+    VM_DIV,
+    VM_FADD,                //a = b + c on floats, and so on
+    VM_FSUB,
+    VM_FMUL,
+    VM_FDIV,
+    VM_INT_TO_FLOAT,        //a = (float)b
+    VM_FLOAT_TO_INT,        //a = (int)b, truncating
+    VM_WRITE_INT,           //Print a and a newline
+    VM_WRITE_FLOAT,
+    VM_WRITE_CHAR,
+    VM_WRITE_STRING,        //Print the NUL-terminated bytes at a
+    VM_CALL,                //Call the code at word a
+    VM_JUMP,                //Continue at word a (tail calls)
+    VM_RETURN,              //Return to the caller
+
+    // Superinstructions for the most common pairs
+    VM_MOVE2,               //a = b; c = d, both 4-byte
+    VM_ADD_MOVE,            //a = b + c; d = a on ints, and so on
+    VM_SUB_MOVE,
+    VM_MUL_MOVE,
+    VM_DIV_MOVE,
+    VM_FADD_MOVE,           //a = b + c; d = a on floats, and so on
+    VM_FSUB_MOVE,
+    VM_FMUL_MOVE,
+    VM_FDIV_MOVE,
+
+    VM_OPCODE_COUNT
+} VMOpcode;
+
+// A program ready to run or save
+typedef struct VMProgram {
+    uint32_t* code;         //Instructions, main's first
+    uint32_t codeLength;    //Length of `code` in words
+    uint8_t* memory;        //Initial memory image: cells, then string literals
+    uint32_t memorySize;
+    void* mapping;          //File the program was loaded from (NULL if compiled), see loadVMProgram()
+    size_t mappingSize;
+} VMProgram;
+
+/**
+ * Lower the optimized TAC into bytecode.
+ *
+ * @param tacInstructions The main TAC list.
+ * @param table Symbol table holding the program's variables.
+ * @param program Receives the program.
+ * @return false (with a message on stderr) if the TAC can't be lowered.
+ */
+bool compileVMProgram(TAC* tacInstructions, SymbolTable* table, VMProgram* program);
+
+// Write a program to a bytecode file, "-" for standard output
+bool saveVMProgram(const VMProgram* program, const char* path);
+
+// Whether the file starts like a bytecode file
+bool isVMProgramFile(const char* path);
+
+/**
+ * Load a bytecode file. The file is mapped copy-on-write, so the code and the memory
+ * image are used where they are rather than read in; the program is checked so that
+ * every operand stays inside the memory image.
+ */
+bool loadVMProgram(const char* path, VMProgram* program);
+
+/**
+ * Run a program, writing its output buffered to standard output (see
+ * claimStandardOutput()), formatted like the MIPS --buffered-output runtime.
+ * The memory image is used as the program's memory, so a program runs once.
+ *
+ * @return false if the program stopped with a runtime error.
+ */
+bool runVMProgram(VMProgram* program);
+
+void freeVMProgram(VMProgram* program);
+
+// Words an instruction takes, opcode included
+uint32_t vmInstrLength(VMOpcode op);
+
+// Print an int or float and a newline the way the MIPS --buffered-output runtime does
+void vmWriteInt(OutputWriter* writer, int32_t value);
+void vmWriteFloat(OutputWriter* writer, float value);
+
+#endif
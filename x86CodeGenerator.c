@@ -0,0 +1,304 @@
+// x86CodeGenerator.c
+#include "x86CodeGenerator.h"
+#include "commons/outputWriter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+// Holds the value set by setReturn.* until the caller copies it
+#define RETURN_CELL ".Lreturn_value"
+
+// Where int additions and subtractions jump on overflow
+#define OVERFLOW_LABEL ".Loverflow"
+
+static OutputWriter x86Writer;
+
+// write.string literals, declared in .rodata as .Lstr<index>
+static char** stringLiterals = NULL;
+static int stringCount = 0;
+
+// arg.* TACs since the last call; their values are on the stack, 16 bytes each
+// (keeping %rsp aligned for calls), the last one on top
+static TAC* pendingArgs[X86_MAX_PENDING_ARGS];
+static int pendingArgCount = 0;
+
+// Type named by an op suffix ("int", "floatIndex", ...)
+static VarType x86OpType(const char* suffix) {
+    if (strncmp(suffix, "float", 5) == 0) return VarType_Float;
+    if (strncmp(suffix, "char", 4) == 0) return VarType_Char;
+    return VarType_Int;
+}
+
+// Size of a value in memory, and the matching mov and scratch register
+static int valueSize(VarType type) {
+    return (type == VarType_Char) ? 1 : 4;
+}
+
+static const char* movOp(VarType type) {
+    return (type == VarType_Char) ? "movb" : "movl";
+}
+
+static const char* scratchRegister(VarType type) {
+    return (type == VarType_Char) ? "%al" : "%eax";
+}
+
+// Copy a cell to another one (floats are copied as their bits)
+static void copyCell(const char* dest, const char* src, VarType type) {
+    writerPrintf(&x86Writer, "\t%s %s(%%rip), %s\n", movOp(type), src, scratchRegister(type));
+    writerPrintf(&x86Writer, "\t%s %s, %s(%%rip)\n", movOp(type), scratchRegister(type), dest);
+}
+
+static void generateX86Assign(TAC* current, VarType type) {
+    if (type == VarType_Float) {
+        float value = strtof(current->arg1, NULL);
+        unsigned int bits;
+        memcpy(&bits, &value, sizeof(bits));
+        writerPrintf(&x86Writer, "\tmovl $0x%08x, %s(%%rip)\n", bits, current->result);
+    } else if (type == VarType_Char) {
+        writerPrintf(&x86Writer, "\tmovb $%d, %s(%%rip)\n", (unsigned char)current->arg1[0], current->result);
+    } else {
+        writerPrintf(&x86Writer, "\tmovl $%d, %s(%%rip)\n", atoi(current->arg1), current->result);
+    }
+}
+
+// +, -, * and / on ints or floats
+static void generateX86Arithmetic(TAC* current) {
+    char operator = current->op[0];
+    if (x86OpType(current->op + 2) == VarType_Float) {
+        const char* op = (operator == '+') ? "addss" : (operator == '-') ? "subss" : (operator == '*') ? "mulss" : "divss";
+        writerPrintf(&x86Writer, "\tmovss %s(%%rip), %%xmm0\n", current->arg1);
+        writerPrintf(&x86Writer, "\t%s %s(%%rip), %%xmm0\n", op, current->arg2);
+        writerPrintf(&x86Writer, "\tmovss %%xmm0, %s(%%rip)\n", current->result);
+        return;
+    }
+
+    writerPrintf(&x86Writer, "\tmovl %s(%%rip), %%eax\n", current->arg1);
+    if (operator == '/') {
+        // Dividing INT_MIN by -1 would trap, so -1 negates instead (wrapping like MIPS)
+        writerPrintf(&x86Writer, "\tmovl %s(%%rip), %%ecx\n", current->arg2);
+        writerPrintf(&x86Writer, "\tcmpl $-1, %%ecx\n");
+        writerPrintf(&x86Writer, "\tjne 1f\n");
+        writerPrintf(&x86Writer, "\tnegl %%eax\n");
+        writerPrintf(&x86Writer, "\tjmp 2f\n");
+        writerPrintf(&x86Writer, "1:\tcltd\n");
+        writerPrintf(&x86Writer, "\tidivl %%ecx\n");
+        writerPrintf(&x86Writer, "2:\n");
+    } else {
+        const char* op = (operator == '+') ? "addl" : (operator == '-') ? "subl" : "imull";
+        writerPrintf(&x86Writer, "\t%s %s(%%rip), %%eax\n", op, current->arg2);
+        if (operator != '*') {
+            // MIPS add and sub trap on overflow (mul doesn't)
+            writerPrintf(&x86Writer, "\tjo %s\n", OVERFLOW_LABEL);
+        }
+    }
+    writerPrintf(&x86Writer, "\tmovl %%eax, %s(%%rip)\n", current->result);
+}
+
+// load.<type>Index (result = arg1[arg2]) and store.<type>Index (result[arg2] = arg1)
+static void generateX86Indexed(TAC* current, bool isLoad, VarType type) {
+    const char* arrayName = isLoad ? current->arg1 : current->result;
+    writerPrintf(&x86Writer, "\tmovslq %s(%%rip), %%rcx\n", current->arg2);
+    writerPrintf(&x86Writer, "\tleaq %s(%%rip), %%rdx\n", arrayName);
+    if (isLoad) {
+        writerPrintf(&x86Writer, "\t%s (%%rdx,%%rcx,%d), %s\n", movOp(type), valueSize(type), scratchRegister(type));
+        writerPrintf(&x86Writer, "\t%s %s, %s(%%rip)\n", movOp(type), scratchRegister(type), current->result);
+    } else {
+        writerPrintf(&x86Writer, "\t%s %s(%%rip), %s\n", movOp(type), current->arg1, scratchRegister(type));
+        writerPrintf(&x86Writer, "\t%s %s, (%%rdx,%%rcx,%d)\n", movOp(type), scratchRegister(type), valueSize(type));
+    }
+}
+
+static void generateX86Write(TAC* current) {
+    const char* suffix = current->op + 6;
+    if (strcmp(suffix, "string") == 0) {
+        stringLiterals = realloc(stringLiterals, (stringCount + 1) * sizeof(char*));
+        stringLiterals[stringCount] = strdup(current->arg1);
+        writerPrintf(&x86Writer, "\tleaq .Lstr%d(%%rip), %%rdi\n", stringCount++);
+        writerPrintf(&x86Writer, "\tcall rt_write_string\n");
+    } else if (strcmp(suffix, "charArray") == 0) {
+        // Char arrays end with a newline and NUL, see declareX86Data()
+        writerPrintf(&x86Writer, "\tleaq %s(%%rip), %%rdi\n", current->arg1);
+        writerPrintf(&x86Writer, "\tcall rt_write_string\n");
+    } else if (strcmp(suffix, "float") == 0) {
+        writerPrintf(&x86Writer, "\tmovss %s(%%rip), %%xmm0\n", current->arg1);
+        writerPrintf(&x86Writer, "\tcall rt_write_float\n");
+    } else if (strcmp(suffix, "char") == 0) {
+        writerPrintf(&x86Writer, "\tmovsbl %s(%%rip), %%edi\n", current->arg1);
+        writerPrintf(&x86Writer, "\tcall rt_write_char\n");
+    } else {
+        writerPrintf(&x86Writer, "\tmovl %s(%%rip), %%edi\n", current->arg1);
+        writerPrintf(&x86Writer, "\tcall rt_write_int\n");
+    }
+}
+
+// Push an argument's value; it is bound to the parameter when the call is made
+static void generateX86Arg(TAC* current) {
+    if (pendingArgCount == X86_MAX_PENDING_ARGS) {
+        fprintf(stderr, "Error: More than %d pending arguments\n", X86_MAX_PENDING_ARGS);
+        exit(1);
+    }
+    VarType type = x86OpType(current->op + 4);
+    writerPrintf(&x86Writer, "\tsubq $16, %%rsp\n");
+    writerPrintf(&x86Writer, "\t%s %s(%%rip), %s\n", movOp(type), current->arg1, scratchRegister(type));
+    writerPrintf(&x86Writer, "\t%s %s, (%%rsp)\n", movOp(type), scratchRegister(type));
+    pendingArgs[pendingArgCount++] = current;
+}
+
+// Copy the pushed arguments into the callee's parameters and pop them
+static void bindX86Args() {
+    for (int i = 0; i < pendingArgCount; i++) {
+        VarType type = x86OpType(pendingArgs[i]->op + 4);
+        writerPrintf(&x86Writer, "\t%s %d(%%rsp), %s\n", movOp(type), 16 * (pendingArgCount - 1 - i), scratchRegister(type));
+        writerPrintf(&x86Writer, "\t%s %s, %s(%%rip)\n", movOp(type), scratchRegister(type), pendingArgs[i]->result);
+    }
+    if (pendingArgCount > 0) writerPrintf(&x86Writer, "\taddq $%d, %%rsp\n", 16 * pendingArgCount);
+    pendingArgCount = 0;
+}
+
+static void generateX86Call(TAC* current) {
+    bindX86Args();
+    writerPrintf(&x86Writer, "\tcall %s\n", current->arg1);
+    FuncTAC* callee = findFuncTAC(current->arg1);
+    if (current->result && callee && callee->returnType != VarType_Void) {
+        copyCell(current->result, RETURN_CELL, callee->returnType);
+    }
+}
+
+// Translate one TAC list, main's or a function's
+static void generateX86List(TAC* current) {
+    for (; current; current = current->next) {
+        const char* op = current->op;
+        if (strcmp(op, "funcStart") == 0 || strcmp(op, "reserveArgs") == 0) {
+            // The frame is set up at the function label, and arguments reserve their own stack
+        } else if (strcmp(op, "return") == 0) {
+            writerPrintf(&x86Writer, "\tleave\n");
+            writerPrintf(&x86Writer, "\tret\n");
+        } else if (strncmp(op, "assign.", 7) == 0) {
+            generateX86Assign(current, x86OpType(op + 7));
+        } else if (strncmp(op, "load.", 5) == 0) {
+            VarType type = x86OpType(op + 5);
+            if (strstr(op, "Index")) generateX86Indexed(current, true, type);
+            else copyCell(current->result, current->arg1, type);
+        } else if (strncmp(op, "store.", 6) == 0) {
+            VarType type = x86OpType(op + 6);
+            if (strstr(op, "Index")) generateX86Indexed(current, false, type);
+            else copyCell(current->result, current->arg1, type);
+        } else if (op[0] && op[1] == '.' && strchr("+-*/", op[0])) {
+            generateX86Arithmetic(current);
+        } else if (strcmp(op, "intToFloat") == 0) {
+            writerPrintf(&x86Writer, "\tcvtsi2ssl %s(%%rip), %%xmm0\n", current->arg1);
+            writerPrintf(&x86Writer, "\tmovss %%xmm0, %s(%%rip)\n", current->result);
+        } else if (strcmp(op, "floatToInt") == 0) {
+            // Truncates, like cvt.w.s does in MARS
+            writerPrintf(&x86Writer, "\tcvttss2si %s(%%rip), %%eax\n", current->arg1);
+            writerPrintf(&x86Writer, "\tmovl %%eax, %s(%%rip)\n", current->result);
+        } else if (strncmp(op, "write.", 6) == 0) {
+            generateX86Write(current);
+        } else if (strncmp(op, "arg.", 4) == 0) {
+            generateX86Arg(current);
+        } else if (strcmp(op, "functionCall") == 0) {
+            generateX86Call(current);
+        } else if (strcmp(op, "tailCall") == 0) {
+            // The callee returns straight to our caller, leaving its value in the return cell
+            bindX86Args();
+            writerPrintf(&x86Writer, "\tleave\n");
+            writerPrintf(&x86Writer, "\tjmp %s\n", current->arg1);
+        } else if (strncmp(op, "setReturn.", 10) == 0) {
+            copyCell(RETURN_CELL, current->arg1, x86OpType(op + 10));
+        } else {
+            printf("X86: Unsupported TAC op %s\n", op);
+        }
+    }
+}
+
+// Declare every variable and temp, zeroed (chars as 'U') unless the optimizer gave
+// them a static initial value
+static void declareX86Data(const SymbolTable* table) {
+    writerPrintf(&x86Writer, "\n\t.data\n");
+    writerPrintf(&x86Writer, "\t.balign 4\n");
+    writerPrintf(&x86Writer, "%s:\t.long 0\n", RETURN_CELL);
+
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        for (Symbol* current = table->table[i]; current; current = current->next) {
+            int count = current->isArray ? current->arrSize : 1;
+            switch (current->type) {
+                case VarType_Int:
+                case VarType_Float:
+                    writerPrintf(&x86Writer, "\t.balign 4\n%s:\t%s ", current->name, (current->type == VarType_Int) ? ".long" : ".float");
+                    for (int j = 0; j < count; j++) {
+                        const char* initValue = getInitValue(current, j);
+                        writerPrintf(&x86Writer, "%s%s", (j > 0) ? ", " : "", initValue ? initValue : "0");
+                    }
+                    writerPrintf(&x86Writer, "\n");
+                    break;
+
+                case VarType_Char:
+                    // Written whole by write.charArray, so arrays end with a newline and NUL
+                    writerPrintf(&x86Writer, "%s:\t.byte ", current->name);
+                    for (int j = 0; j < count; j++) {
+                        const char* initValue = getInitValue(current, j);
+                        writerPrintf(&x86Writer, "%s%d", (j > 0) ? ", " : "", initValue ? (unsigned char)initValue[0] : 'U');
+                    }
+                    writerPrintf(&x86Writer, current->isArray ? ", 10, 0\n" : "\n");
+                    break;
+
+                default:
+                    printf("Invalid VarType in declareX86Data(): %s\n", varTypeToString(current->type));
+                    break;
+            }
+        }
+    }
+
+    writerPrintf(&x86Writer, "\t.balign 4\n");
+    for (int i = 0; i < getTempIntCount(); i++) writerPrintf(&x86Writer, "i%d:\t.long 0\n", i);
+    for (int i = 0; i < getTempFloatCount(); i++) writerPrintf(&x86Writer, "f%d:\t.long 0\n", i);
+    for (int i = 0; i < getTempCharCount(); i++) writerPrintf(&x86Writer, "c%d:\t.byte 0\n", i);
+
+    // Literals are already escaped for .asciiz, which .asciz reads the same way
+    writerPrintf(&x86Writer, "\n\t.section .rodata\n");
+    for (int i = 0; i < stringCount; i++) {
+        writerPrintf(&x86Writer, ".Lstr%d:\t.asciz \"%s\"\n", i, stringLiterals[i]);
+        free(stringLiterals[i]);
+    }
+    free(stringLiterals);
+    stringLiterals = NULL;
+    stringCount = 0;
+}
+
+void generateX86(TAC* tacInstructions, const SymbolTable* table, const char* outputFilename) {
+    if (!openOutputWriter(&x86Writer, outputFilename)) {
+        perror("Failed to open output file");
+        exit(EXIT_FAILURE);
+    }
+
+    writerPrintf(&x86Writer, "\t.text\n");
+    writerPrintf(&x86Writer, "\t.globl main\n");
+    writerPrintf(&x86Writer, "main:\n");
+    writerPrintf(&x86Writer, "\tpushq %%rbp\n");
+    writerPrintf(&x86Writer, "\tmovq %%rsp, %%rbp\n");
+    generateX86List(tacInstructions);
+    writerPrintf(&x86Writer, "\tcall rt_flush\n");
+    writerPrintf(&x86Writer, "\txorl %%eax, %%eax\n");
+    writerPrintf(&x86Writer, "\tleave\n");
+    writerPrintf(&x86Writer, "\tret\n");
+
+    // Functions run with the frame pointer pushed, which keeps %rsp 16-byte aligned for calls
+    for (FuncTAC* func = funcTacHeads; func; func = func->nextFunc) {
+        writerPrintf(&x86Writer, "\n%s:\n", func->funcName);
+        writerPrintf(&x86Writer, "\tpushq %%rbp\n");
+        writerPrintf(&x86Writer, "\tmovq %%rsp, %%rbp\n");
+        generateX86List(func->func);
+        writerPrintf(&x86Writer, "\tleave\n");
+        writerPrintf(&x86Writer, "\tret\n");
+    }
+
+    // Reached with %rsp as aligned as at any call; rt_overflow() doesn't return
+    writerPrintf(&x86Writer, "\n%s:\n", OVERFLOW_LABEL);
+    writerPrintf(&x86Writer, "\tcall rt_overflow\n");
+
+    declareX86Data(table);
+    writerPrintf(&x86Writer, "\n\t.section .note.GNU-stack,\"\",@progbits\n");
+    closeOutputWriter(&x86Writer);
+    printf("x86-64 code generated and saved to file %s\n", outputFilename);
+}
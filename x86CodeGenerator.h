@@ -0,0 +1,27 @@
+#ifndef X86_CODE_GENERATOR_H
+#define X86_CODE_GENERATOR_H
+
+#include "semantic.h"  // For TAC and FuncTAC definitions
+#include "symbolTable.h"
+
+// Most arguments a call can have pending at once
+#define X86_MAX_PENDING_ARGS 32
+
+// Memory layout follows the MIPS code: every variable, parameter and temp is a
+// global cell in .data, and TAC instructions load their operands from their cells
+// and store the result back. Arguments are pushed as they are computed and copied
+// into the callee's parameters when the call is made; return values go through
+// a single cell. Output calls the routines in runtime/cmmRuntime.c.
+
+/**
+ * Generate x86-64 System V assembly (GNU as, AT&T syntax) for the program.
+ * The result defines `main` and links with the runtime:
+ *      gcc output.s runtime/cmmRuntime.c -o program
+ *
+ * @param tacInstructions The main TAC list.
+ * @param table Symbol table holding the program's variables.
+ * @param outputFilename File to write, "-" for standard output.
+ */
+void generateX86(TAC* tacInstructions, const SymbolTable* table, const char* outputFilename);
+
+#endif